@@ -50,12 +50,12 @@ project "VKBGEngine-App"
     filter "configurations:Debug"
         symbols "On"
         optimize "Off"
-        defines { "_DEBUG", "DEBUG", "VKBG_DEBUG" }
+        defines { "_DEBUG", "DEBUG", "VKBG_DEBUG", "VKBG_PROFILE" }
 
     filter "configurations:Release"
         symbols "On"
         optimize "On"
-        defines { "VKBG_DEBUG" }
+        defines { "VKBG_DEBUG", "VKBG_PROFILE" }
 
     filter "configurations:Release"
         symbols "Off"
@@ -10,8 +10,16 @@ for %%f in (%SHADER_PATH%\*.vert) do (
     %GLSLC% %%f -o %COMPILED_PATH%\%%~nf.vert.spv
 )
 
+rem the vertex layouts of Simple.vert other than the float one
+%GLSLC% %SHADER_PATH%\Simple.vert -DVKBG_QUANTIZED_VERTICES -o %COMPILED_PATH%\SimpleQuantized.vert.spv
+%GLSLC% %SHADER_PATH%\Simple.vert -DVKBG_QUANTIZED_VERTICES -DVKBG_VERTEX_COLORS -o %COMPILED_PATH%\SimpleQuantizedColor.vert.spv
+
 for %%f in (%SHADER_PATH%\*.frag) do (
     %GLSLC% %%f -o %COMPILED_PATH%\%%~nf.frag.spv
 )
 
+for %%f in (%SHADER_PATH%\*.comp) do (
+    %GLSLC% %%f -o %COMPILED_PATH%\%%~nf.comp.spv
+)
+
 echo "Shaders Built!"
@@ -10,11 +10,6 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     vec3 directionalLightPos;
 } globalUbo;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
-
 void main() {
 //    FragColor = vec4(0.0, 0.4157, 1.0, 1.0);
     vec3 normal = normalize(iNormal);
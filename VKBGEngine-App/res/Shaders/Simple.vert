@@ -1,9 +1,23 @@
 #version 450
 
+// VertexLayout of the model, BuildShaders.bat compiles a variant per layout.
+// The quantized positions are unorms in the mesh's bounds, the model matrix
+// maps them back, and the normals are octahedral snorms.
+#ifdef VKBG_QUANTIZED_VERTICES
+layout(location = 0) in vec3 position;
+layout(location = 2) in vec2 octNormal;
+layout(location = 3) in vec2 uv;
+#ifdef VKBG_VERTEX_COLORS
+layout(location = 1) in vec3 color;
+#else
+const vec3 color = vec3(1.0);
+#endif
+#else
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec2 uv;
+#endif
 
 layout(location = 0) out vec3 oColor;
 layout(location = 1) out vec3 oNormal;
@@ -13,16 +27,41 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     vec3 directionalLightPos;
 } globalUbo;
 
-layout(push_constant) uniform Push {
+struct ObjectData {
     mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
+    mat3 normalMatrix;
+    vec3 color;
+    uint materialIndex;
+};
+
+// written every frame by SimpleRenderSystem, gl_InstanceIndex includes the
+// first instance of the draw so each batch reads its own objects
+layout(std430, set = 1, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+} objectBuffer;
+
+#ifdef VKBG_QUANTIZED_VERTICES
+// same as DecodeOctahedral in VertexLayout.cpp
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+#endif
 
 void main()
 {
-    oColor = color;
-//    mat3 normalMatrix = transpose(inverse(mat3(push.modelMatrix)));
-    oNormal = normalize(mat3(push.normalMatrix) * normal);
+    ObjectData object = objectBuffer.objects[gl_InstanceIndex];
+#ifdef VKBG_QUANTIZED_VERTICES
+    vec3 normal = DecodeOctahedral(octNormal);
+#endif
+
+    oColor = color * object.color;
+//    mat3 normalMatrix = transpose(inverse(mat3(modelMatrix)));
+    oNormal = normalize(object.normalMatrix * normal);
 
-    gl_Position = globalUbo.projectionViewMatrix * push.modelMatrix * vec4(position, 1.0);
+    gl_Position = globalUbo.projectionViewMatrix * object.modelMatrix * vec4(position, 1.0);
 }
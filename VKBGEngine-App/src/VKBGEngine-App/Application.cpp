@@ -1,12 +1,24 @@
 #include "VKBGEInclude.h"
 
-int main()
+int main(int argc, char** argv)
 {
     static constexpr uint32_t WIDTH{ 800 };
     static constexpr uint32_t HEIGHT{ 600 };
     static constexpr char TITLE[11]{ "VKBGEngine" };
+    vkbg::EngineProps properties{ { WIDTH, HEIGHT, TITLE } };
+    for (int i = 1; i < argc; ++i)
+    {
+        // --headless [frames]: render offscreen, for machines without a display
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            properties.Headless = true;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0]))
+                properties.HeadlessFrameCount = (uint32_t)std::stoul(argv[++i]);
+        }
+    }
+
     vkbg::Engine& engine = vkbg::Engine::Instance();
-    engine.Init({WIDTH, HEIGHT, TITLE});
+    engine.Init(properties);
 
     try
     {
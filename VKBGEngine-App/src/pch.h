@@ -6,11 +6,13 @@
 #include <utility>
 #include <algorithm>
 #include <functional>
+#include <cstring>
 
 // Data Structures
 #include <string>
 #include <sstream>
 #include <vector>
+#include <span>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -0,0 +1,70 @@
+project "VKBGEngine-Bench"
+    kind "ConsoleApp"
+    language "C++"
+
+    targetdir ("%{wks.location}/bin/" .. OutputDir .. "/%{prj.name}")
+    objdir ("%{wks.location}/bin-inter/" .. OutputDir .. "/%{prj.name}")
+
+    files 
+    {
+        "src/**.h",
+        "src/**.cpp"
+    }
+
+    includedirs
+    {
+        "src",
+        "src/%{prj.name}",
+        "%{wks.location}/VKBGEngine-Core/src",
+        "%{wks.location}/VKBGEngine-Core/src/VKBGEngine-Core",
+        "%{IncludeDir.GLFW}",
+        "%{IncludeDir.GLM}"
+    }
+
+    links
+    {
+        "VKBGEngine-Core",
+    }
+
+    -- the app compiles the shaders the postbuild copies
+    dependson
+    {
+        "VKBGEngine-App",
+    }
+
+    pchheader "pch.h"
+    pchsource "src/pch.cpp"
+
+    forceincludes "pch.h"
+
+    filter "system:windows"
+        cppdialect "C++20"
+        staticruntime "On"
+        systemversion "latest"
+        defines "PLATFORM_WINDOWS"
+
+        includedirs
+        {
+            "C:/VulkanSDK/1.3.268.0/Include"
+        }
+
+        -- the frame benchmark renders with the app's shaders
+        postbuildcommands
+        {
+            "{COPY} %{wks.location}/VKBGEngine-App/res/Shaders/Compiled " .. "%{cfg.targetdir}/res/Shaders/Compiled"
+        }
+
+    filter "configurations:Debug"
+        symbols "On"
+        optimize "Off"
+        defines { "_DEBUG", "DEBUG", "VKBG_DEBUG", "VKBG_PROFILE" }
+
+    filter "configurations:Release"
+        symbols "On"
+        optimize "On"
+        defines { "VKBG_DEBUG", "VKBG_PROFILE" }
+
+    filter "configurations:Dist"
+        symbols "Off"
+        optimize "On"
+        defines "NDEBUG"
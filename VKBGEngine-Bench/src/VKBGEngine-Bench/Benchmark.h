@@ -0,0 +1,104 @@
+#pragma once
+
+namespace vkbg::bench
+{
+using Clock = std::chrono::high_resolution_clock;
+
+inline double ElapsedMs(Clock::time_point start, Clock::time_point end = Clock::now())
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Deterministic pseudo random value in [0, 1). Scenes are derived from the
+// entity/frame index with it, never from the clock or a std:: random
+// distribution (whose output differs between standard libraries), so that two
+// runs do exactly the same work.
+inline float Hash01(uint32_t value)
+{
+    value ^= value >> 16;
+    value *= 0x7feb352d;
+    value ^= value >> 15;
+    value *= 0x846ca68b;
+    value ^= value >> 16;
+    return (value & 0xFFFFFF) / float(0x1000000);
+}
+
+struct SampleStats
+{
+    double Mean{ 0.0 };
+    double Min{ 0.0 };
+    double Max{ 0.0 };
+    double P50{ 0.0 };
+    double P95{ 0.0 };
+    double P99{ 0.0 };
+};
+
+inline double Percentile(const std::vector<double>& sortedSamples, double percentile)
+{
+    if (sortedSamples.empty())
+        return 0.0;
+    // nearest-rank, so that the reported value is always an actual sample
+    size_t rank = (size_t)std::ceil(percentile / 100.0 * sortedSamples.size());
+    return sortedSamples[std::clamp<size_t>(rank, 1, sortedSamples.size()) - 1];
+}
+
+inline SampleStats ComputeStats(std::vector<double> samples)
+{
+    SampleStats stats{};
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+    stats.Mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    stats.Min = samples.front();
+    stats.Max = samples.back();
+    stats.P50 = Percentile(samples, 50.0);
+    stats.P95 = Percentile(samples, 95.0);
+    stats.P99 = Percentile(samples, 99.0);
+    return stats;
+}
+
+// Writes "name": { "mean": ..., "p99": ... } (no trailing comma).
+inline void WriteJsonStats(std::ostream& out, const char* name, const SampleStats& stats)
+{
+    out << '"' << name << "\": { "
+        << "\"mean\": " << stats.Mean
+        << ", \"min\": " << stats.Min
+        << ", \"max\": " << stats.Max
+        << ", \"p50\": " << stats.P50
+        << ", \"p95\": " << stats.P95
+        << ", \"p99\": " << stats.P99 << " }";
+}
+
+// Returns the value following "--name" in args, or fallback if it isn't there.
+inline std::string GetOption(const std::vector<std::string>& args, const std::string& name, const std::string& fallback)
+{
+    for (size_t i = 0; i + 1 < args.size(); ++i)
+    {
+        if (args[i] == name)
+            return args[i + 1];
+    }
+    return fallback;
+}
+
+inline bool HasFlag(const std::vector<std::string>& args, const std::string& name)
+{
+    return std::find(args.begin(), args.end(), name) != args.end();
+}
+
+// Each benchmark gets the command line arguments that follow its name
+// and returns the process exit code.
+using BenchmarkFunc = int(*)(const std::vector<std::string>& args);
+
+int RunMeshCacheBenchmark(const std::vector<std::string>& args);
+int RunFrameBenchmark(const std::vector<std::string>& args);
+int RunTransformBenchmark(const std::vector<std::string>& args);
+int RunTransformKernelBenchmark(const std::vector<std::string>& args);
+int RunJobBenchmark(const std::vector<std::string>& args);
+int RunDrawSortBenchmark(const std::vector<std::string>& args);
+int RunObjLoadBenchmark(const std::vector<std::string>& args);
+int RunWeldBenchmark(const std::vector<std::string>& args);
+int RunMeshOptimizeBenchmark(const std::vector<std::string>& args);
+int RunLodBenchmark(const std::vector<std::string>& args);
+int RunVertexQuantizeBenchmark(const std::vector<std::string>& args);
+}
@@ -0,0 +1,86 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Graphics/Systems/DrawSort.h"
+
+namespace vkbg::bench
+{
+struct DrawSortBenchmarkConfig
+{
+    uint32_t DrawCount{ 100000 };
+    uint32_t MeshCount{ 64 };
+    uint32_t IterationCount{ 50 };
+    std::string OutputPath;
+};
+
+static DrawSortBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    DrawSortBenchmarkConfig config{};
+    config.DrawCount = std::max(1, std::stoi(GetOption(args, "--draws", "100000")));
+    config.MeshCount = std::max(1, std::stoi(GetOption(args, "--meshes", "64")));
+    config.IterationCount = std::max(1, std::stoi(GetOption(args, "--iterations", "50")));
+    config.OutputPath = GetOption(args, "--out", "");
+    return config;
+}
+
+// RadixSortDraws against std::stable_sort on the same keys, a frame's worth of
+// draws spread over a few meshes and geometry blocks at random depths.
+int RunDrawSortBenchmark(const std::vector<std::string>& args)
+{
+    const DrawSortBenchmarkConfig config = ParseConfig(args);
+
+    std::vector<SortedDraw> draws(config.DrawCount);
+    for (uint32_t i = 0; i < config.DrawCount; ++i)
+    {
+        const uint32_t mesh = (uint32_t)(Hash01(i * 2) * config.MeshCount);
+        draws[i] = { DrawKey::Make(0, 0, mesh % 4, mesh, 0, Hash01(i * 2 + 1) * 100.f), i };
+    }
+
+    std::vector<double> radixMs;
+    std::vector<double> stableSortMs;
+    std::vector<SortedDraw> sorted;
+    std::vector<SortedDraw> scratch;
+    bool matches = true;
+    for (uint32_t iteration = 0; iteration < config.IterationCount; ++iteration)
+    {
+        sorted = draws;
+        auto start = Clock::now();
+        RadixSortDraws(sorted, scratch);
+        radixMs.push_back(ElapsedMs(start));
+
+        std::vector<SortedDraw> reference = draws;
+        start = Clock::now();
+        std::stable_sort(reference.begin(), reference.end(),
+            [](const SortedDraw& a, const SortedDraw& b) { return a.Key < b.Key; });
+        stableSortMs.push_back(ElapsedMs(start));
+
+        for (uint32_t i = 0; i < config.DrawCount && matches; ++i)
+            matches = sorted[i].Key == reference[i].Key && sorted[i].Entity == reference[i].Entity;
+    }
+
+    const SampleStats radixStats = ComputeStats(radixMs);
+    const SampleStats stableSortStats = ComputeStats(stableSortMs);
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"draw-sort\",\n"
+        << "  \"config\": { "
+        << "\"draws\": " << config.DrawCount
+        << ", \"meshes\": " << config.MeshCount
+        << ", \"iterations\": " << config.IterationCount << " },\n  ";
+    WriteJsonStats(json, "radix_sort_ms", radixStats);
+    json << ",\n  ";
+    WriteJsonStats(json, "stable_sort_ms", stableSortStats);
+    json << ",\n  \"speedup\": " << stableSortStats.Mean / radixStats.Mean
+        << ",\n  \"matches_stable_sort\": " << (matches ? "true" : "false") << "\n}\n";
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return matches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
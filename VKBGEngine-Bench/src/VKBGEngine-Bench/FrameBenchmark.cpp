@@ -0,0 +1,265 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/VKBGEngine.h"
+#include "VKBGEngine-Core/Entities/Camera.h"
+#include "VKBGEngine-Core/Graphics/Model.h"
+#include "VKBGEngine-Core/Graphics/Renderer.h"
+#include "VKBGEngine-Core/Graphics/RenderContext.h"
+#include "VKBGEngine-Core/Graphics/GpuProfiler.h"
+#include "VKBGEngine-Core/Graphics/MemoryAllocator.h"
+#include "VKBGEngine-Core/Graphics/GeometryPool.h"
+
+namespace vkbg::bench
+{
+struct FrameBenchmarkConfig
+{
+    uint32_t EntityCount{ 1000 };
+    uint32_t ModelCount{ 4 };
+    uint32_t FrameCount{ 1000 };
+    uint32_t WarmupFrameCount{ 100 };
+    uint32_t Width{ 1280 };
+    uint32_t Height{ 720 };
+    bool Headless{ true };
+    bool ParallelRecording{ false };
+    bool GpuDriven{ false };
+    // the spheres keep the float vertices instead of the compact layout
+    bool FloatVertices{ false };
+    std::vector<std::string> ObjPaths;
+    std::string OutputPath;
+};
+
+// UV sphere, each model gets a different tessellation so the batches differ in cost.
+static std::unique_ptr<Model> CreateSphereModel(RenderContext* context, uint32_t rings, glm::vec3 color, bool floatVertices)
+{
+    const uint32_t segments = rings * 2;
+    Model::Builder builder{};
+    for (uint32_t ring = 0; ring <= rings; ++ring)
+    {
+        const float phi = glm::pi<float>() * ring / rings;
+        for (uint32_t segment = 0; segment <= segments; ++segment)
+        {
+            const float theta = glm::two_pi<float>() * segment / segments;
+            glm::vec3 normal{ glm::sin(phi) * glm::cos(theta), glm::cos(phi), glm::sin(phi) * glm::sin(theta) };
+            builder.Vertices.push_back({
+                .Position = normal * .5f,
+                .Color = color,
+                .Normal = normal,
+                .UV = { (float)segment / segments, (float)ring / rings }
+            });
+        }
+    }
+
+    for (uint32_t ring = 0; ring < rings; ++ring)
+    {
+        for (uint32_t segment = 0; segment < segments; ++segment)
+        {
+            uint32_t i0 = ring * (segments + 1) + segment;
+            uint32_t i1 = i0 + segments + 1;
+            builder.Indices.insert(builder.Indices.end(), { i0, i1, i0 + 1, i0 + 1, i1, i1 + 1 });
+        }
+    }
+    // like the OBJ models, so that the far spheres draw coarser levels
+    builder.GenerateLods();
+    if (floatVertices == false)
+        builder.UseCompactLayout();
+    return std::make_unique<Model>(context, builder);
+}
+
+// Entities on a square grid in the XZ plane, models assigned round robin.
+static float LoadScene(Engine& engine, const FrameBenchmarkConfig& config)
+{
+    RenderContext* context = engine.GetRenderContext();
+    Scene& scene = engine.GetScene();
+
+    std::vector<MeshHandle> meshes;
+    for (auto& model : Model::CreateModelsFromObj(context, config.ObjPaths, engine.GetJobSystem()))
+        meshes.push_back(scene.AddMesh(std::move(model)));
+    for (uint32_t i = (uint32_t)meshes.size(); i < config.ModelCount; ++i)
+    {
+        glm::vec3 color{ Hash01(i * 3), Hash01(i * 3 + 1), Hash01(i * 3 + 2) };
+        meshes.push_back(scene.AddMesh(CreateSphereModel(context, 8 + 8 * i, color, config.FloatVertices)));
+    }
+
+    constexpr float spacing = 2.f;
+    const uint32_t gridSize = (uint32_t)std::ceil(std::sqrt((double)config.EntityCount));
+    const float halfExtent = gridSize * spacing * .5f;
+
+    for (uint32_t i = 0; i < config.EntityCount; ++i)
+    {
+        EntityHandle entity = scene.CreateEntity();
+        scene.GetMeshHandle(entity) = meshes[i % meshes.size()];
+        scene.SetTranslation(entity, {
+            (i % gridSize) * spacing - halfExtent,
+            0.f,
+            (i / gridSize) * spacing - halfExtent });
+        scene.SetRotation(entity, { 0.f, Hash01(i) * glm::two_pi<float>(), 0.f });
+        scene.SetScale(entity, glm::vec3{ .5f + Hash01(i + config.EntityCount) });
+    }
+
+    return halfExtent;
+}
+
+// Orbit around the scene center, bobbing up and down, one revolution every 20 s
+// of simulated time. The camera stays inside the grid so part of it is culled.
+static void UpdateCamera(Camera& camera, float time, float halfExtent, float aspectRatio)
+{
+    const float radius = std::max(halfExtent * .6f, 4.f);
+    const float angle = time * glm::two_pi<float>() / 20.f;
+    // -Y is up
+    const float height = -(radius * .25f + radius * .1f * glm::sin(time * .5f));
+
+    glm::vec3 position{ radius * glm::cos(angle), height, radius * glm::sin(angle) };
+    camera.SetViewTarget(position, glm::vec3{ 0.f });
+    camera.SetPerspectiveProjection(glm::radians(45.f), aspectRatio, .1f, radius + halfExtent * 2.f);
+}
+
+static FrameBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    FrameBenchmarkConfig config{};
+    config.EntityCount = std::max(1, std::stoi(GetOption(args, "--entities", "1000")));
+    config.ModelCount = std::max(1, std::stoi(GetOption(args, "--models", "4")));
+    config.FrameCount = std::max(1, std::stoi(GetOption(args, "--frames", "1000")));
+    config.WarmupFrameCount = std::max(0, std::stoi(GetOption(args, "--warmup", "100")));
+    config.Width = std::max(1, std::stoi(GetOption(args, "--width", "1280")));
+    config.Height = std::max(1, std::stoi(GetOption(args, "--height", "720")));
+    config.Headless = HasFlag(args, "--window") == false;
+    config.ParallelRecording = HasFlag(args, "--parallel-recording");
+    config.GpuDriven = HasFlag(args, "--gpu-driven");
+    config.FloatVertices = HasFlag(args, "--float-vertices");
+    config.OutputPath = GetOption(args, "--out", "");
+
+    for (size_t i = 0; i + 1 < args.size(); ++i)
+    {
+        if (args[i] == "--obj")
+            config.ObjPaths.push_back(args[i + 1]);
+    }
+    config.ModelCount = std::max(config.ModelCount, (uint32_t)config.ObjPaths.size());
+    return config;
+}
+
+// Renders a fixed scene along a scripted camera path with a fixed time step and
+// reports the distribution of the per-frame metrics as JSON, so that runs on the
+// same machine can be compared over time.
+int RunFrameBenchmark(const std::vector<std::string>& args)
+{
+    const FrameBenchmarkConfig config = ParseConfig(args);
+
+    Engine& engine = Engine::Instance();
+    EngineProps properties{ { config.Width, config.Height, "VKBGEngine-Bench" } };
+    properties.Headless = config.Headless;
+    properties.LoadDefaultScene = false;
+    properties.ParallelRecording = config.ParallelRecording;
+    properties.GpuDrivenRendering = config.GpuDriven;
+    engine.Init(properties);
+
+    const float halfExtent = LoadScene(engine, config);
+    Renderer* renderer = engine.GetRenderer();
+    MemoryAllocator* allocator = engine.GetRenderContext()->GetAllocator();
+
+    std::vector<double> cpuFrameMs;
+    std::vector<double> gpuFrameMs;
+    std::vector<double> drawCalls;
+    std::vector<double> visibleEntities;
+    std::vector<double> pipelineBindsSaved;
+    std::vector<double> bufferBindsSaved;
+    std::vector<double> triangles;
+    std::vector<double> lodTrianglesSaved;
+    std::vector<double> memoryInUseMb;
+    std::vector<double> memoryAllocatedMb;
+    cpuFrameMs.reserve(config.FrameCount);
+
+    constexpr float frameTime = 1.f / 60.f;
+    constexpr double bytesPerMb = 1024.0 * 1024.0;
+    uint64_t lastGpuSample = 0;
+    Camera camera{};
+
+    for (uint32_t frame = 0; frame < config.WarmupFrameCount + config.FrameCount; ++frame)
+    {
+        UpdateCamera(camera, frame * frameTime, halfExtent, renderer->GetAspectRatio());
+
+        auto start = Clock::now();
+        if (engine.DrawFrame(camera, frameTime) == false)
+        {
+            // the swap chain was recreated, draw the same frame again
+            --frame;
+            continue;
+        }
+        double elapsed = ElapsedMs(start);
+
+        if (frame < config.WarmupFrameCount)
+            continue;
+
+        const FrameStats& frameStats = engine.GetLastFrameStats();
+        cpuFrameMs.push_back(elapsed);
+        drawCalls.push_back(frameStats.DrawCalls);
+        visibleEntities.push_back(frameStats.VisibleEntities);
+        pipelineBindsSaved.push_back(frameStats.PipelineBindsSaved);
+        bufferBindsSaved.push_back(frameStats.BufferBindsSaved);
+        triangles.push_back((double)frameStats.Triangles);
+        lodTrianglesSaved.push_back((double)frameStats.LodTrianglesSaved);
+
+        // GPU timings come back a couple of frames late, only take new ones
+        float gpuMs{};
+        uint64_t gpuSample{};
+        if (renderer->GetGpuProfiler()->GetLastSample("Frame", gpuMs, gpuSample) && gpuSample != lastGpuSample)
+        {
+            lastGpuSample = gpuSample;
+            gpuFrameMs.push_back(gpuMs);
+        }
+
+        MemoryStats memoryStats = allocator->GetStats();
+        memoryInUseMb.push_back(memoryStats.BytesInUse / bytesPerMb);
+        memoryAllocatedMb.push_back(memoryStats.BytesAllocated / bytesPerMb);
+    }
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"frame\",\n"
+        << "  \"device\": \"" << engine.GetRenderContext()->GetPhysicalDeviceProperties().deviceName << "\",\n"
+        << "  \"config\": { "
+        << "\"entities\": " << config.EntityCount
+        << ", \"models\": " << config.ModelCount
+        << ", \"frames\": " << config.FrameCount
+        << ", \"warmup\": " << config.WarmupFrameCount
+        << ", \"width\": " << config.Width
+        << ", \"height\": " << config.Height
+        << ", \"headless\": " << (config.Headless ? "true" : "false")
+        << ", \"parallel_recording\": " << (config.ParallelRecording ? "true" : "false")
+        << ", \"gpu_driven\": " << (config.GpuDriven ? "true" : "false")
+        << ", \"float_vertices\": " << (config.FloatVertices ? "true" : "false") << " },\n"
+        << "  \"vertex_bytes\": " << engine.GetRenderContext()->GetGeometryPool()->GetStats().VertexBytes << ",\n"
+        << "  \"gpu_samples\": " << gpuFrameMs.size() << ",\n  ";
+    WriteJsonStats(json, "cpu_frame_ms", ComputeStats(cpuFrameMs));
+    json << ",\n  ";
+    WriteJsonStats(json, "gpu_frame_ms", ComputeStats(gpuFrameMs));
+    json << ",\n  ";
+    WriteJsonStats(json, "draw_calls", ComputeStats(drawCalls));
+    json << ",\n  ";
+    WriteJsonStats(json, "visible_entities", ComputeStats(visibleEntities));
+    json << ",\n  ";
+    WriteJsonStats(json, "pipeline_binds_saved", ComputeStats(pipelineBindsSaved));
+    json << ",\n  ";
+    WriteJsonStats(json, "buffer_binds_saved", ComputeStats(bufferBindsSaved));
+    json << ",\n  ";
+    WriteJsonStats(json, "triangles", ComputeStats(triangles));
+    json << ",\n  ";
+    WriteJsonStats(json, "lod_triangles_saved", ComputeStats(lodTrianglesSaved));
+    json << ",\n  ";
+    WriteJsonStats(json, "memory_in_use_mb", ComputeStats(memoryInUseMb));
+    json << ",\n  ";
+    WriteJsonStats(json, "memory_allocated_mb", ComputeStats(memoryAllocatedMb));
+    json << "\n}\n";
+
+    engine.Shutdown();
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return EXIT_SUCCESS;
+}
+}
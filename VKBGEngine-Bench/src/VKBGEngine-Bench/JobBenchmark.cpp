@@ -0,0 +1,139 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Entities/Scene.h"
+#include "VKBGEngine-Core/Threading/JobSystem.h"
+
+namespace vkbg::bench
+{
+struct JobBenchmarkConfig
+{
+    uint32_t MaxThreadCount{ 1 };
+    uint32_t JobCount{ 10000 };
+    uint32_t ElementCount{ 1u << 20 };
+    uint32_t IterationCount{ 50 };
+    std::string OutputPath;
+};
+
+static JobBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    JobBenchmarkConfig config{};
+    const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    config.MaxThreadCount = std::max(1, std::stoi(GetOption(args, "--threads", std::to_string(hardwareThreads))));
+    config.JobCount = std::max(1, std::stoi(GetOption(args, "--jobs", "10000")));
+    config.ElementCount = std::max(1, std::stoi(GetOption(args, "--elements", "1048576")));
+    config.IterationCount = std::max(1, std::stoi(GetOption(args, "--iterations", "50")));
+    config.OutputPath = GetOption(args, "--out", "");
+    return config;
+}
+
+// 1, 2, 4, ... up to the max, the max itself always included
+static std::vector<uint32_t> GetThreadCounts(uint32_t maxThreadCount)
+{
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2)
+        threadCounts.push_back(threadCount);
+    threadCounts.push_back(maxThreadCount);
+    return threadCounts;
+}
+
+// Scheduling overhead (empty jobs) and scaling of ParallelFor and of the scene
+// transform update from 1 thread to --threads.
+int RunJobBenchmark(const std::vector<std::string>& args)
+{
+    const JobBenchmarkConfig config = ParseConfig(args);
+
+    std::vector<float> input(config.ElementCount);
+    std::vector<float> output(config.ElementCount);
+    for (uint32_t i = 0; i < config.ElementCount; ++i)
+        input[i] = Hash01(i) * 100.f;
+
+    Scene scene{};
+    std::vector<EntityHandle> entities(config.ElementCount / 4);
+    for (uint32_t i = 0; i < entities.size(); ++i)
+    {
+        entities[i] = scene.CreateEntity();
+        scene.SetTranslation(entities[i], { Hash01(i * 3) * 100.f, Hash01(i * 3 + 1) * 100.f, Hash01(i * 3 + 2) * 100.f });
+    }
+    scene.UpdateDirtyTransforms();
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"jobs\",\n"
+        << "  \"config\": { "
+        << "\"max_threads\": " << config.MaxThreadCount
+        << ", \"jobs\": " << config.JobCount
+        << ", \"elements\": " << config.ElementCount
+        << ", \"entities\": " << entities.size()
+        << ", \"iterations\": " << config.IterationCount << " },\n"
+        << "  \"runs\": [";
+
+    double singleThreadParallelForMs = 0.0;
+    double singleThreadTransformsMs = 0.0;
+    // read back so that the compiler can't drop the work
+    float checksum = 0.f;
+    const std::vector<uint32_t> threadCounts = GetThreadCounts(config.MaxThreadCount);
+    for (size_t run = 0; run < threadCounts.size(); ++run)
+    {
+        const uint32_t threadCount = threadCounts[run];
+        JobSystem jobSystem{ threadCount - 1 };
+
+        std::vector<double> emptyJobNs;
+        std::vector<double> parallelForMs;
+        std::vector<double> transformsMs;
+        for (uint32_t iteration = 0; iteration < config.IterationCount; ++iteration)
+        {
+            JobCounter counter{};
+            auto start = Clock::now();
+            for (uint32_t job = 0; job < config.JobCount; ++job)
+                jobSystem.Run([] {}, counter);
+            jobSystem.Wait(counter);
+            emptyJobNs.push_back(ElapsedMs(start) * 1e6 / config.JobCount);
+
+            start = Clock::now();
+            jobSystem.ParallelFor(config.ElementCount, 1024, [&](uint32_t first, uint32_t last)
+            {
+                for (uint32_t i = first; i < last; ++i)
+                    output[i] = std::sin(input[i]) * std::cos(input[i] * .5f) + std::sqrt(input[i]);
+            });
+            parallelForMs.push_back(ElapsedMs(start));
+            checksum += output[iteration % config.ElementCount];
+
+            for (uint32_t i = 0; i < entities.size(); ++i)
+                scene.SetRotation(entities[i], { 0.f, Hash01(i) + iteration * .01f, 0.f });
+            start = Clock::now();
+            scene.UpdateDirtyTransforms(&jobSystem);
+            transformsMs.push_back(ElapsedMs(start));
+            checksum += scene.GetWorldMatrices()[iteration % entities.size()][0][0];
+        }
+
+        const SampleStats parallelForStats = ComputeStats(parallelForMs);
+        const SampleStats transformsStats = ComputeStats(transformsMs);
+        if (run == 0)
+        {
+            singleThreadParallelForMs = parallelForStats.Mean;
+            singleThreadTransformsMs = transformsStats.Mean;
+        }
+
+        json << (run == 0 ? "\n    {\n      " : ",\n    {\n      ")
+            << "\"threads\": " << threadCount << ",\n      ";
+        WriteJsonStats(json, "empty_job_ns", ComputeStats(emptyJobNs));
+        json << ",\n      ";
+        WriteJsonStats(json, "parallel_for_ms", parallelForStats);
+        json << ",\n      \"parallel_for_speedup\": " << singleThreadParallelForMs / parallelForStats.Mean << ",\n      ";
+        WriteJsonStats(json, "transforms_ms", transformsStats);
+        json << ",\n      \"transforms_speedup\": " << singleThreadTransformsMs / transformsStats.Mean
+            << "\n    }";
+    }
+    json << "\n  ],\n  \"checksum\": " << checksum << "\n}\n";
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return EXIT_SUCCESS;
+}
+}
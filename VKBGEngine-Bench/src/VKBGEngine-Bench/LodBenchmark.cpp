@@ -0,0 +1,111 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Graphics/Model.h"
+
+namespace vkbg::bench
+{
+struct LodBenchmarkConfig
+{
+    std::string ObjPath;
+    Model::LodSettings Settings{};
+    std::string OutputPath;
+};
+
+static LodBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    LodBenchmarkConfig config{};
+    config.ObjPath = args.empty() ? "" : args[0];
+    config.Settings.LodCount = std::clamp(std::stoi(GetOption(args, "--levels", "4")), 1, (int)Model::MaxLodCount);
+    config.Settings.TriangleRatio = std::clamp(std::stof(GetOption(args, "--ratio", "0.5")), .01f, .99f);
+    config.Settings.MaxError = std::max(0.f, std::stof(GetOption(args, "--max-error", "0.05")));
+    config.OutputPath = GetOption(args, "--out", "");
+    return config;
+}
+
+// The LOD chain Model::Builder::GenerateLods builds for an OBJ file: the
+// triangles and error of every level and what it took to generate them. Also
+// checks that the levels only use the mesh's vertices, get coarser one after
+// the other and, past the full detail one, have no degenerate triangles.
+int RunLodBenchmark(const std::vector<std::string>& args)
+{
+    const LodBenchmarkConfig config = ParseConfig(args);
+    if (config.ObjPath.empty())
+    {
+        std::cerr << "lod: missing obj path\n";
+        return EXIT_FAILURE;
+    }
+
+    Model::Builder builder{};
+    builder.LoadFromObj(config.ObjPath);
+    builder.Optimize();
+    const size_t fullDetailIndexCount = builder.Indices.size();
+
+    auto start = Clock::now();
+    builder.GenerateLods(config.Settings);
+    const double generateMs = ElapsedMs(start);
+
+    std::vector<Model::LodLevel> lods = builder.Lods;
+    if (lods.empty())
+        lods.push_back({ 0, (uint32_t)fullDetailIndexCount, 0.f });
+
+    glm::vec3 min{ std::numeric_limits<float>::max() };
+    glm::vec3 max{ -std::numeric_limits<float>::max() };
+    for (const Model::Vertex& vertex : builder.Vertices)
+    {
+        min = glm::min(min, vertex.Position);
+        max = glm::max(max, vertex.Position);
+    }
+    const float extent = std::max({ max.x - min.x, max.y - min.y, max.z - min.z, 0.f });
+
+    bool valid = lods[0].FirstIndex == 0 && lods[0].IndexCount == fullDetailIndexCount;
+    for (size_t lod = 0; lod < lods.size() && valid; ++lod)
+    {
+        const Model::LodLevel& level = lods[lod];
+        valid = level.IndexCount % 3 == 0 && (size_t)level.FirstIndex + level.IndexCount <= builder.Indices.size();
+        if (lod > 0)
+            valid = valid && level.IndexCount < lods[lod - 1].IndexCount && level.Error >= lods[lod - 1].Error;
+
+        for (uint32_t i = level.FirstIndex; i < level.FirstIndex + level.IndexCount && valid; i += 3)
+        {
+            const uint32_t a = builder.Indices[i];
+            const uint32_t b = builder.Indices[i + 1];
+            const uint32_t c = builder.Indices[i + 2];
+            valid = a < builder.Vertices.size() && b < builder.Vertices.size() && c < builder.Vertices.size()
+                && (lod == 0 || (a != b && b != c && a != c));
+        }
+    }
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"lod\",\n"
+        << "  \"config\": { "
+        << "\"obj\": \"" << config.ObjPath << '"'
+        << ", \"levels\": " << config.Settings.LodCount
+        << ", \"ratio\": " << config.Settings.TriangleRatio
+        << ", \"max_error\": " << config.Settings.MaxError << " },\n"
+        << "  \"vertices\": " << builder.Vertices.size() << ",\n"
+        << "  \"generate_ms\": " << generateMs << ",\n"
+        << "  \"index_memory_growth\": " << (double)builder.Indices.size() / std::max<size_t>(fullDetailIndexCount, 1) << ",\n"
+        << "  \"levels\": [";
+    for (size_t lod = 0; lod < lods.size(); ++lod)
+    {
+        json << (lod == 0 ? "\n" : ",\n")
+            << "    { \"triangles\": " << lods[lod].IndexCount / 3
+            << ", \"triangle_ratio\": " << (double)lods[lod].IndexCount / std::max<size_t>(fullDetailIndexCount, 1)
+            << ", \"error\": " << lods[lod].Error
+            << ", \"relative_error\": " << (extent > 0.f ? lods[lod].Error / extent : 0.f) << " }";
+    }
+    json << "\n  ],\n"
+        << "  \"valid\": " << (valid ? "true" : "false") << "\n}\n";
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
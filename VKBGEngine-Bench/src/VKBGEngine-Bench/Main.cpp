@@ -0,0 +1,60 @@
+#include "Benchmark.h"
+
+struct BenchmarkEntry
+{
+    const char* Name;
+    const char* Usage;
+    vkbg::bench::BenchmarkFunc Run;
+};
+
+static const BenchmarkEntry s_Benchmarks[]{
+    { "mesh-cache", "<obj path> [--iterations I] [--out file.json]", vkbg::bench::RunMeshCacheBenchmark },
+    { "frame", "[--entities N] [--models M] [--frames F] [--warmup W] [--width W] [--height H] [--obj path]... [--window] [--parallel-recording] [--gpu-driven] [--float-vertices] [--out file.json]", vkbg::bench::RunFrameBenchmark },
+    { "transforms", "[--entities N] [--dynamic fraction] [--frames F] [--warmup W] [--out file.json]", vkbg::bench::RunTransformBenchmark },
+    { "transform-kernels", "[--entities N] [--iterations I] [--out file.json]", vkbg::bench::RunTransformKernelBenchmark },
+    { "jobs", "[--threads N] [--jobs J] [--elements E] [--iterations I] [--out file.json]", vkbg::bench::RunJobBenchmark },
+    { "draw-sort", "[--draws N] [--meshes M] [--iterations I] [--out file.json]", vkbg::bench::RunDrawSortBenchmark },
+    { "obj-load", "<obj path> [--threads N] [--iterations I] [--out file.json]", vkbg::bench::RunObjLoadBenchmark },
+    { "weld", "[--max-indices N] [--iterations I] [--out file.json]", vkbg::bench::RunWeldBenchmark },
+    { "mesh-optimize", "<obj path> [--cache-size N] [--no-overdraw] [--out file.json]", vkbg::bench::RunMeshOptimizeBenchmark },
+    { "lod", "<obj path> [--levels N] [--ratio R] [--max-error E] [--out file.json]", vkbg::bench::RunLodBenchmark },
+    { "vertex-quantize", "<obj path> [--iterations I] [--out file.json]", vkbg::bench::RunVertexQuantizeBenchmark },
+};
+
+static void PrintUsage()
+{
+    std::cerr << "usage: VKBGEngine-Bench <benchmark> [args...]\n";
+    for (const auto& benchmark : s_Benchmarks)
+        std::cerr << "\t" << benchmark.Name << ' ' << benchmark.Usage << '\n';
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string name = argv[1];
+    const std::vector<std::string> args(argv + 2, argv + argc);
+
+    for (const auto& benchmark : s_Benchmarks)
+    {
+        if (name != benchmark.Name)
+            continue;
+
+        try
+        {
+            return benchmark.Run(args);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    PrintUsage();
+    return EXIT_FAILURE;
+}
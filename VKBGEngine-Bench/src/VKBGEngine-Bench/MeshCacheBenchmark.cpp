@@ -0,0 +1,103 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Graphics/Model.h"
+#include "VKBGEngine-Core/Graphics/MeshCache.h"
+
+namespace vkbg::bench
+{
+struct MeshCacheBenchmarkConfig
+{
+    std::string ObjPath;
+    uint32_t Iterations{ 10 };
+    std::string OutputPath;
+};
+
+static MeshCacheBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    MeshCacheBenchmarkConfig config{};
+    config.ObjPath = args.empty() ? "" : args[0];
+    config.Iterations = std::max(1, std::stoi(GetOption(args, "--iterations", "10")));
+    config.OutputPath = GetOption(args, "--out", "");
+    return config;
+}
+
+// Cold: parse the OBJ with tinyobjloader, weld and optimize the mesh and write the cache.
+// Warm: map the cache and copy the arrays out, which is what the staging upload does.
+int RunMeshCacheBenchmark(const std::vector<std::string>& args)
+{
+    const MeshCacheBenchmarkConfig config = ParseConfig(args);
+    if (config.ObjPath.empty())
+    {
+        std::cerr << "mesh-cache: missing obj path\n";
+        return EXIT_FAILURE;
+    }
+
+    const std::string& objPath = config.ObjPath;
+    const auto cachePath = MeshCache::GetCachePath(objPath);
+
+    std::vector<double> coldSamples;
+    std::vector<double> warmSamples;
+    std::vector<uint8_t> staging;
+    size_t vertexCount{ 0 };
+    size_t indexCount{ 0 };
+
+    for (uint32_t i = 0; i < config.Iterations; ++i)
+    {
+        std::filesystem::remove(cachePath);
+
+        auto start = Clock::now();
+        Model::Builder builder{};
+        builder.LoadFromObj(objPath);
+        builder.Optimize();
+        builder.GenerateLods();
+        if (MeshCache::Store(objPath, builder) == false)
+            throw std::runtime_error("Failed to write the mesh cache");
+        coldSamples.push_back(ElapsedMs(start));
+
+        vertexCount = builder.Vertices.size();
+        indexCount = builder.Indices.size();
+    }
+
+    for (uint32_t i = 0; i < config.Iterations; ++i)
+    {
+        auto start = Clock::now();
+        MeshCacheEntry entry{};
+        if (MeshCache::Load(objPath, entry) == false)
+            throw std::runtime_error("Mesh cache miss on a warm load");
+
+        const size_t vertexBytes = entry.VertexCount * sizeof(Model::Vertex);
+        const size_t indexBytes = entry.IndexCount * sizeof(uint32_t);
+        staging.resize(vertexBytes + indexBytes);
+        memcpy(staging.data(), entry.Vertices, vertexBytes);
+        memcpy(staging.data() + vertexBytes, entry.Indices, indexBytes);
+        warmSamples.push_back(ElapsedMs(start));
+    }
+
+    SampleStats cold = ComputeStats(coldSamples);
+    SampleStats warm = ComputeStats(warmSamples);
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"mesh-cache\",\n"
+        << "  \"config\": { "
+        << "\"obj\": \"" << objPath << '"'
+        << ", \"iterations\": " << config.Iterations << " },\n"
+        << "  \"vertices\": " << vertexCount << ",\n"
+        << "  \"indices\": " << indexCount << ",\n  ";
+    WriteJsonStats(json, "cold_ms", cold);
+    json << ",\n  ";
+    WriteJsonStats(json, "warm_ms", warm);
+    json << ",\n"
+        << "  \"speedup\": " << (warm.Mean > 0.0 ? cold.Mean / warm.Mean : 0.0) << "\n}\n";
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return EXIT_SUCCESS;
+}
+}
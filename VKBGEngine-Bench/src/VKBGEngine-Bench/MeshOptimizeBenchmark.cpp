@@ -0,0 +1,122 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Graphics/Model.h"
+#include "VKBGEngine-Core/Graphics/MeshOptimizer.h"
+
+namespace vkbg::bench
+{
+struct MeshOptimizeBenchmarkConfig
+{
+    std::string ObjPath;
+    uint32_t CacheSize{ 16 };
+    bool OptimizeOverdraw{ true };
+    std::string OutputPath;
+};
+
+static MeshOptimizeBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    MeshOptimizeBenchmarkConfig config{};
+    config.ObjPath = args.empty() ? "" : args[0];
+    config.CacheSize = std::max(3, std::stoi(GetOption(args, "--cache-size", "16")));
+    config.OptimizeOverdraw = HasFlag(args, "--no-overdraw") == false;
+    config.OutputPath = GetOption(args, "--out", "");
+    return config;
+}
+
+// The triangles of the index buffer, each one rotated to start with its
+// smallest index (the winding is kept), sorted.
+static std::vector<std::array<uint32_t, 3>> GetSortedTriangles(const std::vector<uint32_t>& indices)
+{
+    std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+    for (size_t i = 0; i < triangles.size(); ++i)
+    {
+        std::array<uint32_t, 3> triangle{ indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2] };
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles[i] = triangle;
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+static void WriteJsonCacheStats(std::ostream& out, const char* name, const VertexCacheStats& stats)
+{
+    out << '"' << name << "\": { \"acmr\": " << stats.ACMR << ", \"atvr\": " << stats.ATVR << " }";
+}
+
+// What each stage of Model::Builder::Optimize costs and gains on an OBJ file,
+// in ACMR/ATVR simulated with a --cache-size FIFO cache. Also checks that the
+// optimized mesh draws the same triangles as the file.
+int RunMeshOptimizeBenchmark(const std::vector<std::string>& args)
+{
+    const MeshOptimizeBenchmarkConfig config = ParseConfig(args);
+    if (config.ObjPath.empty())
+    {
+        std::cerr << "mesh-optimize: missing obj path\n";
+        return EXIT_FAILURE;
+    }
+
+    Model::Builder builder{};
+    builder.LoadFromObj(config.ObjPath);
+    const std::vector<Model::Vertex> fileVertices = builder.Vertices;
+    const std::vector<uint32_t> fileIndices = builder.Indices;
+    std::vector<Model::Vertex>& vertices = builder.Vertices;
+    std::vector<uint32_t>& indices = builder.Indices;
+
+    auto analyze = [&]() { return AnalyzeVertexCache(indices.data(), indices.size(), vertices.size(), config.CacheSize); };
+    const VertexCacheStats fileStats = analyze();
+
+    auto start = Clock::now();
+    OptimizeVertexCache(indices.data(), indices.size(), vertices.size());
+    const double vertexCacheMs = ElapsedMs(start);
+    const VertexCacheStats vertexCacheStats = analyze();
+
+    start = Clock::now();
+    if (config.OptimizeOverdraw && indices.empty() == false)
+        OptimizeOverdraw(indices.data(), indices.size(), &vertices[0].Position.x, sizeof(Model::Vertex), vertices.size());
+    const double overdrawMs = ElapsedMs(start);
+    const VertexCacheStats overdrawStats = analyze();
+
+    bool matches = GetSortedTriangles(indices) == GetSortedTriangles(fileIndices);
+
+    const std::vector<uint32_t> reorderedIndices = indices;
+    start = Clock::now();
+    vertices.resize(OptimizeVertexFetch(vertices.data(), vertices.size(), sizeof(Model::Vertex), indices.data(), indices.size()));
+    const double vertexFetchMs = ElapsedMs(start);
+    const VertexCacheStats vertexFetchStats = analyze();
+
+    // the fetch reorder only renames the vertices
+    for (size_t i = 0; i < indices.size() && matches; ++i)
+        matches = vertices[indices[i]] == fileVertices[reorderedIndices[i]];
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"mesh-optimize\",\n"
+        << "  \"config\": { "
+        << "\"obj\": \"" << config.ObjPath << '"'
+        << ", \"cache_size\": " << config.CacheSize
+        << ", \"overdraw\": " << (config.OptimizeOverdraw ? "true" : "false") << " },\n"
+        << "  \"triangles\": " << indices.size() / 3 << ",\n"
+        << "  \"vertices\": " << fileVertices.size() << ",\n  ";
+    WriteJsonCacheStats(json, "file_order", fileStats);
+    json << ",\n  ";
+    WriteJsonCacheStats(json, "vertex_cache", vertexCacheStats);
+    json << ",\n  ";
+    WriteJsonCacheStats(json, "overdraw", overdrawStats);
+    json << ",\n  ";
+    WriteJsonCacheStats(json, "vertex_fetch", vertexFetchStats);
+    json << ",\n  \"vertex_cache_ms\": " << vertexCacheMs
+        << ",\n  \"overdraw_ms\": " << overdrawMs
+        << ",\n  \"vertex_fetch_ms\": " << vertexFetchMs
+        << ",\n  \"same_triangles\": " << (matches ? "true" : "false") << "\n}\n";
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return matches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
@@ -0,0 +1,160 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Graphics/Model.h"
+#include "VKBGEngine-Core/Threading/JobSystem.h"
+
+namespace vkbg::bench
+{
+struct ObjLoadBenchmarkConfig
+{
+    std::string ObjPath;
+    uint32_t ThreadCount{ 1 };
+    uint32_t IterationCount{ 5 };
+    std::string OutputPath;
+};
+
+static ObjLoadBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    ObjLoadBenchmarkConfig config{};
+    config.ObjPath = args.empty() ? "" : args[0];
+    const uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    config.ThreadCount = std::max(1, std::stoi(GetOption(args, "--threads", std::to_string(hardwareThreads))));
+    config.IterationCount = std::max(1, std::stoi(GetOption(args, "--iterations", "5")));
+    config.OutputPath = GetOption(args, "--out", "");
+    return config;
+}
+
+// Faces out of range of every kind the loaders skip: triangles and quads with
+// a position out of range, and with a normal out of range.
+static constexpr const char* InvalidIndexObj =
+    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+    "vt 0 0\nvn 0 0 1\n"
+    "f 1/1/1 2/1/1 3/1/1\n"
+    "f 1 2 9\n"
+    "f 1//1 2//5 3//1\n"
+    "f 1 2 3 9\n"
+    "f 1//1 2//1 3//1 4//7\n"
+    "f 2/1/1 3/1/1 4/1/1\n";
+
+// Throughput of Model::Builder::LoadFromObj, tinyobjloader against the parallel
+// parser on --threads threads, and whether both build the same mesh. Also
+// loads the file on 1, 2, 4... threads and checks that the welder probes per
+// corner stay flat: the welding partitions mustn't cluster the welder tables.
+// Both loaders also have to skip the same faces out of range.
+int RunObjLoadBenchmark(const std::vector<std::string>& args)
+{
+    const ObjLoadBenchmarkConfig config = ParseConfig(args);
+    if (config.ObjPath.empty() || config.ObjPath.starts_with("--"))
+    {
+        std::cerr << "obj-load: missing obj path\n";
+        return EXIT_FAILURE;
+    }
+
+    constexpr double bytesPerMb = 1024.0 * 1024.0;
+    const double fileMb = std::filesystem::file_size(config.ObjPath) / bytesPerMb;
+    JobSystem jobSystem{ config.ThreadCount - 1 };
+
+    std::vector<double> serialMs;
+    std::vector<double> parallelMs;
+    Model::Builder serial{};
+    Model::Builder parallel{};
+    for (uint32_t iteration = 0; iteration < config.IterationCount; ++iteration)
+    {
+        auto start = Clock::now();
+        serial.LoadFromObj(config.ObjPath);
+        serialMs.push_back(ElapsedMs(start));
+
+        start = Clock::now();
+        parallel.LoadFromObj(config.ObjPath, &jobSystem);
+        parallelMs.push_back(ElapsedMs(start));
+    }
+    const bool matches = serial.Vertices == parallel.Vertices && serial.Indices == parallel.Indices;
+
+    // the tables are sized the same way whatever the partition, so the probes
+    // only move with their load factor, not with the number of partitions
+    constexpr double MaxProbeSpread = 1.5;
+    std::vector<uint32_t> probeThreadCounts;
+    for (uint32_t threadCount = 1; threadCount <= std::max(config.ThreadCount, 8u); threadCount *= 2)
+        probeThreadCounts.push_back(threadCount);
+    if (std::find(probeThreadCounts.begin(), probeThreadCounts.end(), config.ThreadCount) == probeThreadCounts.end())
+        probeThreadCounts.push_back(config.ThreadCount);
+
+    std::vector<std::pair<Model::ObjLoadStats, uint32_t>> probeStats;
+    probeStats.push_back({ Model::Builder{}.LoadFromObj(config.ObjPath), 1 });
+    for (uint32_t threadCount : probeThreadCounts)
+    {
+        JobSystem probeJobSystem{ threadCount - 1 };
+        probeStats.push_back({ Model::Builder{}.LoadFromObj(config.ObjPath, &probeJobSystem), threadCount });
+    }
+    auto getProbesPerCorner = [](const Model::ObjLoadStats& stats)
+    {
+        return (double)stats.WeldProbeCount / std::max<uint64_t>(stats.CornerCount, 1);
+    };
+    double minProbes = std::numeric_limits<double>::max();
+    double maxProbes = 0.0;
+    for (const auto& [stats, threadCount] : probeStats)
+    {
+        minProbes = std::min(minProbes, getProbesPerCorner(stats));
+        maxProbes = std::max(maxProbes, getProbesPerCorner(stats));
+    }
+    const bool probesFlat = maxProbes <= MaxProbeSpread * minProbes;
+
+    const std::filesystem::path invalidPath = std::filesystem::temp_directory_path() / "vkbg_invalid_indices.obj";
+    {
+        std::ofstream file(invalidPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + invalidPath.string());
+        file << InvalidIndexObj;
+    }
+    Model::Builder invalidSerial{};
+    Model::Builder invalidParallel{};
+    const Model::ObjLoadStats invalidSerialStats = invalidSerial.LoadFromObj(invalidPath.string());
+    const Model::ObjLoadStats invalidParallelStats = invalidParallel.LoadFromObj(invalidPath.string(), &jobSystem);
+    std::filesystem::remove(invalidPath);
+    const bool invalidMatches = invalidParallelStats.Parallel
+        && invalidSerialStats.SkippedTriangleCount > 0
+        && invalidSerial.Indices.empty() == false
+        && invalidSerial.Vertices == invalidParallel.Vertices && invalidSerial.Indices == invalidParallel.Indices;
+
+    const SampleStats serialStats = ComputeStats(serialMs);
+    const SampleStats parallelStats = ComputeStats(parallelMs);
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"obj-load\",\n"
+        << "  \"config\": { "
+        << "\"obj\": \"" << config.ObjPath << '"'
+        << ", \"file_mb\": " << fileMb
+        << ", \"threads\": " << config.ThreadCount
+        << ", \"iterations\": " << config.IterationCount << " },\n"
+        << "  \"vertices\": " << parallel.Vertices.size() << ",\n"
+        << "  \"indices\": " << parallel.Indices.size() << ",\n  ";
+    WriteJsonStats(json, "serial_ms", serialStats);
+    json << ",\n  \"serial_mb_per_s\": " << fileMb / (serialStats.Mean / 1000.0) << ",\n  ";
+    WriteJsonStats(json, "parallel_ms", parallelStats);
+    json << ",\n  \"parallel_mb_per_s\": " << fileMb / (parallelStats.Mean / 1000.0)
+        << ",\n  \"speedup\": " << serialStats.Mean / parallelStats.Mean
+        << ",\n  \"weld_probes\": [";
+    for (size_t i = 0; i < probeStats.size(); ++i)
+    {
+        const auto& [stats, threadCount] = probeStats[i];
+        json << (i == 0 ? "\n" : ",\n")
+            << "    { \"threads\": " << threadCount
+            << ", \"parallel\": " << (stats.Parallel ? "true" : "false")
+            << ", \"probes_per_corner\": " << getProbesPerCorner(stats) << " }";
+    }
+    json << "\n  ],\n  \"probes_flat\": " << (probesFlat ? "true" : "false")
+        << ",\n  \"matches_serial\": " << (matches ? "true" : "false")
+        << ",\n  \"invalid_indices_matches_serial\": " << (invalidMatches ? "true" : "false") << "\n}\n";
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return matches && probesFlat && invalidMatches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
@@ -0,0 +1,133 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Entities/Scene.h"
+
+namespace vkbg::bench
+{
+struct TransformBenchmarkConfig
+{
+    uint32_t EntityCount{ 100000 };
+    // fraction of the entities that move every frame
+    float DynamicFraction{ .01f };
+    uint32_t FrameCount{ 500 };
+    uint32_t WarmupFrameCount{ 50 };
+    std::string OutputPath;
+};
+
+static TransformBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    TransformBenchmarkConfig config{};
+    config.EntityCount = std::max(1, std::stoi(GetOption(args, "--entities", "100000")));
+    config.DynamicFraction = std::clamp(std::stof(GetOption(args, "--dynamic", "0.01")), 0.f, 1.f);
+    config.FrameCount = std::max(1, std::stoi(GetOption(args, "--frames", "500")));
+    config.WarmupFrameCount = std::max(0, std::stoi(GetOption(args, "--warmup", "50")));
+    config.OutputPath = GetOption(args, "--out", "");
+    return config;
+}
+
+static glm::vec3 GetRotation(uint32_t entity, uint32_t frame)
+{
+    return { 0.f, Hash01(entity) * glm::two_pi<float>() + frame * .01f, 0.f };
+}
+
+// Per-frame cost of the entity transforms in a mostly static scene, computed the
+// way the renderer used to (every matrix of every entity, every frame) and with
+// the cached matrices of the Scene (only the entities that moved).
+int RunTransformBenchmark(const std::vector<std::string>& args)
+{
+    const TransformBenchmarkConfig config = ParseConfig(args);
+
+    Scene scene{};
+    std::vector<TransformComponent> transforms(config.EntityCount);
+    std::vector<EntityHandle> dynamicEntities;
+    std::vector<uint32_t> dynamicIndices;
+    for (uint32_t i = 0; i < config.EntityCount; ++i)
+    {
+        TransformComponent& transform = transforms[i];
+        transform.Translation = { Hash01(i * 3) * 100.f, Hash01(i * 3 + 1) * 100.f, Hash01(i * 3 + 2) * 100.f };
+        transform.Rotation = GetRotation(i, 0);
+        transform.Scale = glm::vec3{ .5f + Hash01(i + config.EntityCount) };
+
+        EntityHandle entity = scene.CreateEntity();
+        scene.SetTranslation(entity, transform.Translation);
+        scene.SetRotation(entity, transform.Rotation);
+        scene.SetScale(entity, transform.Scale);
+
+        if (Hash01(i + 2 * config.EntityCount) < config.DynamicFraction)
+        {
+            dynamicEntities.push_back(entity);
+            dynamicIndices.push_back(i);
+        }
+    }
+    scene.UpdateDirtyTransforms();
+
+    std::vector<glm::mat4> worldMatrices(config.EntityCount);
+    std::vector<glm::mat4> normalMatrices(config.EntityCount);
+    std::vector<double> recomputeAllMs;
+    std::vector<double> dirtyUpdateMs;
+    std::vector<double> updatedTransforms;
+    recomputeAllMs.reserve(config.FrameCount);
+    dirtyUpdateMs.reserve(config.FrameCount);
+    // read back so that the compiler can't drop the work
+    float checksum = 0.f;
+
+    for (uint32_t frame = 1; frame <= config.WarmupFrameCount + config.FrameCount; ++frame)
+    {
+        auto start = Clock::now();
+        for (uint32_t i : dynamicIndices)
+            transforms[i].Rotation = GetRotation(i, frame);
+        for (uint32_t i = 0; i < config.EntityCount; ++i)
+        {
+            worldMatrices[i] = transforms[i].GetTransform();
+            normalMatrices[i] = glm::mat4{ transforms[i].GetNormalMatrix() };
+        }
+        double recomputeElapsed = ElapsedMs(start);
+        checksum += worldMatrices[frame % config.EntityCount][0][0] + normalMatrices[frame % config.EntityCount][1][1];
+
+        start = Clock::now();
+        for (size_t i = 0; i < dynamicEntities.size(); ++i)
+            scene.SetRotation(dynamicEntities[i], GetRotation(dynamicIndices[i], frame));
+        uint32_t updated = scene.UpdateDirtyTransforms();
+        double dirtyElapsed = ElapsedMs(start);
+        checksum += scene.GetWorldMatrices()[frame % config.EntityCount][0][0];
+
+        if (frame <= config.WarmupFrameCount)
+            continue;
+
+        recomputeAllMs.push_back(recomputeElapsed);
+        dirtyUpdateMs.push_back(dirtyElapsed);
+        updatedTransforms.push_back(updated);
+    }
+
+    const SampleStats recomputeStats = ComputeStats(recomputeAllMs);
+    const SampleStats dirtyStats = ComputeStats(dirtyUpdateMs);
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"transforms\",\n"
+        << "  \"config\": { "
+        << "\"entities\": " << config.EntityCount
+        << ", \"dynamic_fraction\": " << config.DynamicFraction
+        << ", \"dynamic_entities\": " << dynamicEntities.size()
+        << ", \"frames\": " << config.FrameCount
+        << ", \"warmup\": " << config.WarmupFrameCount << " },\n  ";
+    WriteJsonStats(json, "recompute_all_ms", recomputeStats);
+    json << ",\n  ";
+    WriteJsonStats(json, "dirty_update_ms", dirtyStats);
+    json << ",\n  ";
+    WriteJsonStats(json, "updated_transforms", ComputeStats(updatedTransforms));
+    json << ",\n"
+        << "  \"speedup_mean\": " << (dirtyStats.Mean > 0.0 ? recomputeStats.Mean / dirtyStats.Mean : 0.0) << ",\n"
+        << "  \"checksum\": " << checksum << "\n}\n";
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return EXIT_SUCCESS;
+}
+}
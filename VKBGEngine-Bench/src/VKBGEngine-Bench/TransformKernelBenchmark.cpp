@@ -0,0 +1,121 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Entities/Entity.h"
+#include "VKBGEngine-Core/Math/TransformKernels.h"
+
+namespace vkbg::bench
+{
+struct TransformKernel
+{
+    const char* Name;
+    void(*Compute)(const TransformBatch& batch);
+};
+
+static float MaxAbsError(const std::vector<glm::mat4>& reference, const std::vector<glm::mat4>& values)
+{
+    float maxError = 0.f;
+    for (size_t i = 0; i < reference.size(); ++i)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            for (int row = 0; row < 4; ++row)
+                maxError = std::max(maxError, std::abs(reference[i][column][row] - values[i][column][row]));
+        }
+    }
+    return maxError;
+}
+
+// Time per entity of the batch transform kernels, against the matrices of
+// TransformComponent computed one at a time (the reference for the error).
+int RunTransformKernelBenchmark(const std::vector<std::string>& args)
+{
+    const uint32_t entityCount = std::max(1, std::stoi(GetOption(args, "--entities", "100000")));
+    const uint32_t iterations = std::max(1, std::stoi(GetOption(args, "--iterations", "200")));
+    const std::string outputPath = GetOption(args, "--out", "");
+
+    std::vector<glm::vec3> translations(entityCount);
+    std::vector<glm::vec3> rotations(entityCount);
+    std::vector<glm::vec3> scales(entityCount);
+    for (uint32_t i = 0; i < entityCount; ++i)
+    {
+        translations[i] = { Hash01(i * 9) * 100.f, Hash01(i * 9 + 1) * 100.f, Hash01(i * 9 + 2) * 100.f };
+        // a few turns either way, well inside the range the kernels are accurate for
+        rotations[i] = glm::vec3{ Hash01(i * 9 + 3) - .5f, Hash01(i * 9 + 4) - .5f, Hash01(i * 9 + 5) - .5f } * 40.f;
+        scales[i] = { .5f + Hash01(i * 9 + 6), .5f + Hash01(i * 9 + 7), .5f + Hash01(i * 9 + 8) };
+    }
+
+    std::vector<glm::mat4> referenceWorld(entityCount);
+    std::vector<glm::mat4> referenceNormal(entityCount);
+    std::vector<double> referenceNs;
+    for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        auto start = Clock::now();
+        for (uint32_t i = 0; i < entityCount; ++i)
+        {
+            referenceWorld[i] = TransformComponent::ComputeTransform(translations[i], rotations[i], scales[i]);
+            referenceNormal[i] = glm::mat4{ TransformComponent::ComputeNormalMatrix(rotations[i], scales[i]) };
+        }
+        referenceNs.push_back(ElapsedMs(start) * 1e6 / entityCount);
+    }
+
+    std::vector<TransformKernel> kernels{ { "scalar", ComputeTransformsScalar } };
+#if defined(VKBG_SIMD_SSE)
+    kernels.push_back({ "sse", ComputeTransformsSse });
+#endif
+#if defined(VKBG_SIMD_AVX)
+    if (simd::HasAvx2())
+        kernels.push_back({ "avx2", ComputeTransformsAvx2 });
+#endif
+
+    std::vector<glm::mat4> worldMatrices(entityCount);
+    std::vector<glm::mat4> normalMatrices(entityCount);
+    const TransformBatch batch{
+        .Translations = translations.data(),
+        .Rotations = rotations.data(),
+        .Scales = scales.data(),
+        .WorldMatrices = worldMatrices.data(),
+        .NormalMatrices = normalMatrices.data(),
+        .Count = entityCount
+    };
+
+    const SampleStats referenceStats = ComputeStats(referenceNs);
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"transform-kernels\",\n"
+        << "  \"config\": { \"entities\": " << entityCount << ", \"iterations\": " << iterations << " },\n  ";
+    WriteJsonStats(json, "per_entity_ns", referenceStats);
+
+    json << ",\n  \"kernels\": {";
+    for (size_t k = 0; k < kernels.size(); ++k)
+    {
+        std::vector<double> kernelNs;
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration)
+        {
+            auto start = Clock::now();
+            kernels[k].Compute(batch);
+            kernelNs.push_back(ElapsedMs(start) * 1e6 / entityCount);
+        }
+
+        const SampleStats stats = ComputeStats(kernelNs);
+        json << (k == 0 ? "\n    \"" : ",\n    \"") << kernels[k].Name << "\": {\n      ";
+        WriteJsonStats(json, "per_entity_ns", stats);
+        json << std::scientific << std::setprecision(3)
+            << ",\n      \"max_abs_error_world\": " << MaxAbsError(referenceWorld, worldMatrices)
+            << ",\n      \"max_abs_error_normal\": " << MaxAbsError(referenceNormal, normalMatrices)
+            << std::fixed << std::setprecision(4)
+            << ",\n      \"speedup_mean\": " << (stats.Mean > 0.0 ? referenceStats.Mean / stats.Mean : 0.0)
+            << "\n    }";
+    }
+    json << "\n  }\n}\n";
+
+    std::cout << json.str();
+    if (outputPath.empty() == false)
+    {
+        std::ofstream file(outputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + outputPath);
+        file << json.str();
+    }
+    return EXIT_SUCCESS;
+}
+}
@@ -0,0 +1,155 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Graphics/Model.h"
+
+namespace vkbg::bench
+{
+struct VertexQuantizeBenchmarkConfig
+{
+    std::string ObjPath;
+    uint32_t Iterations{ 10 };
+    std::string OutputPath;
+};
+
+static VertexQuantizeBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    VertexQuantizeBenchmarkConfig config{};
+    config.ObjPath = args.empty() ? "" : args[0];
+    config.Iterations = std::max(1, std::stoi(GetOption(args, "--iterations", "10")));
+    config.OutputPath = GetOption(args, "--out", "");
+    return config;
+}
+
+static const char* GetLayoutName(VertexLayout layout)
+{
+    switch (layout)
+    {
+    case VertexLayout::Float: return "float";
+    case VertexLayout::Quantized: return "quantized";
+    case VertexLayout::QuantizedColor: return "quantized_color";
+    default: return "unknown";
+    }
+}
+
+// The vertices of an OBJ file in the layout Model::GetCompactLayout picks for
+// them (QuantizedColor when it keeps the float one): their size against the
+// float layout, the time Model::QuantizeVertices takes and the largest error
+// of the decoded attributes. Checks that the positions are within a unorm
+// step, the normals within a tenth of a degree and the UVs within half float
+// precision.
+int RunVertexQuantizeBenchmark(const std::vector<std::string>& args)
+{
+    const VertexQuantizeBenchmarkConfig config = ParseConfig(args);
+    if (config.ObjPath.empty())
+    {
+        std::cerr << "vertex-quantize: missing obj path\n";
+        return EXIT_FAILURE;
+    }
+
+    Model::Builder builder{};
+    builder.LoadFromObj(config.ObjPath);
+    const std::vector<Model::Vertex>& vertices = builder.Vertices;
+    const uint32_t vertexCount = (uint32_t)vertices.size();
+    if (vertexCount == 0)
+    {
+        std::cerr << "vertex-quantize: " << config.ObjPath << " has no vertices\n";
+        return EXIT_FAILURE;
+    }
+
+    const VertexLayout compactLayout = Model::GetCompactLayout(vertices.data(), vertexCount);
+    const VertexLayout layout = compactLayout == VertexLayout::Float ? VertexLayout::QuantizedColor : compactLayout;
+
+    // the offset and scale Model uses
+    glm::vec3 min{ std::numeric_limits<float>::max() };
+    glm::vec3 max{ -std::numeric_limits<float>::max() };
+    for (const Model::Vertex& vertex : vertices)
+    {
+        min = glm::min(min, vertex.Position);
+        max = glm::max(max, vertex.Position);
+    }
+    const glm::vec3 extent = max - min;
+    const float maxExtent = std::max({ extent.x, extent.y, extent.z });
+    const float scale = maxExtent > 0.f ? maxExtent : 1.f;
+
+    std::vector<double> quantizeMs;
+    std::vector<uint8_t> quantized;
+    for (uint32_t i = 0; i < config.Iterations; ++i)
+    {
+        auto start = Clock::now();
+        quantized = Model::QuantizeVertices(vertices.data(), vertexCount, layout, min, scale);
+        quantizeMs.push_back(ElapsedMs(start));
+    }
+
+    const uint32_t vertexSize = GetVertexSize(layout);
+    float maxPositionError = 0.f;
+    float maxNormalErrorDegrees = 0.f;
+    float maxUVError = 0.f;
+    bool valid = quantized.size() == (size_t)vertexCount * vertexSize;
+    for (uint32_t i = 0; i < vertexCount && valid; ++i)
+    {
+        QuantizedVertex decoded{};
+        memcpy(&decoded, quantized.data() + (size_t)i * vertexSize, vertexSize);
+        const Model::Vertex& vertex = vertices[i];
+
+        const glm::vec3 position = min + scale * glm::vec3{
+            decoded.Position[0] / 65535.f, decoded.Position[1] / 65535.f, decoded.Position[2] / 65535.f };
+        const float positionError = glm::length(position - vertex.Position);
+        maxPositionError = std::max(maxPositionError, positionError);
+
+        // meshes without normals have zeros, there is no direction to compare
+        const float normalLength = glm::length(vertex.Normal);
+        if (normalLength > 0.f)
+        {
+            const glm::vec3 normal = DecodeOctahedral({
+                std::max(decoded.Normal[0] / 32767.f, -1.f), std::max(decoded.Normal[1] / 32767.f, -1.f) });
+            const float cosAngle = std::clamp(glm::dot(normal, vertex.Normal / normalLength), -1.f, 1.f);
+            maxNormalErrorDegrees = std::max(maxNormalErrorDegrees, glm::degrees(std::acos(cosAngle)));
+        }
+
+        // a half float keeps 11 significant bits
+        const glm::vec2 uv{ glm::unpackHalf1x16(decoded.UV[0]), glm::unpackHalf1x16(decoded.UV[1]) };
+        const glm::vec2 uvError = glm::abs(uv - vertex.UV);
+        const glm::vec2 uvTolerance = glm::max(glm::abs(vertex.UV), glm::vec2{ 6.1e-5f }) / 1024.f;
+        maxUVError = std::max({ maxUVError, uvError.x, uvError.y });
+
+        // one unorm step on each axis, and a bit of float rounding
+        valid = positionError <= std::sqrt(3.f) * scale / 65535.f * 1.01f
+            && uvError.x <= uvTolerance.x && uvError.y <= uvTolerance.y;
+    }
+    valid = valid && maxNormalErrorDegrees <= .1f;
+
+    const uint64_t floatBytes = (uint64_t)vertexCount * GetVertexSize(VertexLayout::Float);
+    const uint64_t quantizedBytes = (uint64_t)vertexCount * vertexSize;
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"vertex-quantize\",\n"
+        << "  \"config\": { "
+        << "\"obj\": \"" << config.ObjPath << '"'
+        << ", \"iterations\": " << config.Iterations << " },\n"
+        << "  \"vertices\": " << vertexCount << ",\n"
+        << "  \"compact_layout\": \"" << GetLayoutName(compactLayout) << "\",\n"
+        << "  \"measured_layout\": \"" << GetLayoutName(layout) << "\",\n"
+        << "  \"float_bytes\": " << floatBytes << ",\n"
+        << "  \"quantized_bytes\": " << quantizedBytes << ",\n"
+        << "  \"size_ratio\": " << (double)quantizedBytes / floatBytes << ",\n  ";
+    WriteJsonStats(json, "quantize_ms", ComputeStats(quantizeMs));
+    json << ",\n"
+        << std::setprecision(8)
+        << "  \"max_position_error\": " << maxPositionError << ",\n"
+        << "  \"relative_position_error\": " << maxPositionError / scale << ",\n"
+        << "  \"max_normal_error_degrees\": " << maxNormalErrorDegrees << ",\n"
+        << "  \"max_uv_error\": " << maxUVError << ",\n"
+        << "  \"valid\": " << (valid ? "true" : "false") << "\n}\n";
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
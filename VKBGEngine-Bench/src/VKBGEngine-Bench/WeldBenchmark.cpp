@@ -0,0 +1,161 @@
+#include "Benchmark.h"
+#include "VKBGEngine-Core/Graphics/Model.h"
+#include "VKBGEngine-Core/Graphics/VertexWelder.h"
+#include "VKBGEngine-Core/Helper.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/hash.hpp"
+
+namespace vkbg::bench
+{
+struct WeldBenchmarkConfig
+{
+    uint32_t MaxIndexCount{ 10000000 };
+    uint32_t IterationCount{ 5 };
+    std::string OutputPath;
+};
+
+static WeldBenchmarkConfig ParseConfig(const std::vector<std::string>& args)
+{
+    WeldBenchmarkConfig config{};
+    config.MaxIndexCount = std::max(1, std::stoi(GetOption(args, "--max-indices", "10000000")));
+    config.IterationCount = std::max(1, std::stoi(GetOption(args, "--iterations", "5")));
+    config.OutputPath = GetOption(args, "--out", "");
+    return config;
+}
+
+// The hash the OBJ loader used with its std::unordered_map before VertexWelder.
+struct MapVertexHash
+{
+    size_t operator()(const Model::Vertex& vertex) const
+    {
+        size_t seed = 0;
+        HashCombine(seed, vertex.Position, vertex.Color, vertex.Normal, vertex.UV);
+        return seed;
+    }
+};
+
+// A grid of quads as an OBJ loader sees it: every corner is a full vertex and
+// an inner grid vertex is shared by six of them.
+struct WeldMesh
+{
+    std::vector<Model::Vertex> GridVertices;
+    std::vector<uint32_t> Corners;
+};
+
+static WeldMesh MakeGridMesh(uint32_t indexCount)
+{
+    const uint32_t side = std::max(1u, (uint32_t)std::sqrt(indexCount / 6.0));
+    WeldMesh mesh{};
+    mesh.GridVertices.resize((side + 1) * (side + 1));
+    for (uint32_t y = 0; y <= side; ++y)
+    {
+        for (uint32_t x = 0; x <= side; ++x)
+        {
+            const uint32_t index = y * (side + 1) + x;
+            const glm::vec2 uv{ x / float(side), y / float(side) };
+            mesh.GridVertices[index] = {
+                .Position = { uv.x, Hash01(index), uv.y },
+                .Color = { 1.f, 1.f, 1.f },
+                .Normal = { 0.f, 1.f, 0.f },
+                .UV = uv
+            };
+        }
+    }
+
+    mesh.Corners.reserve(indexCount);
+    for (uint32_t quad = 0; mesh.Corners.size() + 6 <= indexCount; ++quad)
+    {
+        const uint32_t x = quad % side;
+        const uint32_t y = (quad / side) % side;
+        const uint32_t corner = y * (side + 1) + x;
+        mesh.Corners.insert(mesh.Corners.end(), {
+            corner, corner + side + 1, corner + 1,
+            corner + 1, corner + side + 1, corner + side + 2 });
+    }
+    return mesh;
+}
+
+// VertexWelder against the std::unordered_map the OBJ loader used to weld with,
+// on grid meshes from 10k indices up to --max-indices, ten times bigger each.
+int RunWeldBenchmark(const std::vector<std::string>& args)
+{
+    const WeldBenchmarkConfig config = ParseConfig(args);
+
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(4)
+        << "{\n"
+        << "  \"benchmark\": \"weld\",\n"
+        << "  \"config\": { "
+        << "\"max_indices\": " << config.MaxIndexCount
+        << ", \"iterations\": " << config.IterationCount << " },\n"
+        << "  \"meshes\": [";
+
+    bool matches = true;
+    bool firstMesh = true;
+    for (uint64_t indexCount = 10000; indexCount <= config.MaxIndexCount; indexCount *= 10)
+    {
+        const WeldMesh mesh = MakeGridMesh((uint32_t)indexCount);
+
+        std::vector<double> mapMs;
+        std::vector<double> welderMs;
+        size_t vertexCount = 0;
+        for (uint32_t iteration = 0; iteration < config.IterationCount; ++iteration)
+        {
+            std::vector<Model::Vertex> mapVertices;
+            std::vector<uint32_t> mapIndices;
+            auto start = Clock::now();
+            {
+                std::unordered_map<Model::Vertex, uint32_t, MapVertexHash> uniqueVertices{};
+                for (uint32_t corner : mesh.Corners)
+                {
+                    const Model::Vertex& vertex = mesh.GridVertices[corner];
+                    if (uniqueVertices.count(vertex) == 0)
+                    {
+                        uniqueVertices[vertex] = (uint32_t)mapVertices.size();
+                        mapVertices.push_back(vertex);
+                    }
+                    mapIndices.push_back(uniqueVertices[vertex]);
+                }
+            }
+            mapMs.push_back(ElapsedMs(start));
+
+            std::vector<uint32_t> welderIndices;
+            start = Clock::now();
+            VertexWelder welder{ sizeof(Model::Vertex), mesh.Corners.size() };
+            welderIndices.reserve(mesh.Corners.size());
+            for (uint32_t corner : mesh.Corners)
+                welderIndices.push_back(welder.Weld(&mesh.GridVertices[corner]));
+            welderMs.push_back(ElapsedMs(start));
+
+            vertexCount = welder.GetVertexCount();
+            matches = matches
+                && welderIndices == mapIndices
+                && vertexCount == mapVertices.size()
+                && std::memcmp(welder.GetVertices(), mapVertices.data(), vertexCount * sizeof(Model::Vertex)) == 0;
+        }
+
+        const SampleStats mapStats = ComputeStats(mapMs);
+        const SampleStats welderStats = ComputeStats(welderMs);
+        json << (firstMesh ? "\n" : ",\n")
+            << "    { \"indices\": " << mesh.Corners.size()
+            << ", \"vertices\": " << vertexCount << ",\n      ";
+        WriteJsonStats(json, "unordered_map_ms", mapStats);
+        json << ",\n      ";
+        WriteJsonStats(json, "vertex_welder_ms", welderStats);
+        json << ",\n      \"speedup\": " << mapStats.Mean / welderStats.Mean << " }";
+        firstMesh = false;
+    }
+    json << "\n  ],\n  \"matches_unordered_map\": " << (matches ? "true" : "false") << "\n}\n";
+
+    std::cout << json.str();
+    if (config.OutputPath.empty() == false)
+    {
+        std::ofstream file(config.OutputPath, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("Failed to open " + config.OutputPath);
+        file << json.str();
+    }
+    return matches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// Standard Library
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <exception>
+
+// Data Structures
+#include <string>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <span>
+#include <array>
+#include <unordered_map>
+#include <unordered_set>
+
+// File System
+#include <filesystem>
+#include <fstream>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
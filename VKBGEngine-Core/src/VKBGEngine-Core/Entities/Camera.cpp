@@ -53,4 +53,28 @@ void Camera::SetViewYXZ(glm::vec3 position, glm::vec3 rotation)
     m_ViewMatrix[3][1] = -glm::dot(v, position);
     m_ViewMatrix[3][2] = -glm::dot(w, position);
 }
+
+Frustum Camera::GetFrustum() const
+{
+    // Gribb/Hartmann plane extraction. The projection maps depth to [0, 1]
+    // (GLM_FORCE_DEPTH_ZERO_TO_ONE), so the near plane is row 2 alone instead of row 3 + row 2.
+    const glm::mat4 m = m_ProjectionMatrix * m_ViewMatrix;
+    const glm::vec4 row0{ m[0][0], m[1][0], m[2][0], m[3][0] };
+    const glm::vec4 row1{ m[0][1], m[1][1], m[2][1], m[3][1] };
+    const glm::vec4 row2{ m[0][2], m[1][2], m[2][2], m[3][2] };
+    const glm::vec4 row3{ m[0][3], m[1][3], m[2][3], m[3][3] };
+
+    Frustum frustum{};
+    frustum.Planes[Frustum::Left] = row3 + row0;
+    frustum.Planes[Frustum::Right] = row3 - row0;
+    frustum.Planes[Frustum::Bottom] = row3 + row1;
+    frustum.Planes[Frustum::Top] = row3 - row1;
+    frustum.Planes[Frustum::Near] = row2;
+    frustum.Planes[Frustum::Far] = row3 - row2;
+
+    for (auto& plane : frustum.Planes)
+        plane /= glm::length(glm::vec3(plane));
+
+    return frustum;
+}
 }
@@ -2,6 +2,14 @@
 
 namespace vkbg
 {
+// Planes are stored as (normal, distance) with normals pointing inside, so a
+// point p is inside a plane when dot(normal, p) + distance >= 0.
+struct Frustum
+{
+    enum Side { Left = 0, Right, Bottom, Top, Near, Far, Count };
+    std::array<glm::vec4, Side::Count> Planes;
+};
+
 class Camera
 {
 public:
@@ -32,6 +40,9 @@ public:
     const glm::mat4& GetProjectionMatrix() const { return m_ProjectionMatrix; }
     const glm::mat4& GetViewMatrix() const { return m_ViewMatrix; }
 
+    // World space frustum extracted from projection * view.
+    Frustum GetFrustum() const;
+
 private:
     glm::mat4 m_ProjectionMatrix{ 1.f };
     glm::mat4 m_ViewMatrix{ 1.f };
@@ -4,45 +4,53 @@
 
 namespace vkbg
 {
-glm::mat4 vkbg::TransformComponent::GetTransform()
+float TransformComponent::GetMaxScale(const glm::mat4& worldMatrix)
 {
-    const float c3 = glm::cos(Rotation.z);
-    const float s3 = glm::sin(Rotation.z);
-    const float c2 = glm::cos(Rotation.x);
-    const float s2 = glm::sin(Rotation.x);
-    const float c1 = glm::cos(Rotation.y);
-    const float s1 = glm::sin(Rotation.y);
+    return std::sqrt(std::max({
+        glm::dot(worldMatrix[0], worldMatrix[0]),
+        glm::dot(worldMatrix[1], worldMatrix[1]),
+        glm::dot(worldMatrix[2], worldMatrix[2]) }));
+}
+
+glm::mat4 TransformComponent::ComputeTransform(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale)
+{
+    const float c3 = glm::cos(rotation.z);
+    const float s3 = glm::sin(rotation.z);
+    const float c2 = glm::cos(rotation.x);
+    const float s2 = glm::sin(rotation.x);
+    const float c1 = glm::cos(rotation.y);
+    const float s1 = glm::sin(rotation.y);
     return glm::mat4{
         {
-            Scale.x * (c1 * c3 + s1 * s2 * s3),
-            Scale.x * (c2 * s3),
-            Scale.x * (c1 * s2 * s3 - c3 * s1),
+            scale.x * (c1 * c3 + s1 * s2 * s3),
+            scale.x * (c2 * s3),
+            scale.x * (c1 * s2 * s3 - c3 * s1),
             0.0f,
         },
         {
-            Scale.y * (c3 * s1 * s2 - c1 * s3),
-            Scale.y * (c2 * c3),
-            Scale.y * (c1 * c3 * s2 + s1 * s3),
+            scale.y * (c3 * s1 * s2 - c1 * s3),
+            scale.y * (c2 * c3),
+            scale.y * (c1 * c3 * s2 + s1 * s3),
             0.0f,
         },
         {
-            Scale.z * (c2 * s1),
-            Scale.z * (-s2),
-            Scale.z * (c1 * c2),
+            scale.z * (c2 * s1),
+            scale.z * (-s2),
+            scale.z * (c1 * c2),
             0.0f,
         },
-        {Translation.x, Translation.y, Translation.z, 1.0f}
+        {translation.x, translation.y, translation.z, 1.0f}
     };
 }
-glm::mat3 TransformComponent::GetNormalMatrix()
+glm::mat3 TransformComponent::ComputeNormalMatrix(const glm::vec3& rotation, const glm::vec3& scale)
 {
-    const float c3 = glm::cos(Rotation.z);
-    const float s3 = glm::sin(Rotation.z);
-    const float c2 = glm::cos(Rotation.x);
-    const float s2 = glm::sin(Rotation.x);
-    const float c1 = glm::cos(Rotation.y);
-    const float s1 = glm::sin(Rotation.y);
-    glm::vec3 invScale = 1.f / Scale;
+    const float c3 = glm::cos(rotation.z);
+    const float s3 = glm::sin(rotation.z);
+    const float c2 = glm::cos(rotation.x);
+    const float s2 = glm::sin(rotation.x);
+    const float c1 = glm::cos(rotation.y);
+    const float s1 = glm::sin(rotation.y);
+    glm::vec3 invScale = 1.f / scale;
     return glm::mat3{
         {
             invScale.x * (c1 * c3 + s1 * s2 * s3),
@@ -61,4 +69,14 @@ glm::mat3 TransformComponent::GetNormalMatrix()
         }
     };
 }
+
+glm::mat4 TransformComponent::GetTransform() const
+{
+    return ComputeTransform(Translation, Rotation, Scale);
+}
+
+glm::mat3 TransformComponent::GetNormalMatrix() const
+{
+    return ComputeNormalMatrix(Rotation, Scale);
+}
 }
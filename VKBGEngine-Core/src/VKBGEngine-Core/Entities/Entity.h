@@ -9,40 +9,29 @@ struct TransformComponent
     glm::vec3 Scale{ 1.f, 1.f, 1.f };
     glm::vec3 Rotation{};
 
-    glm::mat4 GetTransform();
+    glm::mat4 GetTransform() const;
 
-    glm::mat3 GetNormalMatrix();
+    glm::mat3 GetNormalMatrix() const;
+
+    // Same as above for components stored apart (Scene keeps them in separate arrays).
+    static glm::mat4 ComputeTransform(const glm::vec3& translation, const glm::vec3& rotation, const glm::vec3& scale);
+    static glm::mat3 ComputeNormalMatrix(const glm::vec3& rotation, const glm::vec3& scale);
+    // The largest scale of a world matrix. It includes the parents', so it is
+    // read back from the basis vectors instead of the Scale component.
+    static float GetMaxScale(const glm::mat4& worldMatrix);
 };
 
-class Entity
+// Generational handle to an entity of a Scene. Destroying the entity bumps the
+// generation of its slot, so stale handles are detected instead of silently
+// pointing at whatever entity reuses the slot.
+struct EntityHandle
 {
-public:
-    using id_t = uint32_t;
-
-    static Entity CreateEntity()
-    {
-        static id_t nextID = 0;
-        return Entity{ nextID };
-    }
-
-public:
-    std::shared_ptr<class Model> Model;
-    glm::vec3 Color{};
-    TransformComponent Transform;
-
-public:
-    Entity(const Entity&) = delete;
-    Entity& operator=(const Entity&) = delete;
-    Entity(Entity&&) = default;
-    Entity& operator=(Entity&&) = default;
-
-    id_t GetID() { return m_ID; }
+    static constexpr uint32_t InvalidIndex = ~0u;
 
-private:
-    id_t m_ID;
+    uint32_t Index{ InvalidIndex };
+    uint32_t Generation{ 0 };
 
-private:
-    Entity(id_t id)
-        : m_ID{ id } {}
+    bool IsValid() const { return Index != InvalidIndex; }
+    bool operator==(const EntityHandle& other) const = default;
 };
 }
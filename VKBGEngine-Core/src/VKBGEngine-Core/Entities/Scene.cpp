@@ -0,0 +1,413 @@
+#include "Scene.h"
+#include "Graphics/Model.h"
+#include "Math/TransformKernels.h"
+#include "Threading/JobSystem.h"
+
+namespace vkbg
+{
+// the transform kernels do more per entity than the other loops
+static constexpr uint32_t MinTransformJobSize = JobSystem::MinRangeSize / 2;
+
+EntityHandle Scene::CreateEntity()
+{
+    uint32_t slotIndex;
+    if (m_FreeSlots.empty())
+    {
+        slotIndex = (uint32_t)m_Slots.size();
+        m_Slots.emplace_back();
+    }
+    else
+    {
+        slotIndex = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+    }
+
+    Slot& slot = m_Slots[slotIndex];
+    slot.DenseIndex = (uint32_t)m_DenseToSlot.size();
+    m_DenseToSlot.push_back(slotIndex);
+
+    m_Translations.emplace_back(0.f);
+    m_Rotations.emplace_back(0.f);
+    m_Scales.emplace_back(1.f);
+    m_Colors.emplace_back(1.f);
+    m_MaterialIndices.push_back(0);
+    m_MeshHandles.push_back(InvalidMesh);
+    m_LodLevels.push_back(0);
+    m_Parents.push_back(EntityHandle::InvalidIndex);
+    m_ChildCounts.push_back(0);
+    m_WorldMatrices.emplace_back(1.f);
+    m_NormalMatrices.emplace_back(1.f);
+    m_LocalMatrices.emplace_back(1.f);
+    m_LocalNormalMatrices.emplace_back(1.f);
+    m_TransformDirty.push_back(false);
+    // identity is already right for the default components, but the setters
+    // usually follow right away and this keeps the invariant simple
+    MarkTransformDirty(slot.DenseIndex);
+
+    return EntityHandle{ slotIndex, slot.Generation };
+}
+
+void Scene::DestroyEntity(EntityHandle entity)
+{
+    if (IsAlive(entity) == false)
+        return;
+
+    if (m_ChildCounts[GetDenseIndex(entity)] > 0)
+    {
+        // only the parent links are stored, so the children have to be searched.
+        // Going backwards, the entities swapped in have all been looked at already.
+        for (uint32_t i = GetEntityCount(); i > 0;)
+        {
+            --i;
+            if (m_Parents[i] == entity.Index)
+            {
+                DestroyEntity(GetEntity(i));
+                i = std::min(i, GetEntityCount());
+            }
+        }
+    }
+
+    Slot& slot = m_Slots[entity.Index];
+    const uint32_t denseIndex = slot.DenseIndex;
+    const uint32_t lastIndex = GetEntityCount() - 1;
+
+    if (m_Parents[denseIndex] != EntityHandle::InvalidIndex)
+    {
+        --m_ChildCounts[m_Slots[m_Parents[denseIndex]].DenseIndex];
+        --m_ChildEntityCount;
+    }
+    // the hierarchy nodes refer to dense indices, which are about to change
+    if (m_ChildEntityCount > 0)
+        m_HierarchyChanged = true;
+
+    // swap and pop, the last entity takes the freed dense index
+    if (denseIndex != lastIndex)
+    {
+        m_Translations[denseIndex] = m_Translations[lastIndex];
+        m_Rotations[denseIndex] = m_Rotations[lastIndex];
+        m_Scales[denseIndex] = m_Scales[lastIndex];
+        m_Colors[denseIndex] = m_Colors[lastIndex];
+        m_MaterialIndices[denseIndex] = m_MaterialIndices[lastIndex];
+        m_MeshHandles[denseIndex] = m_MeshHandles[lastIndex];
+        m_LodLevels[denseIndex] = m_LodLevels[lastIndex];
+        m_Parents[denseIndex] = m_Parents[lastIndex];
+        m_ChildCounts[denseIndex] = m_ChildCounts[lastIndex];
+        m_WorldMatrices[denseIndex] = m_WorldMatrices[lastIndex];
+        m_NormalMatrices[denseIndex] = m_NormalMatrices[lastIndex];
+        m_LocalMatrices[denseIndex] = m_LocalMatrices[lastIndex];
+        m_LocalNormalMatrices[denseIndex] = m_LocalNormalMatrices[lastIndex];
+        // the dirty list holds slot indices, so the moved entity stays queued
+        m_TransformDirty[denseIndex] = m_TransformDirty[lastIndex];
+
+        m_DenseToSlot[denseIndex] = m_DenseToSlot[lastIndex];
+        m_Slots[m_DenseToSlot[denseIndex]].DenseIndex = denseIndex;
+    }
+
+    m_Translations.pop_back();
+    m_Rotations.pop_back();
+    m_Scales.pop_back();
+    m_Colors.pop_back();
+    m_MaterialIndices.pop_back();
+    m_MeshHandles.pop_back();
+    m_LodLevels.pop_back();
+    m_Parents.pop_back();
+    m_ChildCounts.pop_back();
+    m_WorldMatrices.pop_back();
+    m_NormalMatrices.pop_back();
+    m_LocalMatrices.pop_back();
+    m_LocalNormalMatrices.pop_back();
+    m_TransformDirty.pop_back();
+    m_DenseToSlot.pop_back();
+
+    slot.DenseIndex = EntityHandle::InvalidIndex;
+    ++slot.Generation;
+    m_FreeSlots.push_back(entity.Index);
+}
+
+bool Scene::IsAlive(EntityHandle entity) const
+{
+    return entity.Index < m_Slots.size()
+        && m_Slots[entity.Index].Generation == entity.Generation
+        && m_Slots[entity.Index].DenseIndex != EntityHandle::InvalidIndex;
+}
+
+void Scene::Clear()
+{
+    // keep the slots so that the handles given out so far stay invalid
+    for (uint32_t slotIndex : m_DenseToSlot)
+    {
+        m_Slots[slotIndex].DenseIndex = EntityHandle::InvalidIndex;
+        ++m_Slots[slotIndex].Generation;
+        m_FreeSlots.push_back(slotIndex);
+    }
+
+    m_DenseToSlot.clear();
+    m_Translations.clear();
+    m_Rotations.clear();
+    m_Scales.clear();
+    m_Colors.clear();
+    m_MaterialIndices.clear();
+    m_MeshHandles.clear();
+    m_LodLevels.clear();
+    m_Parents.clear();
+    m_ChildCounts.clear();
+    m_WorldMatrices.clear();
+    m_NormalMatrices.clear();
+    m_LocalMatrices.clear();
+    m_LocalNormalMatrices.clear();
+    m_TransformDirty.clear();
+    m_DirtyTransforms.clear();
+    m_HierarchyNodes.clear();
+    m_HierarchyLevelEnds.clear();
+    m_ChildEntityCount = 0;
+    m_HierarchyChanged = false;
+    m_Meshes.clear();
+}
+
+MeshHandle Scene::AddMesh(std::shared_ptr<Model> model)
+{
+    m_Meshes.push_back(std::move(model));
+    return (MeshHandle)m_Meshes.size() - 1;
+}
+
+void Scene::SetTranslation(EntityHandle entity, const glm::vec3& translation)
+{
+    const uint32_t denseIndex = GetDenseIndex(entity);
+    m_Translations[denseIndex] = translation;
+    MarkTransformDirty(denseIndex);
+}
+
+void Scene::SetRotation(EntityHandle entity, const glm::vec3& rotation)
+{
+    const uint32_t denseIndex = GetDenseIndex(entity);
+    m_Rotations[denseIndex] = rotation;
+    MarkTransformDirty(denseIndex);
+}
+
+void Scene::SetScale(EntityHandle entity, const glm::vec3& scale)
+{
+    const uint32_t denseIndex = GetDenseIndex(entity);
+    m_Scales[denseIndex] = scale;
+    MarkTransformDirty(denseIndex);
+}
+
+void Scene::MarkTransformDirty(uint32_t denseIndex)
+{
+    if (m_TransformDirty[denseIndex])
+        return;
+    m_TransformDirty[denseIndex] = true;
+    m_DirtyTransforms.push_back(m_DenseToSlot[denseIndex]);
+}
+
+void Scene::SetParent(EntityHandle child, EntityHandle parent)
+{
+    const uint32_t childIndex = GetDenseIndex(child);
+    uint32_t parentSlot = EntityHandle::InvalidIndex;
+    if (parent.IsValid())
+    {
+        assert(IsAlive(parent) && "Stale or invalid entity handle");
+        // walking up from the new parent must not reach the child
+        for (uint32_t slot = parent.Index; slot != EntityHandle::InvalidIndex;
+            slot = m_Parents[m_Slots[slot].DenseIndex])
+        {
+            if (slot == child.Index)
+                throw std::runtime_error("SetParent would create a cycle in the scene hierarchy");
+        }
+        parentSlot = parent.Index;
+    }
+
+    const uint32_t oldParentSlot = m_Parents[childIndex];
+    if (oldParentSlot == parentSlot)
+        return;
+
+    if (oldParentSlot != EntityHandle::InvalidIndex)
+        --m_ChildCounts[m_Slots[oldParentSlot].DenseIndex];
+    else
+        ++m_ChildEntityCount;
+
+    if (parentSlot != EntityHandle::InvalidIndex)
+        ++m_ChildCounts[m_Slots[parentSlot].DenseIndex];
+    else
+        --m_ChildEntityCount;
+
+    m_Parents[childIndex] = parentSlot;
+    m_HierarchyChanged = true;
+    MarkTransformDirty(childIndex);
+}
+
+EntityHandle Scene::GetParent(EntityHandle entity) const
+{
+    const uint32_t parentSlot = m_Parents[GetDenseIndex(entity)];
+    if (parentSlot == EntityHandle::InvalidIndex)
+        return EntityHandle{};
+    return EntityHandle{ parentSlot, m_Slots[parentSlot].Generation };
+}
+
+uint32_t Scene::UpdateDirtyTransforms(JobSystem* jobSystem)
+{
+    if (m_DirtyTransforms.empty())
+        return 0;
+
+    m_DirtyRoots.clear();
+    m_DirtyChildren.clear();
+    for (uint32_t slotIndex : m_DirtyTransforms)
+    {
+        // the entity may have been destroyed since, or the slot reused by an
+        // entity that was queued again and is handled by the other entry
+        const uint32_t denseIndex = m_Slots[slotIndex].DenseIndex;
+        if (denseIndex == EntityHandle::InvalidIndex || m_TransformDirty[denseIndex] == false)
+            continue;
+
+        m_TransformDirty[denseIndex] = false;
+        if (m_Parents[denseIndex] == EntityHandle::InvalidIndex)
+            m_DirtyRoots.push_back(denseIndex);
+        else
+            m_DirtyChildren.push_back(denseIndex);
+    }
+    m_DirtyTransforms.clear();
+
+    // roots go straight to the world matrices, children are relative to their parent
+    ComputeTransforms(jobSystem, m_DirtyRoots, false);
+    if (m_ChildEntityCount == 0)
+        return (uint32_t)m_DirtyRoots.size();
+    ComputeTransforms(jobSystem, m_DirtyChildren, true);
+
+    if (m_HierarchyChanged)
+        RebuildHierarchy();
+
+    // the dirty flags now mean "world matrix changed", the propagation spreads
+    // them down level by level
+    for (uint32_t denseIndex : m_DirtyRoots)
+        m_TransformDirty[denseIndex] = true;
+    for (uint32_t denseIndex : m_DirtyChildren)
+        m_TransformDirty[denseIndex] = true;
+
+    uint32_t updated = (uint32_t)m_DirtyRoots.size();
+    uint32_t levelStart = 0;
+    for (uint32_t levelEnd : m_HierarchyLevelEnds)
+    {
+        const uint32_t levelSize = levelEnd - levelStart;
+        if (jobSystem == nullptr || levelSize < 2 * JobSystem::MinRangeSize)
+        {
+            updated += PropagateTransforms(levelStart, levelEnd);
+        }
+        else
+        {
+            // the nodes of a level only read the level above, so the ranges are independent
+            std::atomic<uint32_t> levelUpdated{ 0 };
+            jobSystem->ParallelFor(levelSize, JobSystem::MinRangeSize, [&](uint32_t first, uint32_t last)
+            {
+                levelUpdated.fetch_add(PropagateTransforms(levelStart + first, levelStart + last), std::memory_order_relaxed);
+            });
+            updated += levelUpdated.load();
+        }
+        levelStart = levelEnd;
+    }
+
+    for (uint32_t denseIndex : m_DirtyRoots)
+        m_TransformDirty[denseIndex] = false;
+    for (const HierarchyNode& node : m_HierarchyNodes)
+        m_TransformDirty[node.Entity] = false;
+    return updated;
+}
+
+void Scene::ComputeTransforms(JobSystem* jobSystem, const std::vector<uint32_t>& indices, bool local)
+{
+    TransformBatch batch{
+        .Translations = m_Translations.data(),
+        .Rotations = m_Rotations.data(),
+        .Scales = m_Scales.data(),
+        .WorldMatrices = local ? m_LocalMatrices.data() : m_WorldMatrices.data(),
+        .NormalMatrices = local ? m_LocalNormalMatrices.data() : m_NormalMatrices.data(),
+        .Indices = indices.data(),
+        .Count = (uint32_t)indices.size()
+    };
+
+    if (jobSystem == nullptr || batch.Count < 2 * MinTransformJobSize)
+    {
+        vkbg::ComputeTransforms(batch);
+        return;
+    }
+
+    jobSystem->ParallelFor(batch.Count, MinTransformJobSize, [&batch](uint32_t first, uint32_t last)
+    {
+        TransformBatch range = batch;
+        range.Indices += first;
+        range.Count = last - first;
+        vkbg::ComputeTransforms(range);
+    });
+}
+
+uint32_t Scene::PropagateTransforms(uint32_t first, uint32_t last)
+{
+    uint32_t updated = 0;
+    for (uint32_t i = first; i < last; ++i)
+    {
+        const HierarchyNode& node = m_HierarchyNodes[i];
+        if (m_TransformDirty[node.Entity] == false && m_TransformDirty[node.Parent] == false)
+            continue;
+
+        m_WorldMatrices[node.Entity] = m_WorldMatrices[node.Parent] * m_LocalMatrices[node.Entity];
+        // inverse transpose of a product is the product of the inverse transposes
+        m_NormalMatrices[node.Entity] = m_NormalMatrices[node.Parent] * m_LocalNormalMatrices[node.Entity];
+        m_TransformDirty[node.Entity] = true;
+        ++updated;
+    }
+    return updated;
+}
+
+void Scene::RebuildHierarchy()
+{
+    m_HierarchyChanged = false;
+    m_HierarchyNodes.clear();
+    m_HierarchyLevelEnds.clear();
+
+    const uint32_t entityCount = GetEntityCount();
+    m_HierarchyDepths.assign(entityCount, EntityHandle::InvalidIndex);
+    uint32_t maxDepth = 0;
+    for (uint32_t i = 0; i < entityCount; ++i)
+    {
+        // walk up to the first entity whose depth is known, then back down
+        uint32_t top = i;
+        uint32_t steps = 0;
+        while (m_HierarchyDepths[top] == EntityHandle::InvalidIndex && m_Parents[top] != EntityHandle::InvalidIndex)
+        {
+            top = m_Slots[m_Parents[top]].DenseIndex;
+            ++steps;
+        }
+        uint32_t depth = m_HierarchyDepths[top] == EntityHandle::InvalidIndex ? 0 : m_HierarchyDepths[top];
+        m_HierarchyDepths[top] = depth;
+
+        depth += steps;
+        maxDepth = std::max(maxDepth, depth);
+        for (uint32_t entity = i; entity != top; entity = m_Slots[m_Parents[entity]].DenseIndex)
+            m_HierarchyDepths[entity] = depth--;
+    }
+
+    // counting sort of the children by depth, the roots (depth 0) are left out
+    m_HierarchyLevelEnds.assign(maxDepth, 0);
+    for (uint32_t depth : m_HierarchyDepths)
+    {
+        if (depth > 0)
+            ++m_HierarchyLevelEnds[depth - 1];
+    }
+    std::inclusive_scan(m_HierarchyLevelEnds.begin(), m_HierarchyLevelEnds.end(), m_HierarchyLevelEnds.begin());
+
+    m_HierarchyNodes.resize(m_ChildEntityCount);
+    std::vector<uint32_t> levelCursors(maxDepth, 0);
+    for (uint32_t level = 1; level < maxDepth; ++level)
+        levelCursors[level] = m_HierarchyLevelEnds[level - 1];
+    for (uint32_t i = 0; i < entityCount; ++i)
+    {
+        const uint32_t depth = m_HierarchyDepths[i];
+        if (depth > 0)
+            m_HierarchyNodes[levelCursors[depth - 1]++] = { i, m_Slots[m_Parents[i]].DenseIndex };
+    }
+}
+
+EntityHandle Scene::GetEntity(uint32_t denseIndex) const
+{
+    const uint32_t slotIndex = m_DenseToSlot[denseIndex];
+    return EntityHandle{ slotIndex, m_Slots[slotIndex].Generation };
+}
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include "Entity.h"
+
+namespace vkbg
+{
+using MeshHandle = uint32_t;
+static constexpr MeshHandle InvalidMesh = ~0u;
+
+// Entity storage. Components live in dense, parallel arrays (one per component)
+// so that per-frame passes stream through contiguous memory; entity handles go
+// through a slot map to find their dense index.
+//
+// Destroying an entity moves the last one into its place, so dense indices are
+// only stable until the next CreateEntity/DestroyEntity. Keep handles, not
+// indices, across frames.
+//
+// World and normal matrices are cached. Transform components are only written
+// through the setters, which queue the entity on a dirty list, and
+// UpdateDirtyTransforms recomputes the matrices of the queued entities only,
+// so static entities cost nothing per frame.
+//
+// Entities can have a parent, their transform components are then relative to
+// it. Children are kept in an array sorted by depth, so world matrices are
+// propagated one level at a time, parents always being done before their
+// children, and the levels large enough are split across the job system.
+class Scene
+{
+public:
+    Scene() = default;
+    ~Scene() = default;
+
+    Scene(const Scene&) = delete;
+    Scene& operator=(const Scene&) = delete;
+
+    EntityHandle CreateEntity();
+    void DestroyEntity(EntityHandle entity);
+    bool IsAlive(EntityHandle entity) const;
+    void Clear();
+
+    // Models are shared by the entities through mesh handles.
+    MeshHandle AddMesh(std::shared_ptr<class Model> model);
+    class Model* GetMesh(MeshHandle mesh) const { return m_Meshes[mesh].get(); }
+    uint32_t GetMeshCount() const { return (uint32_t)m_Meshes.size(); }
+
+    // Components of a live entity.
+    const glm::vec3& GetTranslation(EntityHandle entity) const { return m_Translations[GetDenseIndex(entity)]; }
+    const glm::vec3& GetRotation(EntityHandle entity) const { return m_Rotations[GetDenseIndex(entity)]; }
+    const glm::vec3& GetScale(EntityHandle entity) const { return m_Scales[GetDenseIndex(entity)]; }
+    // tint multiplied with the vertex colors, white by default
+    glm::vec3& GetColor(EntityHandle entity) { return m_Colors[GetDenseIndex(entity)]; }
+    uint32_t& GetMaterialIndex(EntityHandle entity) { return m_MaterialIndices[GetDenseIndex(entity)]; }
+    MeshHandle& GetMeshHandle(EntityHandle entity) { return m_MeshHandles[GetDenseIndex(entity)]; }
+
+    void SetTranslation(EntityHandle entity, const glm::vec3& translation);
+    void SetRotation(EntityHandle entity, const glm::vec3& rotation);
+    void SetScale(EntityHandle entity, const glm::vec3& scale);
+
+    // Attaches child to parent, or detaches it when parent is not a valid
+    // handle. Throws if parent is child or one of its descendants. Destroying
+    // an entity destroys its children too.
+    void SetParent(EntityHandle child, EntityHandle parent);
+    EntityHandle GetParent(EntityHandle entity) const;
+
+    // Recomputes the cached matrices of the entities whose transform changed
+    // since the last call and of their descendants. Returns how many were updated.
+    // Large batches are split across jobSystem when there is one.
+    uint32_t UpdateDirtyTransforms(class JobSystem* jobSystem = nullptr);
+    uint32_t GetDirtyTransformCount() const { return (uint32_t)m_DirtyTransforms.size(); }
+
+    // Dense arrays, all GetEntityCount() long and indexed the same way. The
+    // matrices are up to date as of the last UpdateDirtyTransforms.
+    uint32_t GetEntityCount() const { return (uint32_t)m_DenseToSlot.size(); }
+    EntityHandle GetEntity(uint32_t denseIndex) const;
+
+    std::span<glm::vec3> GetColors() { return m_Colors; }
+    std::span<uint32_t> GetMaterialIndices() { return m_MaterialIndices; }
+    std::span<MeshHandle> GetMeshHandles() { return m_MeshHandles; }
+    // level of detail drawn last frame, kept across frames for the hysteresis
+    std::span<uint8_t> GetLodLevels() { return m_LodLevels; }
+    std::span<const glm::vec3> GetTranslations() const { return m_Translations; }
+    std::span<const glm::vec3> GetRotations() const { return m_Rotations; }
+    std::span<const glm::vec3> GetScales() const { return m_Scales; }
+    std::span<const glm::vec3> GetColors() const { return m_Colors; }
+    std::span<const uint32_t> GetMaterialIndices() const { return m_MaterialIndices; }
+    std::span<const MeshHandle> GetMeshHandles() const { return m_MeshHandles; }
+    std::span<const uint8_t> GetLodLevels() const { return m_LodLevels; }
+    std::span<const glm::mat4> GetWorldMatrices() const { return m_WorldMatrices; }
+    // mat4 rather than mat3 so that the columns are already 16-byte aligned
+    std::span<const glm::mat4> GetNormalMatrices() const { return m_NormalMatrices; }
+
+private:
+    uint32_t GetDenseIndex(EntityHandle entity) const
+    {
+        assert(IsAlive(entity) && "Stale or invalid entity handle");
+        return m_Slots[entity.Index].DenseIndex;
+    }
+    void MarkTransformDirty(uint32_t denseIndex);
+    void RebuildHierarchy();
+    void ComputeTransforms(class JobSystem* jobSystem, const std::vector<uint32_t>& indices, bool local);
+    // world matrices of the hierarchy nodes [first, last) whose local transform or parent changed
+    uint32_t PropagateTransforms(uint32_t first, uint32_t last);
+
+private:
+    struct Slot
+    {
+        uint32_t DenseIndex{ EntityHandle::InvalidIndex };
+        uint32_t Generation{ 0 };
+    };
+    std::vector<Slot> m_Slots;
+    std::vector<uint32_t> m_FreeSlots;
+    std::vector<uint32_t> m_DenseToSlot;
+
+    // components
+    std::vector<glm::vec3> m_Translations;
+    std::vector<glm::vec3> m_Rotations;
+    std::vector<glm::vec3> m_Scales;
+    std::vector<glm::vec3> m_Colors;
+    std::vector<uint32_t> m_MaterialIndices;
+    std::vector<MeshHandle> m_MeshHandles;
+    std::vector<uint8_t> m_LodLevels;
+
+    // slot of the parent, InvalidIndex for roots
+    std::vector<uint32_t> m_Parents;
+    std::vector<uint32_t> m_ChildCounts;
+
+    // cached transforms, the local ones are only used by children
+    std::vector<glm::mat4> m_WorldMatrices;
+    std::vector<glm::mat4> m_NormalMatrices;
+    std::vector<glm::mat4> m_LocalMatrices;
+    std::vector<glm::mat4> m_LocalNormalMatrices;
+    std::vector<uint8_t> m_TransformDirty;
+    // slot indices (stable across swaps), an entry may be stale if the entity died
+    std::vector<uint32_t> m_DirtyTransforms;
+    // scratch, the dense indices handed to the transform kernel
+    std::vector<uint32_t> m_DirtyRoots;
+    std::vector<uint32_t> m_DirtyChildren;
+
+    // Every entity with a parent, sorted by depth. Dense indices, so it is
+    // rebuilt when the hierarchy changes or hierarchy entities move.
+    struct HierarchyNode
+    {
+        uint32_t Entity;
+        uint32_t Parent;
+    };
+    std::vector<HierarchyNode> m_HierarchyNodes;
+    // end of each level in m_HierarchyNodes, starting at depth 1
+    std::vector<uint32_t> m_HierarchyLevelEnds;
+    std::vector<uint32_t> m_HierarchyDepths;
+    uint32_t m_ChildEntityCount{ 0 };
+    bool m_HierarchyChanged{ false };
+
+    std::vector<std::shared_ptr<class Model>> m_Meshes;
+};
+}
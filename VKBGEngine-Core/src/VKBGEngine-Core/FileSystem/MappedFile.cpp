@@ -0,0 +1,131 @@
+#include "MappedFile.h"
+
+#ifdef PLATFORM_WINDOWS
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace vkbg
+{
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this == &other)
+        return *this;
+
+    Close();
+    std::swap(m_Data, other.m_Data);
+    std::swap(m_Size, other.m_Size);
+#ifdef PLATFORM_WINDOWS
+    std::swap(m_FileHandle, other.m_FileHandle);
+    std::swap(m_MappingHandle, other.m_MappingHandle);
+#endif
+    return *this;
+}
+
+#ifdef PLATFORM_WINDOWS
+bool MappedFile::Open(const std::string& filePath)
+{
+    Close();
+
+    HANDLE file = CreateFileA(
+        filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize{};
+    if (GetFileSizeEx(file, &fileSize) == FALSE || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_FileHandle = file;
+    m_MappingHandle = mapping;
+    m_Data = static_cast<const uint8_t*>(view);
+    m_Size = (size_t)fileSize.QuadPart;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data != nullptr)
+        UnmapViewOfFile(m_Data);
+    if (m_MappingHandle != nullptr)
+        CloseHandle(m_MappingHandle);
+    if (m_FileHandle != nullptr)
+        CloseHandle(m_FileHandle);
+
+    m_Data = nullptr;
+    m_Size = 0;
+    m_MappingHandle = nullptr;
+    m_FileHandle = nullptr;
+}
+#else
+bool MappedFile::Open(const std::string& filePath)
+{
+    Close();
+
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (view == MAP_FAILED)
+        return false;
+
+    m_Data = static_cast<const uint8_t*>(view);
+    m_Size = (size_t)fileStat.st_size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data != nullptr)
+        munmap((void*)m_Data, m_Size);
+
+    m_Data = nullptr;
+    m_Size = 0;
+}
+#endif
+}
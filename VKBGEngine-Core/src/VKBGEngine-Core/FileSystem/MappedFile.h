@@ -0,0 +1,34 @@
+#pragma once
+
+namespace vkbg
+{
+// Read-only view of a whole file mapped into the address space.
+// The data pointer stays valid for as long as the MappedFile is alive.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool Open(const std::string& filePath);
+    void Close();
+
+    bool IsOpen() const { return m_Data != nullptr; }
+    const uint8_t* GetData() const { return m_Data; }
+    size_t GetSize() const { return m_Size; }
+
+private:
+    const uint8_t* m_Data{ nullptr };
+    size_t m_Size{ 0 };
+
+#ifdef PLATFORM_WINDOWS
+    void* m_FileHandle{ nullptr };
+    void* m_MappingHandle{ nullptr };
+#endif
+};
+}
@@ -3,6 +3,21 @@
 
 namespace vkbg
 {
+struct FrameStats
+{
+    uint32_t VisibleEntities{ 0 };
+    uint32_t CulledEntities{ 0 };
+    uint32_t DrawCalls{ 0 };
+    // against binding the pipeline and the geometry buffers for every draw
+    uint32_t PipelineBindsSaved{ 0 };
+    uint32_t BufferBindsSaved{ 0 };
+    uint32_t UpdatedTransforms{ 0 };
+    // drawn at the levels of detail picked, and left out by them against
+    // drawing everything at full detail
+    uint64_t Triangles{ 0 };
+    uint64_t LodTrianglesSaved{ 0 };
+};
+
 struct FrameInfo
 {
     uint32_t FrameIndex;
@@ -43,14 +43,14 @@ Buffer::Buffer(
 {
     m_AlignmentSize = GetAlignment(instanceSize, minOffsetAlignment);
     m_BufferSize = m_AlignmentSize * instanceCount;
-    context->CreateBuffer(m_BufferSize, m_UsageFlags, memoryPropertyFlags, m_Buffer, m_Memory);
+    context->CreateBuffer(m_BufferSize, m_UsageFlags, memoryPropertyFlags, m_Buffer, m_Allocation);
 }
 
 Buffer::~Buffer()
 {
     Unmap();
     vkDestroyBuffer(m_Context->GetLogicalDevice(), m_Buffer, nullptr);
-    vkFreeMemory(m_Context->GetLogicalDevice(), m_Memory, nullptr);
+    m_Context->GetAllocator()->Free(m_Allocation);
 }
 
 Buffer::Buffer(Buffer&& other)
@@ -60,7 +60,7 @@ Buffer::Buffer(Buffer&& other)
     m_Context = other.m_Context;
     m_Mapped = other.m_Mapped;
     m_Buffer = other.m_Buffer;
-    m_Memory = other.m_Memory;
+    m_Allocation = other.m_Allocation;
     m_BufferSize = other.m_BufferSize;
     m_InstanceCount = other.m_InstanceCount;
     m_InstanceSize = other.m_InstanceSize;
@@ -69,12 +69,15 @@ Buffer::Buffer(Buffer&& other)
     m_MemoryPropertyFlags = other.m_MemoryPropertyFlags;
     other.m_Mapped = nullptr;
     other.m_Buffer = nullptr;
-    other.m_Memory = nullptr;
+    other.m_Allocation = Allocation{};
 }
 
 /**
     * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
     *
+    * @note Host visible memory blocks are persistently mapped by the MemoryAllocator, so this only
+    * points m_Mapped into the block.
+    *
     * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
     * buffer range.
     * @param offset (Optional) Byte offset from beginning
@@ -83,22 +86,22 @@ Buffer::Buffer(Buffer&& other)
     */
 VkResult Buffer::Map(VkDeviceSize size, VkDeviceSize offset)
 {
-    assert(m_Buffer && m_Memory && "Called map on buffer before create");
-    return vkMapMemory(m_Context->GetLogicalDevice(), m_Memory, offset, size, 0, &m_Mapped);
+    assert(m_Buffer && m_Allocation.IsValid() && "Called map on buffer before create");
+    if (m_Allocation.MappedData == nullptr)
+        return VK_ERROR_MEMORY_MAP_FAILED;
+
+    m_Mapped = static_cast<char*>(m_Allocation.MappedData) + offset;
+    return VK_SUCCESS;
 }
 
 /**
     * Unmap a mapped memory range
     *
-    * @note Does not return a result as vkUnmapMemory can't fail
+    * @note The underlying block stays mapped for the lifetime of the allocator
     */
 void Buffer::Unmap()
 {
-    if (m_Mapped)
-    {
-        vkUnmapMemory(m_Context->GetLogicalDevice(), m_Memory);
-        m_Mapped = nullptr;
-    }
+    m_Mapped = nullptr;
 }
 
 /**
@@ -110,7 +113,7 @@ void Buffer::Unmap()
     * @param offset (Optional) Byte offset from beginning of mapped region
     *
     */
-void Buffer::WriteToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset)
+void Buffer::WriteToBuffer(const void* data, VkDeviceSize size, VkDeviceSize offset)
 {
     assert(m_Mapped && "Cannot copy to unmapped buffer");
 
@@ -139,12 +142,7 @@ void Buffer::WriteToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset)
     */
 VkResult Buffer::Flush(VkDeviceSize size, VkDeviceSize offset)
 {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = m_Memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkFlushMappedMemoryRanges(m_Context->GetLogicalDevice(), 1, &mappedRange);
+    return m_Context->GetAllocator()->Flush(m_Allocation, size, offset);
 }
 
 /**
@@ -160,12 +158,7 @@ VkResult Buffer::Flush(VkDeviceSize size, VkDeviceSize offset)
     */
 VkResult Buffer::Invalidate(VkDeviceSize size, VkDeviceSize offset)
 {
-    VkMappedMemoryRange mappedRange = {};
-    mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-    mappedRange.memory = m_Memory;
-    mappedRange.offset = offset;
-    mappedRange.size = size;
-    return vkInvalidateMappedMemoryRanges(m_Context->GetLogicalDevice(), 1, &mappedRange);
+    return m_Context->GetAllocator()->Invalidate(m_Allocation, size, offset);
 }
 
 /**
@@ -192,7 +185,7 @@ VkDescriptorBufferInfo Buffer::DescriptorInfo(VkDeviceSize size, VkDeviceSize of
     * @param index Used in offset calculation
     *
     */
-void Buffer::WriteToIndex(void* data, int index)
+void Buffer::WriteToIndex(const void* data, int index)
 {
     WriteToBuffer(data, m_InstanceSize, index * m_AlignmentSize);
 }
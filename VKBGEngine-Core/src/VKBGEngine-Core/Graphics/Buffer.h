@@ -1,4 +1,5 @@
 #pragma once
+#include "MemoryAllocator.h"
 
 namespace vkbg
 {
@@ -22,12 +23,12 @@ public:
     VkResult Map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
     void Unmap();
 
-    void WriteToBuffer(void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+    void WriteToBuffer(const void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
     VkResult Flush(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
     VkDescriptorBufferInfo DescriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
     VkResult Invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
-    void WriteToIndex(void* data, int index);
+    void WriteToIndex(const void* data, int index);
     VkResult FlushIndex(int index);
     VkDescriptorBufferInfo DescriptorInfoForIndex(int index);
     VkResult InvalidateIndex(int index);
@@ -47,7 +48,7 @@ private:
     class RenderContext* m_Context;
     void* m_Mapped = nullptr;
     VkBuffer m_Buffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_Memory = VK_NULL_HANDLE;
+    Allocation m_Allocation{};
 
     VkDeviceSize m_BufferSize;
     uint32_t m_InstanceCount;
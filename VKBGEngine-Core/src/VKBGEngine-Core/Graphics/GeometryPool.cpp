@@ -0,0 +1,212 @@
+#include "GeometryPool.h"
+#include "Buffer.h"
+#include "RenderContext.h"
+#include "SwapChain.h"
+
+namespace vkbg
+{
+bool GeometryPool::FreeList::Allocate(uint32_t count, uint32_t& offset)
+{
+    // best fit: the smallest range that can hold count
+    auto best = Ranges.end();
+    for (auto it = Ranges.begin(); it != Ranges.end(); ++it)
+    {
+        if (it->Count >= count && (best == Ranges.end() || it->Count < best->Count))
+            best = it;
+    }
+    if (best == Ranges.end())
+        return false;
+
+    offset = best->Offset;
+    best->Offset += count;
+    best->Count -= count;
+    if (best->Count == 0)
+        Ranges.erase(best);
+    return true;
+}
+
+void GeometryPool::FreeList::Free(uint32_t offset, uint32_t count)
+{
+    auto next = std::lower_bound(Ranges.begin(), Ranges.end(), offset,
+        [](const Range& range, uint32_t value) { return range.Offset < value; });
+
+    // merge with the ranges right before and right after
+    const bool mergePrevious = next != Ranges.begin() && std::prev(next)->Offset + std::prev(next)->Count == offset;
+    const bool mergeNext = next != Ranges.end() && offset + count == next->Offset;
+    if (mergePrevious && mergeNext)
+    {
+        std::prev(next)->Count += count + next->Count;
+        Ranges.erase(next);
+    }
+    else if (mergePrevious)
+    {
+        std::prev(next)->Count += count;
+    }
+    else if (mergeNext)
+    {
+        next->Offset = offset;
+        next->Count += count;
+    }
+    else
+    {
+        Ranges.insert(next, { offset, count });
+    }
+}
+
+GeometryPool::GeometryPool(
+    RenderContext* context,
+    uint32_t blockVertexCount,
+    uint32_t blockIndexCount)
+    : m_Context{ context }
+    , m_BlockVertexCount{ blockVertexCount }
+    , m_BlockIndexCount{ blockIndexCount }
+{
+}
+
+GeometryPool::~GeometryPool()
+{
+    // the buffers can't go away while a copy into them is pending
+    m_Context->GetUploadManager()->WaitIdle();
+}
+
+GeometryAllocation GeometryPool::Allocate(
+    VertexLayout layout,
+    const void* vertices, uint32_t vertexCount,
+    const uint32_t* indices, uint32_t indexCount,
+    UploadTicket& ticket)
+{
+    assert(vertexCount > 0 && indexCount > 0 && "The geometry pool only holds indexed meshes");
+
+    GeometryAllocation allocation{ .VertexCount = vertexCount, .IndexCount = indexCount };
+    auto tryAllocate = [&](uint32_t blockIndex)
+    {
+        Block& block = m_Blocks[blockIndex];
+        uint32_t vertexOffset{};
+        if (block.Layout != layout)
+            return false;
+        if (block.FreeVertices.Allocate(vertexCount, vertexOffset) == false)
+            return false;
+        if (block.FreeIndices.Allocate(indexCount, allocation.FirstIndex) == false)
+        {
+            block.FreeVertices.Free(vertexOffset, vertexCount);
+            return false;
+        }
+        allocation.Block = blockIndex;
+        allocation.VertexOffset = (int32_t)vertexOffset;
+        return true;
+    };
+
+    bool allocated = false;
+    for (uint32_t blockIndex = 0; blockIndex < m_Blocks.size() && allocated == false; ++blockIndex)
+        allocated = tryAllocate(blockIndex);
+    if (allocated == false)
+    {
+        CreateBlock(layout, std::max(vertexCount, m_BlockVertexCount), std::max(indexCount, m_BlockIndexCount));
+        allocated = tryAllocate((uint32_t)m_Blocks.size() - 1);
+        assert(allocated && "A new block has to fit the mesh");
+    }
+
+    ++m_MeshCount;
+    m_VertexCount += vertexCount;
+    m_IndexCount += indexCount;
+    const VkDeviceSize vertexSize = GetVertexSize(layout);
+    m_VertexBytes += vertexCount * vertexSize;
+
+    const Block& block = m_Blocks[allocation.Block];
+    UploadManager* uploadManager = m_Context->GetUploadManager();
+    uploadManager->Upload(
+        vertices, vertexCount * vertexSize, block.VertexBuffer->GetBuffer(), allocation.VertexOffset * vertexSize);
+    ticket = uploadManager->Upload(
+        indices, indexCount * sizeof(uint32_t), block.IndexBuffer->GetBuffer(), allocation.FirstIndex * sizeof(uint32_t));
+    return allocation;
+}
+
+void GeometryPool::Free(const GeometryAllocation& allocation, UploadTicket ticket)
+{
+    // a copy still pending could land after the range has been reused
+    m_Context->GetUploadManager()->Wait(ticket);
+    m_PendingFrees.push_back({ allocation, m_FrameNumber + SwapChain::MAX_FRAMES_IN_FLIGHT });
+
+    --m_MeshCount;
+    m_VertexCount -= allocation.VertexCount;
+    m_IndexCount -= allocation.IndexCount;
+    m_VertexBytes -= allocation.VertexCount * (uint64_t)GetVertexSize(m_Blocks[allocation.Block].Layout);
+}
+
+void GeometryPool::BeginFrame()
+{
+    ++m_FrameNumber;
+
+    auto released = std::remove_if(m_PendingFrees.begin(), m_PendingFrees.end(), [this](const PendingFree& pending)
+    {
+        if (pending.ReleaseFrame > m_FrameNumber)
+            return false;
+        Release(pending.Allocation);
+        return true;
+    });
+    m_PendingFrees.erase(released, m_PendingFrees.end());
+}
+
+void GeometryPool::Bind(VkCommandBuffer commandBuffer, uint32_t block) const
+{
+    VkBuffer buffers[]{ m_Blocks[block].VertexBuffer->GetBuffer() };
+    VkDeviceSize offsets[]{ 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, m_Blocks[block].IndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+VkBuffer GeometryPool::GetVertexBuffer(uint32_t block) const
+{
+    return m_Blocks[block].VertexBuffer->GetBuffer();
+}
+
+VkBuffer GeometryPool::GetIndexBuffer(uint32_t block) const
+{
+    return m_Blocks[block].IndexBuffer->GetBuffer();
+}
+
+GeometryPoolStats GeometryPool::GetStats() const
+{
+    GeometryPoolStats stats{
+        .BlockCount = (uint32_t)m_Blocks.size(),
+        .MeshCount = m_MeshCount,
+        .VertexCount = m_VertexCount,
+        .IndexCount = m_IndexCount,
+        .VertexBytes = m_VertexBytes
+    };
+    for (const auto& block : m_Blocks)
+    {
+        stats.VertexCapacity += block.VertexBuffer->GetInstanceCount();
+        stats.IndexCapacity += block.IndexBuffer->GetInstanceCount();
+    }
+    return stats;
+}
+
+void GeometryPool::CreateBlock(VertexLayout layout, uint32_t vertexCount, uint32_t indexCount)
+{
+    Block& block = m_Blocks.emplace_back();
+    block.Layout = layout;
+    block.VertexBuffer = std::make_unique<Buffer>(
+        m_Context,
+        GetVertexSize(layout),
+        vertexCount,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    block.IndexBuffer = std::make_unique<Buffer>(
+        m_Context,
+        sizeof(uint32_t),
+        indexCount,
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    block.FreeVertices.Ranges.push_back({ 0, vertexCount });
+    block.FreeIndices.Ranges.push_back({ 0, indexCount });
+}
+
+void GeometryPool::Release(const GeometryAllocation& allocation)
+{
+    Block& block = m_Blocks[allocation.Block];
+    block.FreeVertices.Free((uint32_t)allocation.VertexOffset, allocation.VertexCount);
+    block.FreeIndices.Free(allocation.FirstIndex, allocation.IndexCount);
+}
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include "UploadManager.h"
+#include "VertexLayout.h"
+
+namespace vkbg
+{
+// Where a mesh lives in the geometry pool: the block to bind and the arguments
+// of its indexed draws.
+struct GeometryAllocation
+{
+    uint32_t Block{ 0 };
+    int32_t VertexOffset{ 0 };
+    uint32_t VertexCount{ 0 };
+    uint32_t FirstIndex{ 0 };
+    uint32_t IndexCount{ 0 };
+};
+
+struct GeometryPoolStats
+{
+    uint32_t BlockCount{ 0 };
+    uint32_t MeshCount{ 0 };
+    uint32_t VertexCount{ 0 };
+    uint32_t IndexCount{ 0 };
+    // bytes of the vertices in use, across the layouts
+    uint64_t VertexBytes{ 0 };
+    uint32_t VertexCapacity{ 0 };
+    uint32_t IndexCapacity{ 0 };
+};
+
+// Sub-allocates the geometry of all the models out of a few large blocks, each
+// one a device local vertex buffer and index buffer pair, so that meshes of the
+// same block are drawn from the same bindings and only differ by their offsets.
+// A block keeps a free list of vertex and index ranges (best fit, coalesced on
+// free). A new block is created when a mesh fits in none of them, sized for
+// the mesh when it is bigger than the default. The vertices of a block all
+// have the same layout, a mesh only goes in the blocks of its own.
+//
+// Freed ranges are only reused MAX_FRAMES_IN_FLIGHT frames later, once the
+// frames that may still draw the mesh are done; the Renderer calls BeginFrame.
+class GeometryPool
+{
+public:
+    static constexpr uint32_t DefaultBlockVertexCount = 1u << 20;
+    static constexpr uint32_t DefaultBlockIndexCount = 1u << 22;
+
+    GeometryPool(
+        class RenderContext* context,
+        uint32_t blockVertexCount = DefaultBlockVertexCount,
+        uint32_t blockIndexCount = DefaultBlockIndexCount);
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    // Reserves room for the mesh and uploads it through the UploadManager,
+    // ticket tells when the data has landed.
+    GeometryAllocation Allocate(
+        VertexLayout layout,
+        const void* vertices, uint32_t vertexCount,
+        const uint32_t* indices, uint32_t indexCount,
+        UploadTicket& ticket);
+    // Waits for the upload of the mesh (ticket as returned by Allocate) and
+    // hands its ranges back once the frames in flight are done with them.
+    void Free(const GeometryAllocation& allocation, UploadTicket ticket);
+
+    // Releases the ranges freed MAX_FRAMES_IN_FLIGHT frames ago.
+    void BeginFrame();
+
+    // Binds the vertex buffer of the block to binding 0 and its index buffer.
+    void Bind(VkCommandBuffer commandBuffer, uint32_t block) const;
+
+    uint32_t GetBlockCount() const { return (uint32_t)m_Blocks.size(); }
+    VertexLayout GetBlockLayout(uint32_t block) const { return m_Blocks[block].Layout; }
+    VkBuffer GetVertexBuffer(uint32_t block) const;
+    VkBuffer GetIndexBuffer(uint32_t block) const;
+    GeometryPoolStats GetStats() const;
+
+private:
+    struct Range
+    {
+        uint32_t Offset;
+        uint32_t Count;
+    };
+
+    // Free ranges of one buffer, sorted by offset and never adjacent.
+    struct FreeList
+    {
+        std::vector<Range> Ranges;
+
+        bool Allocate(uint32_t count, uint32_t& offset);
+        void Free(uint32_t offset, uint32_t count);
+    };
+
+    struct Block
+    {
+        std::unique_ptr<class Buffer> VertexBuffer;
+        std::unique_ptr<class Buffer> IndexBuffer;
+        FreeList FreeVertices;
+        FreeList FreeIndices;
+        VertexLayout Layout;
+    };
+
+    struct PendingFree
+    {
+        GeometryAllocation Allocation;
+        uint64_t ReleaseFrame;
+    };
+
+    void CreateBlock(VertexLayout layout, uint32_t vertexCount, uint32_t indexCount);
+    void Release(const GeometryAllocation& allocation);
+
+private:
+    class RenderContext* m_Context;
+    uint32_t m_BlockVertexCount;
+    uint32_t m_BlockIndexCount;
+
+    std::vector<Block> m_Blocks;
+    std::vector<PendingFree> m_PendingFrees;
+    uint64_t m_FrameNumber{ 0 };
+
+    uint32_t m_MeshCount{ 0 };
+    uint32_t m_VertexCount{ 0 };
+    uint32_t m_IndexCount{ 0 };
+    uint64_t m_VertexBytes{ 0 };
+};
+}
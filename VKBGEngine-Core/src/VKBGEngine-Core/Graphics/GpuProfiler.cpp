@@ -0,0 +1,177 @@
+#include "GpuProfiler.h"
+#include "RenderContext.h"
+
+namespace vkbg
+{
+GpuProfiler::GpuProfiler(RenderContext* context, uint32_t framesInFlight)
+    : m_Context{ context }
+{
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_Context->GetPhysicalDevice(), &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_Context->GetPhysicalDevice(), &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[m_Context->GetQueueFamilies().GraphicsFamily.value()].timestampValidBits;
+    if (validBits == 0)
+    {
+        LOG("GpuProfiler: the graphics queue doesn't support timestamps, GPU timings are disabled\n");
+        return;
+    }
+
+    m_Enabled = true;
+    m_TimestampPeriod = m_Context->GetPhysicalDeviceProperties().limits.timestampPeriod;
+    m_TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    m_Timestamps.resize(MaxScopesPerFrame * 2);
+
+    VkQueryPoolCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = MaxScopesPerFrame * 2
+    };
+
+    m_Frames.resize(framesInFlight);
+    for (auto& frame : m_Frames)
+    {
+        if (vkCreateQueryPool(m_Context->GetLogicalDevice(), &createInfo, nullptr, &frame.QueryPool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create timestamp query pool");
+        frame.ScopeNames.reserve(MaxScopesPerFrame);
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    for (auto& frame : m_Frames)
+        vkDestroyQueryPool(m_Context->GetLogicalDevice(), frame.QueryPool, nullptr);
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    if (!m_Enabled)
+        return;
+
+    // the frame's fence has been waited on, so the previous results of this slot are done
+    FrameQueries& frame = m_Frames[frameIndex];
+    if (frame.Pending)
+        ReadBackResults(frame);
+
+    vkCmdResetQueryPool(commandBuffer, frame.QueryPool, 0, MaxScopesPerFrame * 2);
+    frame.ScopeNames.clear();
+    frame.QueryCount = 0;
+    frame.Pending = true;
+    m_CurrentFrame = &frame;
+}
+
+uint32_t GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const char* name)
+{
+    if (!m_Enabled || m_CurrentFrame == nullptr || m_CurrentFrame->QueryCount + 2 > MaxScopesPerFrame * 2)
+        return InvalidQuery;
+
+    uint32_t query = m_CurrentFrame->QueryCount;
+    m_CurrentFrame->QueryCount += 2;
+    m_CurrentFrame->ScopeNames.push_back(GetScopeNameId(name));
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_CurrentFrame->QueryPool, query);
+    return query;
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer commandBuffer, uint32_t query)
+{
+    if (query == InvalidQuery)
+        return;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_CurrentFrame->QueryPool, query + 1);
+}
+
+std::vector<GpuProfiler::ScopeStats> GpuProfiler::GetStats() const
+{
+    std::vector<ScopeStats> stats;
+    stats.reserve(m_Scopes.size());
+
+    std::vector<float> sorted;
+    for (const auto& scope : m_Scopes)
+    {
+        if (scope.SampleCount == 0)
+            continue;
+
+        sorted.assign(scope.Samples.begin(), scope.Samples.begin() + scope.SampleCount);
+        std::sort(sorted.begin(), sorted.end());
+
+        // nearest rank
+        size_t p99Rank = (size_t)std::ceil(0.99 * sorted.size());
+        float sum = std::accumulate(sorted.begin(), sorted.end(), 0.f);
+        uint32_t last = (scope.Next + HistorySize - 1) % HistorySize;
+
+        stats.push_back({
+            .Name = scope.Name,
+            .LastMs = scope.Samples[last],
+            .MinMs = sorted.front(),
+            .AvgMs = sum / sorted.size(),
+            .P99Ms = sorted[std::max<size_t>(p99Rank, 1) - 1],
+            .SampleCount = scope.SampleCount
+        });
+    }
+    return stats;
+}
+
+bool GpuProfiler::GetLastSample(const std::string& name, float& durationMs, uint64_t& sampleCount) const
+{
+    auto it = m_ScopeIds.find(name);
+    if (it == m_ScopeIds.end() || m_Scopes[it->second].SampleCount == 0)
+        return false;
+
+    const ScopeHistory& scope = m_Scopes[it->second];
+    durationMs = scope.Samples[(scope.Next + HistorySize - 1) % HistorySize];
+    sampleCount = scope.TotalSamples;
+    return true;
+}
+
+void GpuProfiler::LogStats() const
+{
+    for ([[maybe_unused]] const auto& scope : GetStats())
+    {
+        LOG("GPU " << scope.Name << ": avg " << scope.AvgMs << " ms, min " << scope.MinMs
+            << " ms, p99 " << scope.P99Ms << " ms (" << scope.SampleCount << " samples)\n");
+    }
+}
+
+void GpuProfiler::ReadBackResults(FrameQueries& frame)
+{
+    frame.Pending = false;
+    if (frame.QueryCount == 0)
+        return;
+
+    // no WAIT flag: if anything isn't available yet the frame is simply dropped
+    VkResult result = vkGetQueryPoolResults(
+        m_Context->GetLogicalDevice(),
+        frame.QueryPool,
+        0, frame.QueryCount,
+        frame.QueryCount * sizeof(uint64_t), m_Timestamps.data(),
+        sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT);
+
+    if (result != VK_SUCCESS)
+        return;
+
+    for (uint32_t i = 0; i < frame.ScopeNames.size(); ++i)
+    {
+        uint64_t begin = m_Timestamps[i * 2] & m_TimestampMask;
+        uint64_t end = m_Timestamps[i * 2 + 1] & m_TimestampMask;
+        // ticks * ns per tick
+        float durationMs = float((end - begin) & m_TimestampMask) * m_TimestampPeriod * 1e-6f;
+
+        ScopeHistory& scope = m_Scopes[frame.ScopeNames[i]];
+        scope.Samples[scope.Next] = durationMs;
+        scope.Next = (scope.Next + 1) % HistorySize;
+        scope.SampleCount = std::min(scope.SampleCount + 1, HistorySize);
+        ++scope.TotalSamples;
+    }
+}
+
+uint32_t GpuProfiler::GetScopeNameId(const char* name)
+{
+    auto [it, inserted] = m_ScopeIds.try_emplace(name, (uint32_t)m_Scopes.size());
+    if (inserted)
+        m_Scopes.push_back({ .Name = name });
+    return it->second;
+}
+}
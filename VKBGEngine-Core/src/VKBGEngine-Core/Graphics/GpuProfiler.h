@@ -0,0 +1,112 @@
+#pragma once
+
+namespace vkbg
+{
+// GPU timings from timestamp queries. Each frame in flight has its own query
+// pool; its results are read back (without waiting) the next time the same
+// frame slot begins, which is after its fence has signaled. Every scope name
+// keeps a rolling history of its durations.
+//
+// If the graphics queue doesn't support timestamps (timestampValidBits == 0)
+// the profiler stays disabled and every call is a no-op.
+class GpuProfiler
+{
+public:
+    static constexpr uint32_t MaxScopesPerFrame = 64;
+    static constexpr uint32_t HistorySize = 240;
+
+    struct ScopeStats
+    {
+        std::string Name;
+        float LastMs{ 0.f };
+        float MinMs{ 0.f };
+        float AvgMs{ 0.f };
+        float P99Ms{ 0.f };
+        uint32_t SampleCount{ 0 };
+    };
+
+    // Measures the GPU time of the commands recorded during its lifetime.
+    class Scope
+    {
+    public:
+        Scope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name)
+            : m_Profiler{ profiler }, m_CommandBuffer{ commandBuffer }
+        {
+            m_Query = m_Profiler ? m_Profiler->BeginScope(commandBuffer, name) : InvalidQuery;
+        }
+        ~Scope()
+        {
+            if (m_Profiler)
+                m_Profiler->EndScope(m_CommandBuffer, m_Query);
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        GpuProfiler* m_Profiler;
+        VkCommandBuffer m_CommandBuffer;
+        uint32_t m_Query;
+    };
+
+public:
+    GpuProfiler(class RenderContext* context, uint32_t framesInFlight);
+    ~GpuProfiler();
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    bool IsEnabled() const { return m_Enabled; }
+
+    // Must be recorded outside of a render pass, before any scope of the frame.
+    void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    // Returns the index of the begin query, to hand back to EndScope.
+    uint32_t BeginScope(VkCommandBuffer commandBuffer, const char* name);
+    void EndScope(VkCommandBuffer commandBuffer, uint32_t query);
+
+    std::vector<ScopeStats> GetStats() const;
+    // Latest duration of a scope, along with the total number of samples it has
+    // had so that callers polling every frame can tell a new sample from the
+    // previous one. Returns false if the scope has no sample yet.
+    bool GetLastSample(const std::string& name, float& durationMs, uint64_t& sampleCount) const;
+    void LogStats() const;
+
+private:
+    static constexpr uint32_t InvalidQuery = ~0u;
+
+    struct FrameQueries
+    {
+        VkQueryPool QueryPool{ VK_NULL_HANDLE };
+        // scope name id of each begin/end query pair
+        std::vector<uint32_t> ScopeNames;
+        uint32_t QueryCount{ 0 };
+        bool Pending{ false };
+    };
+
+    struct ScopeHistory
+    {
+        std::string Name;
+        std::array<float, HistorySize> Samples{};
+        uint32_t SampleCount{ 0 };
+        uint32_t Next{ 0 };
+        uint64_t TotalSamples{ 0 };
+    };
+
+    void ReadBackResults(FrameQueries& frame);
+    uint32_t GetScopeNameId(const char* name);
+
+private:
+    class RenderContext* m_Context;
+    bool m_Enabled{ false };
+    float m_TimestampPeriod{ 1.f };
+    uint64_t m_TimestampMask{ ~0ull };
+
+    std::vector<FrameQueries> m_Frames;
+    FrameQueries* m_CurrentFrame{ nullptr };
+
+    std::vector<ScopeHistory> m_Scopes;
+    std::unordered_map<std::string, uint32_t> m_ScopeIds;
+    std::vector<uint64_t> m_Timestamps;
+};
+}
@@ -0,0 +1,339 @@
+#include "MemoryAllocator.h"
+#include "RenderContext.h"
+
+namespace vkbg
+{
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+struct MemoryBlock
+{
+    VkDeviceMemory Memory{ VK_NULL_HANDLE };
+    VkDeviceSize Size{ 0 };
+    void* MappedData{ nullptr };
+    uint32_t MemoryTypeIndex{ 0 };
+    bool Linear{ true };
+
+    // offset -> size of every free range, kept sorted by offset so that a
+    // released range can be merged with its neighbours.
+    std::map<VkDeviceSize, VkDeviceSize> FreeRanges;
+    uint32_t AllocationCount{ 0 };
+    VkDeviceSize BytesInUse{ 0 };
+
+    bool TryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset)
+    {
+        auto best = FreeRanges.end();
+        VkDeviceSize bestOffset = 0;
+        for (auto it = FreeRanges.begin(); it != FreeRanges.end(); ++it)
+        {
+            VkDeviceSize alignedOffset = AlignUp(it->first, alignment);
+            if (alignedOffset + size > it->first + it->second)
+                continue;
+            if (best == FreeRanges.end() || it->second < best->second)
+            {
+                best = it;
+                bestOffset = alignedOffset;
+            }
+        }
+
+        if (best == FreeRanges.end())
+            return false;
+
+        VkDeviceSize rangeOffset = best->first;
+        VkDeviceSize rangeEnd = best->first + best->second;
+        FreeRanges.erase(best);
+
+        // Alignment padding in front stays in the free list.
+        if (bestOffset > rangeOffset)
+            FreeRanges.emplace(rangeOffset, bestOffset - rangeOffset);
+        if (bestOffset + size < rangeEnd)
+            FreeRanges.emplace(bestOffset + size, rangeEnd - (bestOffset + size));
+
+        ++AllocationCount;
+        BytesInUse += size;
+        outOffset = bestOffset;
+        return true;
+    }
+
+    void Release(VkDeviceSize offset, VkDeviceSize size)
+    {
+        --AllocationCount;
+        BytesInUse -= size;
+
+        auto it = FreeRanges.emplace(offset, size).first;
+
+        auto next = std::next(it);
+        if (next != FreeRanges.end() && it->first + it->second == next->first)
+        {
+            it->second += next->second;
+            FreeRanges.erase(next);
+        }
+
+        if (it != FreeRanges.begin())
+        {
+            auto prev = std::prev(it);
+            if (prev->first + prev->second == it->first)
+            {
+                prev->second += it->second;
+                FreeRanges.erase(it);
+            }
+        }
+    }
+};
+
+MemoryAllocator::MemoryAllocator(RenderContext* context)
+    : m_Context{ context }
+    , m_Device{ context->GetLogicalDevice() }
+{
+    // the block sizes and the flushes depend on the memory type's flags
+    vkGetPhysicalDeviceMemoryProperties(m_Context->GetPhysicalDevice(), &m_MemoryProperties);
+    m_NonCoherentAtomSize = std::max<VkDeviceSize>(m_Context->GetPhysicalDeviceProperties().limits.nonCoherentAtomSize, 1);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+    for (auto& pool : m_Pools)
+    {
+        for (auto& block : pool.Blocks)
+        {
+            if (block->AllocationCount > 0)
+                LOG("MemoryAllocator: " << block->AllocationCount << " allocation(s) still alive on shutdown\n");
+            vkFreeMemory(m_Device, block->Memory, nullptr);
+        }
+        pool.Blocks.clear();
+    }
+}
+
+Allocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linearResource)
+{
+    uint32_t memoryTypeIndex = m_Context->FindMemoryType(requirements.memoryTypeBits, properties);
+    VkDeviceSize blockSize = GetBlockSize(memoryTypeIndex);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    std::lock_guard lock{ m_Mutex };
+
+    if (requirements.size > blockSize / 2)
+        return AllocateDedicated(requirements.size, memoryTypeIndex);
+
+    Pool& pool = GetPool(memoryTypeIndex, linearResource);
+    VkDeviceSize offset = 0;
+    MemoryBlock* block = nullptr;
+    for (auto& candidate : pool.Blocks)
+    {
+        if (candidate->TryAllocate(requirements.size, alignment, offset))
+        {
+            block = candidate.get();
+            break;
+        }
+    }
+
+    if (block == nullptr)
+    {
+        std::unique_ptr<MemoryBlock> newBlock = CreateBlock(memoryTypeIndex, blockSize);
+        if (newBlock == nullptr)
+            return AllocateDedicated(requirements.size, memoryTypeIndex);
+
+        newBlock->Linear = linearResource;
+        if (!newBlock->TryAllocate(requirements.size, alignment, offset))
+        {
+            vkFreeMemory(m_Device, newBlock->Memory, nullptr);
+            throw std::runtime_error("Failed to allocate from a new memory block");
+        }
+        block = pool.Blocks.emplace_back(std::move(newBlock)).get();
+    }
+
+    return Allocation{
+        .Memory = block->Memory,
+        .Offset = offset,
+        .Size = requirements.size,
+        .MappedData = block->MappedData ? static_cast<char*>(block->MappedData) + offset : nullptr,
+        .MemoryTypeIndex = memoryTypeIndex,
+        .Block = block
+    };
+}
+
+void MemoryAllocator::Free(Allocation& allocation)
+{
+    if (!allocation.IsValid())
+        return;
+
+    std::lock_guard lock{ m_Mutex };
+
+    if (allocation.Block == nullptr)
+    {
+        vkFreeMemory(m_Device, allocation.Memory, nullptr);
+        --m_DedicatedAllocationCount;
+        m_DedicatedBytes -= allocation.Size;
+    }
+    else
+    {
+        MemoryBlock* block = allocation.Block;
+        block->Release(allocation.Offset, allocation.Size);
+
+        // Give empty blocks back to the driver, but keep the last one of each
+        // pool around so that a load/unload pattern doesn't thrash vkAllocateMemory.
+        Pool& pool = GetPool(block->MemoryTypeIndex, block->Linear);
+        if (block->AllocationCount == 0 && pool.Blocks.size() > 1)
+        {
+            vkFreeMemory(m_Device, block->Memory, nullptr);
+            std::erase_if(pool.Blocks, [block](const auto& b) { return b.get() == block; });
+        }
+    }
+
+    allocation = Allocation{};
+}
+
+VkResult MemoryAllocator::Flush(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset)
+{
+    VkMemoryPropertyFlags flags = m_MemoryProperties.memoryTypes[allocation.MemoryTypeIndex].propertyFlags;
+    if (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        return VK_SUCCESS;
+
+    VkMappedMemoryRange range = GetMappedRange(allocation, size, offset);
+    return vkFlushMappedMemoryRanges(m_Device, 1, &range);
+}
+
+VkResult MemoryAllocator::Invalidate(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset)
+{
+    VkMemoryPropertyFlags flags = m_MemoryProperties.memoryTypes[allocation.MemoryTypeIndex].propertyFlags;
+    if (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        return VK_SUCCESS;
+
+    VkMappedMemoryRange range = GetMappedRange(allocation, size, offset);
+    return vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
+}
+
+MemoryStats MemoryAllocator::GetStats()
+{
+    std::lock_guard lock{ m_Mutex };
+
+    MemoryStats stats{
+        .DedicatedAllocationCount = m_DedicatedAllocationCount,
+        .AllocationCount = m_DedicatedAllocationCount,
+        .BytesAllocated = m_DedicatedBytes,
+        .BytesInUse = m_DedicatedBytes,
+    };
+
+    for (auto& pool : m_Pools)
+    {
+        for (auto& block : pool.Blocks)
+        {
+            ++stats.BlockCount;
+            stats.AllocationCount += block->AllocationCount;
+            stats.BytesAllocated += block->Size;
+            stats.BytesInUse += block->BytesInUse;
+            stats.BytesFree += block->Size - block->BytesInUse;
+            stats.FreeRangeCount += (uint32_t)block->FreeRanges.size();
+            for (auto& [offset, size] : block->FreeRanges)
+                stats.LargestFreeRange = std::max(stats.LargestFreeRange, size);
+        }
+    }
+
+    return stats;
+}
+
+void MemoryAllocator::LogStats()
+{
+    [[maybe_unused]] MemoryStats stats = GetStats();
+    LOG("GPU memory:\n"
+        << "\tBlocks: " << stats.BlockCount << ", dedicated allocations: " << stats.DedicatedAllocationCount << '\n'
+        << "\tAllocations: " << stats.AllocationCount << '\n'
+        << "\tIn use: " << stats.BytesInUse / 1024 << " KiB / " << stats.BytesAllocated / 1024 << " KiB\n"
+        << "\tFree ranges: " << stats.FreeRangeCount << ", largest: " << stats.LargestFreeRange / 1024 << " KiB\n"
+        << "\tFragmentation: " << stats.GetFragmentation() * 100.f << "%\n");
+}
+
+std::unique_ptr<MemoryBlock> MemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size)
+{
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = size,
+        .memoryTypeIndex = memoryTypeIndex
+    };
+
+    VkDeviceMemory memory{};
+    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+        return nullptr;
+
+    auto block = std::make_unique<MemoryBlock>(MemoryBlock{
+        .Memory = memory,
+        .Size = size,
+        .MemoryTypeIndex = memoryTypeIndex,
+    });
+    block->FreeRanges.emplace(0, size);
+
+    if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        if (vkMapMemory(m_Device, memory, 0, VK_WHOLE_SIZE, 0, &block->MappedData) != VK_SUCCESS)
+        {
+            vkFreeMemory(m_Device, memory, nullptr);
+            throw std::runtime_error("Failed to map memory block");
+        }
+    }
+
+    return block;
+}
+
+Allocation MemoryAllocator::AllocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex)
+{
+    VkMemoryAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = size,
+        .memoryTypeIndex = memoryTypeIndex
+    };
+
+    Allocation allocation{
+        .Size = size,
+        .MemoryTypeIndex = memoryTypeIndex
+    };
+
+    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &allocation.Memory) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate device memory");
+
+    if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        if (vkMapMemory(m_Device, allocation.Memory, 0, VK_WHOLE_SIZE, 0, &allocation.MappedData) != VK_SUCCESS)
+        {
+            vkFreeMemory(m_Device, allocation.Memory, nullptr);
+            throw std::runtime_error("Failed to map dedicated allocation");
+        }
+    }
+
+    ++m_DedicatedAllocationCount;
+    m_DedicatedBytes += size;
+    return allocation;
+}
+
+VkDeviceSize MemoryAllocator::GetBlockSize(uint32_t memoryTypeIndex) const
+{
+    const VkMemoryType& type = m_MemoryProperties.memoryTypes[memoryTypeIndex];
+    VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[type.heapIndex].size;
+
+    VkDeviceSize blockSize = (type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        ? HostVisibleBlockSize
+        : DefaultBlockSize;
+
+    // Small heaps (e.g. the 256 MiB device local + host visible heap) shouldn't
+    // be eaten up by a couple of blocks.
+    return std::min(blockSize, heapSize / 8);
+}
+
+VkMappedMemoryRange MemoryAllocator::GetMappedRange(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset) const
+{
+    VkDeviceSize memorySize = allocation.Block ? allocation.Block->Size : allocation.Size;
+    VkDeviceSize begin = allocation.Offset + offset;
+    VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.Offset + allocation.Size : begin + size;
+
+    begin = begin / m_NonCoherentAtomSize * m_NonCoherentAtomSize;
+    end = std::min(AlignUp(end, m_NonCoherentAtomSize), memorySize);
+
+    return VkMappedMemoryRange{
+        .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        .memory = allocation.Memory,
+        .offset = begin,
+        .size = end - begin
+    };
+}
+}
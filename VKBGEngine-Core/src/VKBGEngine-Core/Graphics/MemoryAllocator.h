@@ -0,0 +1,106 @@
+#pragma once
+
+namespace vkbg
+{
+// A range of device memory handed out by the MemoryAllocator. Resources are
+// bound at Memory + Offset. MappedData already points at Offset when the
+// memory is host visible (blocks are persistently mapped), nullptr otherwise.
+struct Allocation
+{
+    VkDeviceMemory Memory{ VK_NULL_HANDLE };
+    VkDeviceSize Offset{ 0 };
+    VkDeviceSize Size{ 0 };
+    void* MappedData{ nullptr };
+    uint32_t MemoryTypeIndex{ 0 };
+
+    // Owning block, nullptr for dedicated allocations.
+    struct MemoryBlock* Block{ nullptr };
+
+    bool IsValid() const { return Memory != VK_NULL_HANDLE; }
+};
+
+struct MemoryStats
+{
+    uint32_t BlockCount{ 0 };
+    uint32_t DedicatedAllocationCount{ 0 };
+    uint32_t AllocationCount{ 0 };
+    // Bytes requested from the driver (blocks + dedicated allocations).
+    VkDeviceSize BytesAllocated{ 0 };
+    // Bytes handed out to resources, alignment padding included.
+    VkDeviceSize BytesInUse{ 0 };
+    VkDeviceSize BytesFree{ 0 };
+    VkDeviceSize LargestFreeRange{ 0 };
+    uint32_t FreeRangeCount{ 0 };
+
+    // 0 when all free space of the blocks is one contiguous range, tends to 1
+    // as the free space gets split into small ranges.
+    float GetFragmentation() const
+    {
+        return BytesFree == 0 ? 0.f : 1.f - float(LargestFreeRange) / float(BytesFree);
+    }
+};
+
+// Sub-allocates buffers and images out of large per-memory-type blocks instead
+// of calling vkAllocateMemory per resource. Each block keeps a free list of
+// ranges (best fit, coalesced on free). Linear resources (buffers) and optimal
+// tiling images never share a block, so bufferImageGranularity never has to be
+// accounted for between neighbours. Resources that are too big for a block get
+// their own dedicated allocation.
+class MemoryAllocator
+{
+public:
+    static constexpr VkDeviceSize DefaultBlockSize = 64ull * 1024 * 1024;
+    static constexpr VkDeviceSize HostVisibleBlockSize = 16ull * 1024 * 1024;
+
+    explicit MemoryAllocator(class RenderContext* context);
+    ~MemoryAllocator();
+
+    MemoryAllocator(const MemoryAllocator&) = delete;
+    MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+    Allocation Allocate(
+        const VkMemoryRequirements& requirements,
+        VkMemoryPropertyFlags properties,
+        bool linearResource);
+    void Free(Allocation& allocation);
+
+    // Flush/Invalidate a range relative to the allocation. The range is grown to
+    // nonCoherentAtomSize as required by the spec.
+    VkResult Flush(const Allocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+    VkResult Invalidate(const Allocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+    MemoryStats GetStats();
+    void LogStats();
+
+private:
+    struct Pool
+    {
+        std::vector<std::unique_ptr<MemoryBlock>> Blocks;
+    };
+
+    std::unique_ptr<MemoryBlock> CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size);
+    Allocation AllocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex);
+    VkDeviceSize GetBlockSize(uint32_t memoryTypeIndex) const;
+    VkMappedMemoryRange GetMappedRange(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset) const;
+
+    Pool& GetPool(uint32_t memoryTypeIndex, bool linearResource)
+    {
+        return m_Pools[memoryTypeIndex * 2 + (linearResource ? 0 : 1)];
+    }
+
+private:
+    // references
+    class RenderContext* m_Context;
+
+private:
+    VkDevice m_Device;
+    VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+    VkDeviceSize m_NonCoherentAtomSize{ 1 };
+
+    std::array<Pool, VK_MAX_MEMORY_TYPES * 2> m_Pools;
+    uint32_t m_DedicatedAllocationCount{ 0 };
+    VkDeviceSize m_DedicatedBytes{ 0 };
+
+    std::mutex m_Mutex;
+};
+}
@@ -0,0 +1,165 @@
+#include "MeshCache.h"
+#include "Helper.h"
+#include "Profiling/Profiler.h"
+
+namespace vkbg
+{
+static_assert(std::is_trivially_copyable_v<Model::Vertex>, "Model::Vertex is written to disk as raw bytes");
+
+static uint64_t HashSourcePath(const std::string& sourcePath)
+{
+    std::string normalized = std::filesystem::path(sourcePath).lexically_normal().generic_string();
+    return HashBytes(normalized.data(), normalized.size());
+}
+
+std::filesystem::path MeshCache::GetCachePath(const std::string& sourcePath)
+{
+    std::stringstream fileName;
+    fileName << std::filesystem::path(sourcePath).stem().string()
+        << '-' << std::hex << HashSourcePath(sourcePath) << ".vkbgmesh";
+    return std::filesystem::path(CacheDirectory) / fileName.str();
+}
+
+bool MeshCache::HashSourceContent(const std::string& sourcePath, uint64_t& hash)
+{
+    MappedFile source{};
+    if (source.Open(sourcePath) == false)
+        return false;
+
+    hash = HashBytes(source.GetData(), source.GetSize());
+    return true;
+}
+
+bool MeshCache::Load(const std::string& sourcePath, MeshCacheEntry& entry)
+{
+    VKBG_PROFILE_FUNCTION();
+
+    std::error_code error;
+    const auto sourceSize = std::filesystem::file_size(sourcePath, error);
+    if (error)
+        return false;
+    const auto sourceWriteTime = std::filesystem::last_write_time(sourcePath, error);
+    if (error)
+        return false;
+
+    MappedFile cacheFile{};
+    if (cacheFile.Open(GetCachePath(sourcePath).string()) == false)
+        return false;
+
+    if (cacheFile.GetSize() < sizeof(Header))
+        return false;
+
+    Header header{};
+    memcpy(&header, cacheFile.GetData(), sizeof(Header));
+
+    if (header.Magic != Magic
+        || header.Version != Version
+        || header.VertexStride != sizeof(Model::Vertex)
+        || header.SourcePathHash != HashSourcePath(sourcePath)
+        || header.SourceSize != (uint64_t)sourceSize
+        || header.LodCount > Model::MaxLodCount)
+        return false;
+
+    const size_t expectedSize = sizeof(Header)
+        + (size_t)header.VertexCount * sizeof(Model::Vertex)
+        + (size_t)header.IndexCount * sizeof(uint32_t)
+        + (size_t)header.LodCount * sizeof(Model::LodLevel);
+    if (cacheFile.GetSize() != expectedSize)
+        return false;
+
+    // the write time is only a shortcut, a touched but identical source is still a hit
+    if (header.SourceWriteTime != (int64_t)sourceWriteTime.time_since_epoch().count())
+    {
+        uint64_t contentHash{ 0 };
+        if (HashSourceContent(sourcePath, contentHash) == false || contentHash != header.SourceContentHash)
+            return false;
+    }
+
+    const uint8_t* vertexData = cacheFile.GetData() + sizeof(Header);
+    const uint8_t* indexData = vertexData + (size_t)header.VertexCount * sizeof(Model::Vertex);
+    const uint8_t* lodData = indexData + (size_t)header.IndexCount * sizeof(uint32_t);
+    for (uint32_t i = 0; i < header.LodCount; ++i)
+    {
+        Model::LodLevel lod{};
+        memcpy(&lod, lodData + i * sizeof(Model::LodLevel), sizeof(Model::LodLevel));
+        if ((uint64_t)lod.FirstIndex + lod.IndexCount > header.IndexCount)
+            return false;
+    }
+
+    // a corrupt index would turn into an out of bounds fetch on the GPU, parse the OBJ instead
+    const uint32_t* indices = reinterpret_cast<const uint32_t*>(indexData);
+    for (uint32_t i = 0; i < header.IndexCount; ++i)
+    {
+        if (indices[i] >= header.VertexCount)
+            return false;
+    }
+
+    entry.Vertices = reinterpret_cast<const Model::Vertex*>(vertexData);
+    entry.VertexCount = header.VertexCount;
+    entry.Indices = header.IndexCount > 0 ? indices : nullptr;
+    entry.IndexCount = header.IndexCount;
+    entry.Lods = header.LodCount > 0 ? reinterpret_cast<const Model::LodLevel*>(lodData) : nullptr;
+    entry.LodCount = header.LodCount;
+    entry.File = std::move(cacheFile);
+    return true;
+}
+
+bool MeshCache::Store(const std::string& sourcePath, const Model::Builder& builder)
+{
+    VKBG_PROFILE_FUNCTION();
+
+    std::error_code error;
+    const auto sourceSize = std::filesystem::file_size(sourcePath, error);
+    if (error)
+        return false;
+    const auto sourceWriteTime = std::filesystem::last_write_time(sourcePath, error);
+    if (error)
+        return false;
+
+    Header header{
+        .Magic = Magic,
+        .Version = Version,
+        .VertexStride = sizeof(Model::Vertex),
+        .VertexCount = (uint32_t)builder.Vertices.size(),
+        .IndexCount = (uint32_t)builder.Indices.size(),
+        .LodCount = (uint32_t)builder.Lods.size(),
+        .SourcePathHash = HashSourcePath(sourcePath),
+        .SourceWriteTime = (int64_t)sourceWriteTime.time_since_epoch().count(),
+        .SourceSize = (uint64_t)sourceSize,
+        .SourceContentHash = 0
+    };
+    if (HashSourceContent(sourcePath, header.SourceContentHash) == false)
+        return false;
+
+    const std::filesystem::path cachePath = GetCachePath(sourcePath);
+    std::filesystem::create_directories(cachePath.parent_path(), error);
+    if (error)
+        return false;
+
+    // write next to the real file and swap it in, so a crash never leaves a truncated cache behind.
+    // Each writer gets its own temp file since the same OBJ can be loaded on several jobs at once.
+    static std::atomic<uint32_t> s_TempFileCounter{ 0 };
+    std::filesystem::path tempPath = cachePath;
+    tempPath += "." + std::to_string(s_TempFileCounter.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        file.write((const char*)&header, sizeof(Header));
+        file.write((const char*)builder.Vertices.data(), builder.Vertices.size() * sizeof(Model::Vertex));
+        file.write((const char*)builder.Indices.data(), builder.Indices.size() * sizeof(uint32_t));
+        file.write((const char*)builder.Lods.data(), builder.Lods.size() * sizeof(Model::LodLevel));
+        if (!file.good())
+            return false;
+    }
+
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+}
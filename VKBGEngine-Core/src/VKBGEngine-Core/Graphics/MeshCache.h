@@ -0,0 +1,58 @@
+#pragma once
+#include "Model.h"
+#include "FileSystem/MappedFile.h"
+
+namespace vkbg
+{
+// A cached mesh mapped straight from disk. Vertices and Indices point into
+// the mapping and stay valid as long as the entry is alive.
+struct MeshCacheEntry
+{
+    MappedFile File;
+    const Model::Vertex* Vertices{ nullptr };
+    uint32_t VertexCount{ 0 };
+    const uint32_t* Indices{ nullptr };
+    uint32_t IndexCount{ 0 };
+    const Model::LodLevel* Lods{ nullptr };
+    uint32_t LodCount{ 0 };
+};
+
+// Binary cache of the deduplicated vertex/index arrays produced by
+// Model::Builder::LoadFromObj, so that later launches skip the OBJ parsing.
+//
+// File layout: Header | Model::Vertex[VertexCount] | uint32_t[IndexCount] | Model::LodLevel[LodCount]
+class MeshCache
+{
+public:
+    static constexpr uint32_t Magic = 0x4D424B56; // "VKBM"
+    // 2: the meshes are stored after Model::Builder::Optimize
+    // 3: the LOD chain follows the indices
+    static constexpr uint32_t Version = 3;
+    static constexpr const char* CacheDirectory = "res/Cache/Meshes";
+
+    struct Header
+    {
+        uint32_t Magic;
+        uint32_t Version;
+        uint32_t VertexStride;
+        uint32_t VertexCount;
+        uint32_t IndexCount;
+        uint32_t LodCount;
+        uint64_t SourcePathHash;
+        int64_t SourceWriteTime;
+        uint64_t SourceSize;
+        uint64_t SourceContentHash;
+    };
+
+    // Maps the cache of sourcePath into entry. Returns false if there is no cache
+    // or if it is stale (different format version, or the source has changed).
+    static bool Load(const std::string& sourcePath, MeshCacheEntry& entry);
+    // Writes the builder's arrays as the cache of sourcePath.
+    static bool Store(const std::string& sourcePath, const Model::Builder& builder);
+
+    static std::filesystem::path GetCachePath(const std::string& sourcePath);
+
+private:
+    static bool HashSourceContent(const std::string& sourcePath, uint64_t& hash);
+};
+}
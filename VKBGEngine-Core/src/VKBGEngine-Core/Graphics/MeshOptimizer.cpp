@@ -0,0 +1,311 @@
+#include "MeshOptimizer.h"
+
+namespace vkbg
+{
+static constexpr uint32_t ForsythCacheSize = 32;
+static constexpr uint32_t ForsythValenceTableSize = 32;
+static constexpr uint32_t InvalidTriangle = ~0u;
+// cache simulated to cut the clusters, the one AnalyzeVertexCache defaults to
+static constexpr uint32_t OverdrawCacheSize = 16;
+
+// Scores of Forsyth's article: the vertices of the last triangle all get 0.75
+// (the order they went in doesn't tell much), the other cached ones decay with
+// their position, and vertices with few triangles left get a boost so that
+// lone triangles aren't left behind to be drawn with a cold cache.
+struct ForsythScoreTables
+{
+    float Cache[ForsythCacheSize];
+    float Valence[ForsythValenceTableSize];
+
+    ForsythScoreTables()
+    {
+        for (uint32_t i = 0; i < ForsythCacheSize; ++i)
+            Cache[i] = i < 3 ? 0.75f : std::pow(1.f - (i - 3) / float(ForsythCacheSize - 3), 1.5f);
+        Valence[0] = 0.f;
+        for (uint32_t i = 1; i < ForsythValenceTableSize; ++i)
+            Valence[i] = 2.f * std::pow(float(i), -0.5f);
+    }
+};
+static const ForsythScoreTables s_ForsythScores{};
+
+static float ForsythVertexScore(int32_t cachePosition, uint32_t liveTriangleCount)
+{
+    float score = cachePosition >= 0 ? s_ForsythScores.Cache[cachePosition] : 0.f;
+    if (liveTriangleCount < ForsythValenceTableSize)
+        score += s_ForsythScores.Valence[liveTriangleCount];
+    else
+        score += 2.f * std::pow(float(liveTriangleCount), -0.5f);
+    return score;
+}
+
+VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats{};
+    if (indexCount < 3 || vertexCount == 0)
+        return stats;
+
+    // a vertex is in the cache while it is one of the last cacheSize loaded
+    std::vector<uint32_t> loadTimes(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t& loadTime = loadTimes[indices[i]];
+        if (time - loadTime > cacheSize)
+        {
+            loadTime = time++;
+            ++misses;
+        }
+    }
+
+    stats.ACMR = misses / float(indexCount / 3);
+    stats.ATVR = misses / float(vertexCount);
+    return stats;
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+    assert(indexCount % 3 == 0 && "The index buffer has to be a triangle list");
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles of each vertex, the ones still to draw first in its range
+    std::vector<uint32_t> liveTriangleCounts(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i)
+        ++liveTriangleCounts[indices[i]];
+    std::vector<uint32_t> firstVertexTriangles(vertexCount);
+    uint32_t offset = 0;
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        firstVertexTriangles[vertex] = offset;
+        offset += liveTriangleCounts[vertex];
+    }
+    std::vector<uint32_t> vertexTriangles(indexCount);
+    for (size_t i = 0; i < indexCount; ++i)
+        vertexTriangles[firstVertexTriangles[indices[i]]++] = (uint32_t)(i / 3);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+        firstVertexTriangles[vertex] -= liveTriangleCounts[vertex];
+
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+        vertexScores[vertex] = ForsythVertexScore(-1, liveTriangleCounts[vertex]);
+
+    const std::vector<uint32_t> source(indices, indices + indexCount);
+    std::vector<float> triangleScores(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        const uint32_t* corners = &source[triangle * 3];
+        triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+    }
+    std::vector<uint8_t> emitted(triangleCount, 0);
+
+    uint32_t cache[ForsythCacheSize + 3];
+    uint32_t cacheCount = 0;
+    uint32_t bestTriangle = (uint32_t)(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+    size_t nextTriangle = 0;
+    for (size_t output = 0; output < triangleCount; ++output)
+    {
+        if (bestTriangle == InvalidTriangle)
+        {
+            // nothing left to draw around the cache, go on with the first triangle not drawn yet
+            while (emitted[nextTriangle])
+                ++nextTriangle;
+            bestTriangle = (uint32_t)nextTriangle;
+        }
+
+        const uint32_t* corners = &source[(size_t)bestTriangle * 3];
+        memcpy(indices + output * 3, corners, 3 * sizeof(uint32_t));
+        emitted[bestTriangle] = 1;
+
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            const uint32_t vertex = corners[corner];
+            uint32_t* first = &vertexTriangles[firstVertexTriangles[vertex]];
+            uint32_t* last = first + liveTriangleCounts[vertex];
+            std::swap(*std::find(first, last, bestTriangle), *(last - 1));
+            --liveTriangleCounts[vertex];
+        }
+
+        // the vertices of the triangle move to the front of the LRU cache
+        uint32_t newCache[ForsythCacheSize + 3];
+        uint32_t newCacheCount = 0;
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            if (std::find(newCache, newCache + newCacheCount, corners[corner]) == newCache + newCacheCount)
+                newCache[newCacheCount++] = corners[corner];
+        }
+        for (uint32_t i = 0; i < cacheCount; ++i)
+        {
+            if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2])
+                newCache[newCacheCount++] = cache[i];
+        }
+
+        // rescore the vertices that moved, the ones pushed out of the cache included
+        for (uint32_t i = 0; i < newCacheCount; ++i)
+        {
+            const uint32_t vertex = newCache[i];
+            const float score = ForsythVertexScore(i < ForsythCacheSize ? (int32_t)i : -1, liveTriangleCounts[vertex]);
+            const float delta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+
+            const uint32_t* first = &vertexTriangles[firstVertexTriangles[vertex]];
+            for (const uint32_t* triangle = first; triangle != first + liveTriangleCounts[vertex]; ++triangle)
+                triangleScores[*triangle] += delta;
+        }
+
+        // the next triangle is the best one using a cached vertex
+        bestTriangle = InvalidTriangle;
+        float bestScore = 0.f;
+        cacheCount = std::min(newCacheCount, ForsythCacheSize);
+        for (uint32_t i = 0; i < cacheCount; ++i)
+        {
+            const uint32_t vertex = newCache[i];
+            cache[i] = vertex;
+
+            const uint32_t* first = &vertexTriangles[firstVertexTriangles[vertex]];
+            for (const uint32_t* triangle = first; triangle != first + liveTriangleCounts[vertex]; ++triangle)
+            {
+                if (bestTriangle == InvalidTriangle || triangleScores[*triangle] > bestScore)
+                {
+                    bestTriangle = *triangle;
+                    bestScore = triangleScores[*triangle];
+                }
+            }
+        }
+    }
+}
+
+void OptimizeOverdraw(
+    uint32_t* indices, size_t indexCount,
+    const float* positions, size_t positionStride, size_t vertexCount,
+    float threshold)
+{
+    assert(indexCount % 3 == 0 && "The index buffer has to be a triangle list");
+    const uint32_t triangleCount = (uint32_t)(indexCount / 3);
+    if (triangleCount == 0)
+        return;
+
+    // Cut the clusters, each one simulated from a cold cache since it may end
+    // up anywhere: where the cache has none of the vertices of the triangle and
+    // where the cluster has become about as good as the whole mesh.
+    const float meshACMR = AnalyzeVertexCache(indices, indexCount, vertexCount, OverdrawCacheSize).ACMR;
+    std::vector<uint32_t> clusterStarts;
+    std::vector<uint32_t> loadTimes(vertexCount, 0);
+    uint32_t time = OverdrawCacheSize + 1;
+    uint32_t clusterMisses = 0;
+    uint32_t clusterTriangles = 0;
+    auto isCached = [&](uint32_t vertex) { return time - loadTimes[vertex] <= OverdrawCacheSize; };
+    for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+        const uint32_t* corners = indices + (size_t)triangle * 3;
+        const bool hardBoundary = !isCached(corners[0]) && !isCached(corners[1]) && !isCached(corners[2]);
+        const bool softBoundary = clusterTriangles > 0 && clusterMisses <= threshold * meshACMR * clusterTriangles;
+        if (triangle == 0 || hardBoundary || softBoundary)
+        {
+            clusterStarts.push_back(triangle);
+            time += OverdrawCacheSize + 1;
+            clusterMisses = 0;
+            clusterTriangles = 0;
+        }
+
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+            if (isCached(corners[corner]) == false)
+            {
+                loadTimes[corners[corner]] = time++;
+                ++clusterMisses;
+            }
+        }
+        ++clusterTriangles;
+    }
+    if (clusterStarts.size() < 2)
+        return;
+    clusterStarts.push_back(triangleCount);
+
+    auto getPosition = [&](uint32_t vertex)
+    {
+        const float* position = reinterpret_cast<const float*>(
+            reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+        return glm::vec3{ position[0], position[1], position[2] };
+    };
+
+    glm::vec3 meshCenter{ 0.f };
+    for (size_t i = 0; i < indexCount; ++i)
+        meshCenter += getPosition(indices[i]);
+    meshCenter /= float(indexCount);
+
+    // Clusters facing away from the center are on the outside of the mesh and
+    // likely hide the others, they go first.
+    struct Cluster
+    {
+        uint32_t FirstTriangle;
+        uint32_t TriangleCount;
+        float Outwardness;
+    };
+    std::vector<Cluster> clusters(clusterStarts.size() - 1);
+    for (size_t i = 0; i < clusters.size(); ++i)
+    {
+        Cluster& cluster = clusters[i];
+        cluster.FirstTriangle = clusterStarts[i];
+        cluster.TriangleCount = clusterStarts[i + 1] - clusterStarts[i];
+
+        // area weighted, the cross products being twice the triangle areas
+        glm::vec3 center{ 0.f };
+        glm::vec3 normal{ 0.f };
+        float area = 0.f;
+        for (uint32_t triangle = cluster.FirstTriangle; triangle < clusterStarts[i + 1]; ++triangle)
+        {
+            const uint32_t* corners = indices + (size_t)triangle * 3;
+            const glm::vec3 p0 = getPosition(corners[0]);
+            const glm::vec3 p1 = getPosition(corners[1]);
+            const glm::vec3 p2 = getPosition(corners[2]);
+            const glm::vec3 triangleNormal = glm::cross(p1 - p0, p2 - p0);
+            const float triangleArea = glm::length(triangleNormal);
+            center += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal += triangleNormal;
+            area += triangleArea;
+        }
+        const float normalLength = glm::length(normal);
+        cluster.Outwardness = area > 0.f && normalLength > 0.f
+            ? glm::dot(center / area - meshCenter, normal / normalLength)
+            : 0.f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(),
+        [](const Cluster& a, const Cluster& b) { return a.Outwardness > b.Outwardness; });
+
+    const std::vector<uint32_t> source(indices, indices + indexCount);
+    uint32_t* output = indices;
+    for (const Cluster& cluster : clusters)
+    {
+        const size_t clusterIndexCount = (size_t)cluster.TriangleCount * 3;
+        memcpy(output, &source[(size_t)cluster.FirstTriangle * 3], clusterIndexCount * sizeof(uint32_t));
+        output += clusterIndexCount;
+    }
+}
+
+size_t OptimizeVertexFetch(
+    void* vertices, size_t vertexCount, uint32_t vertexSize,
+    uint32_t* indices, size_t indexCount)
+{
+    constexpr uint32_t Unused = ~0u;
+    std::vector<uint32_t> remap(vertexCount, Unused);
+    uint32_t newVertexCount = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        uint32_t& newIndex = remap[indices[i]];
+        if (newIndex == Unused)
+            newIndex = newVertexCount++;
+        indices[i] = newIndex;
+    }
+
+    uint8_t* bytes = static_cast<uint8_t*>(vertices);
+    const std::vector<uint8_t> source(bytes, bytes + vertexCount * vertexSize);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        if (remap[vertex] != Unused)
+            memcpy(bytes + (size_t)remap[vertex] * vertexSize, &source[vertex * vertexSize], vertexSize);
+    }
+    return newVertexCount;
+}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+namespace vkbg
+{
+// Post-transform vertex cache efficiency of an index buffer, simulated with a
+// FIFO cache of cacheSize vertices.
+// ACMR: vertices transformed per triangle, from 0.5 (ideal grid) to 3.
+// ATVR: vertices transformed per vertex of the mesh, 1 being ideal.
+struct VertexCacheStats
+{
+    float ACMR{ 0.f };
+    float ATVR{ 0.f };
+};
+
+struct MeshOptimizationStats
+{
+    VertexCacheStats Before;
+    VertexCacheStats After;
+};
+
+VertexCacheStats AnalyzeVertexCache(
+    const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = 16);
+
+// Reorders the triangles for the post-transform vertex cache with Forsyth's
+// linear-speed vertex cache optimization: greedily picks the triangle whose
+// vertices score highest, a vertex scoring high when it's recent in a simulated
+// LRU cache and has few triangles left to draw.
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+// Reorders the clusters of an index buffer already optimized for the vertex
+// cache so that the outward facing ones are drawn first, the way Tipsify does
+// (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw"). The index buffer is cut where the optimizer started on a new area
+// and wherever the ACMR of the cluster so far, from a cold cache, is under
+// threshold times the ACMR of the whole mesh, so the ACMR can't get much worse
+// than threshold times its value. positions points to the first vertex's
+// position (3 floats), positionStride bytes apart.
+void OptimizeOverdraw(
+    uint32_t* indices, size_t indexCount,
+    const float* positions, size_t positionStride, size_t vertexCount,
+    float threshold = 1.05f);
+
+// Reorders the vertices (vertexSize bytes each) in the order the index buffer
+// first uses them, for the locality of the vertex fetches, and remaps the
+// indices. Vertices no index uses are dropped. Returns the new vertex count.
+size_t OptimizeVertexFetch(
+    void* vertices, size_t vertexCount, uint32_t vertexSize,
+    uint32_t* indices, size_t indexCount);
+}
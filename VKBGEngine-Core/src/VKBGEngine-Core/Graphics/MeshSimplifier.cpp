@@ -0,0 +1,518 @@
+#include "MeshSimplifier.h"
+#include "VertexWelder.h"
+
+namespace vkbg
+{
+static constexpr uint32_t NoVertex = ~0u;
+// borders are held in place harder than the rest of the surface
+static constexpr float BorderWeight = 10.f;
+
+// What a vertex can collapse onto:
+//   Manifold: any neighbor
+//   Border: the next or previous vertex of its border
+//   Seam: the next or previous vertex of its seam, the vertex on the other side
+//         of the seam (same position, other attributes) going along
+//   Locked: nothing, a corner, where borders and seams meet or a non manifold vertex
+enum class VertexKind : uint8_t
+{
+    Manifold,
+    Border,
+    Seam,
+    Locked
+};
+
+static bool CanCollapse(VertexKind from, VertexKind to)
+{
+    switch (from)
+    {
+    case VertexKind::Manifold: return true;
+    case VertexKind::Border: return to == VertexKind::Border || to == VertexKind::Locked;
+    case VertexKind::Seam: return to == VertexKind::Seam || to == VertexKind::Locked;
+    default: return false;
+    }
+}
+
+// Sum of weighted squared distances to planes, p.A.p + 2 b.p + c with A
+// symmetric. Error divides by the summed weights, giving the mean squared distance.
+struct Quadric
+{
+    float A00{ 0.f }, A11{ 0.f }, A22{ 0.f };
+    float A10{ 0.f }, A20{ 0.f }, A21{ 0.f };
+    float B0{ 0.f }, B1{ 0.f }, B2{ 0.f };
+    float C{ 0.f };
+    float Weight{ 0.f };
+
+    void AddPlane(const glm::vec3& normal, float distance, float weight)
+    {
+        A00 += weight * normal.x * normal.x;
+        A11 += weight * normal.y * normal.y;
+        A22 += weight * normal.z * normal.z;
+        A10 += weight * normal.y * normal.x;
+        A20 += weight * normal.z * normal.x;
+        A21 += weight * normal.z * normal.y;
+        B0 += weight * normal.x * distance;
+        B1 += weight * normal.y * distance;
+        B2 += weight * normal.z * distance;
+        C += weight * distance * distance;
+        Weight += weight;
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+        A00 += other.A00; A11 += other.A11; A22 += other.A22;
+        A10 += other.A10; A20 += other.A20; A21 += other.A21;
+        B0 += other.B0; B1 += other.B1; B2 += other.B2;
+        C += other.C;
+        Weight += other.Weight;
+        return *this;
+    }
+
+    float Error(const glm::vec3& p) const
+    {
+        const float rx = p.x * A00 + p.y * A10 + p.z * A20;
+        const float ry = p.x * A10 + p.y * A11 + p.z * A21;
+        const float rz = p.x * A20 + p.y * A21 + p.z * A22;
+        const float r = rx * p.x + ry * p.y + rz * p.z + 2.f * (B0 * p.x + B1 * p.y + B2 * p.z) + C;
+        return Weight > 0.f ? std::abs(r) / Weight : 0.f;
+    }
+};
+
+// The triangles around each vertex as the edge across from it, in winding
+// order: triangle (vertex, Next, Previous).
+struct EdgeAdjacency
+{
+    struct Edge
+    {
+        uint32_t Next;
+        uint32_t Previous;
+    };
+
+    std::vector<uint32_t> Offsets;
+    std::vector<Edge> Edges;
+
+    void Build(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+    {
+        Offsets.assign(vertexCount + 1, 0);
+        for (size_t i = 0; i < indexCount; ++i)
+            ++Offsets[indices[i] + 1];
+        for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+            Offsets[vertex + 1] += Offsets[vertex];
+
+        Edges.resize(indexCount);
+        std::vector<uint32_t> fill(Offsets.begin(), Offsets.end() - 1);
+        for (size_t i = 0; i < indexCount; i += 3)
+        {
+            const uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+            Edges[fill[a]++] = { b, c };
+            Edges[fill[b]++] = { c, a };
+            Edges[fill[c]++] = { a, b };
+        }
+    }
+
+    std::span<const Edge> GetEdges(uint32_t vertex) const
+    {
+        return { Edges.data() + Offsets[vertex], Edges.data() + Offsets[vertex + 1] };
+    }
+
+    bool HasEdge(uint32_t from, uint32_t to) const
+    {
+        for (const Edge& edge : GetEdges(from))
+        {
+            if (edge.Next == to)
+                return true;
+        }
+        return false;
+    }
+};
+
+struct Collapse
+{
+    uint32_t From;
+    uint32_t To;
+    // what the collapses are ranked by, the position error plus the attribute one
+    float Error;
+    float PositionError;
+};
+
+// Whether moving c to d flips triangle (a, b, c).
+static bool HasTriangleFlip(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d)
+{
+    const glm::vec3 eb = b - a;
+    return glm::dot(glm::cross(eb, c - a), glm::cross(eb, d - a)) <= 0.f;
+}
+
+// A vertex whose loop points to a collapsed vertex now points to where it went.
+static void RemapEdgeLoops(std::vector<uint32_t>& loops, const std::vector<uint32_t>& collapseRemap)
+{
+    for (uint32_t vertex = 0; vertex < loops.size(); ++vertex)
+    {
+        const uint32_t target = loops[vertex];
+        if (target == NoVertex)
+            continue;
+        // a seam collapsed against its loop leaves the vertex pointing to itself
+        const uint32_t remapped = collapseRemap[target];
+        loops[vertex] = vertex == remapped ? loops[target] : remapped;
+    }
+}
+
+size_t SimplifyMesh(
+    uint32_t* destination, const uint32_t* indices, size_t indexCount,
+    const float* positions, size_t positionStride, size_t vertexCount,
+    const SimplifyAttributes& attributes,
+    size_t targetIndexCount, float targetError, float* resultError)
+{
+    assert(indexCount % 3 == 0 && "The index buffer has to be a triangle list");
+    if (destination != indices)
+        memcpy(destination, indices, indexCount * sizeof(uint32_t));
+    if (resultError)
+        *resultError = 0.f;
+    if (indexCount == 0 || targetIndexCount >= indexCount)
+        return indexCount;
+
+    auto getPosition = [&](size_t vertex)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+    };
+    auto getAttributes = [&](uint32_t vertex)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(attributes.Data) + vertex * attributes.Stride);
+    };
+
+    // positions scaled to the unit cube, so that the errors don't depend on the size of the mesh
+    glm::vec3 min{ std::numeric_limits<float>::max() };
+    glm::vec3 max{ std::numeric_limits<float>::lowest() };
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        const float* position = getPosition(vertex);
+        min = glm::min(min, glm::vec3{ position[0], position[1], position[2] });
+        max = glm::max(max, glm::vec3{ position[0], position[1], position[2] });
+    }
+    float extent = std::max({ max.x - min.x, max.y - min.y, max.z - min.z });
+    extent = extent > 0.f ? extent : 1.f;
+    std::vector<glm::vec3> vertexPositions(vertexCount);
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        const float* position = getPosition(vertex);
+        vertexPositions[vertex] = (glm::vec3{ position[0], position[1], position[2] } - min) / extent;
+    }
+
+    // vertices sharing a position: remap goes to the first of them, and wedges
+    // links them in a ring
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint32_t> wedges(vertexCount);
+    {
+        VertexWelder welder{ 3 * sizeof(float), vertexCount };
+        std::vector<uint32_t> firstVertices;
+        for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            const uint32_t position = welder.Weld(getPosition(vertex));
+            if (position == firstVertices.size())
+                firstVertices.push_back(vertex);
+            remap[vertex] = firstVertices[position];
+            wedges[vertex] = vertex;
+        }
+        for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+        {
+            if (remap[vertex] != vertex)
+            {
+                wedges[vertex] = wedges[remap[vertex]];
+                wedges[remap[vertex]] = vertex;
+            }
+        }
+    }
+
+    EdgeAdjacency adjacency{};
+    adjacency.Build(destination, indexCount, vertexCount);
+
+    // Open edges have no triangle on the other side with the same vertices:
+    // borders, and seams since the other side has other attributes. openOut and
+    // openIn are the single open edge leaving and entering a vertex, the vertex
+    // itself when there are several.
+    std::vector<uint32_t> openOut(vertexCount, NoVertex);
+    std::vector<uint32_t> openIn(vertexCount, NoVertex);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        for (const auto& edge : adjacency.GetEdges(vertex))
+        {
+            if (adjacency.HasEdge(edge.Next, vertex) == false)
+            {
+                openOut[vertex] = openOut[vertex] == NoVertex ? edge.Next : vertex;
+                openIn[edge.Next] = openIn[edge.Next] == NoVertex ? vertex : edge.Next;
+            }
+        }
+    }
+
+    std::vector<VertexKind> kinds(vertexCount, VertexKind::Locked);
+    for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+    {
+        if (remap[vertex] != vertex)
+            continue;
+
+        auto hasSingleLoop = [&](uint32_t v)
+        {
+            return openOut[v] != NoVertex && openOut[v] != v && openIn[v] != NoVertex && openIn[v] != v;
+        };
+
+        VertexKind kind = VertexKind::Locked;
+        if (wedges[vertex] == vertex)
+        {
+            if (openOut[vertex] == NoVertex && openIn[vertex] == NoVertex)
+                kind = VertexKind::Manifold;
+            else if (hasSingleLoop(vertex))
+                kind = VertexKind::Border;
+        }
+        else if (wedges[wedges[vertex]] == vertex)
+        {
+            // two sides of a seam, their open edges have to run along the same positions, in opposite directions
+            const uint32_t other = wedges[vertex];
+            if (hasSingleLoop(vertex) && hasSingleLoop(other)
+                && remap[openIn[vertex]] == remap[openOut[other]]
+                && remap[openOut[vertex]] == remap[openIn[other]]
+                && remap[openIn[vertex]] != remap[openOut[vertex]])
+                kind = VertexKind::Seam;
+        }
+        // vertices of three or more attribute sets stay locked
+
+        for (uint32_t v = vertex;;)
+        {
+            kinds[v] = kind;
+            v = wedges[v];
+            if (v == vertex)
+                break;
+        }
+    }
+
+    // quadrics of the positions, indexed by their first vertex
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        const uint32_t corners[3]{ destination[i], destination[i + 1], destination[i + 2] };
+        const glm::vec3& p0 = vertexPositions[corners[0]];
+        const glm::vec3& p1 = vertexPositions[corners[1]];
+        const glm::vec3& p2 = vertexPositions[corners[2]];
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        const float area = glm::length(normal);
+        if (area == 0.f)
+            continue;
+        normal /= area;
+
+        Quadric triangle{};
+        triangle.AddPlane(normal, -glm::dot(normal, p0), area);
+        for (uint32_t corner : corners)
+            quadrics[remap[corner]] += triangle;
+
+        // planes through the open edges, perpendicular to the triangle, keep the borders and seams where they are
+        for (uint32_t k = 0; k < 3; ++k)
+        {
+            const uint32_t i0 = corners[k];
+            const uint32_t i1 = corners[(k + 1) % 3];
+            const VertexKind k0 = kinds[i0];
+            const VertexKind k1 = kinds[i1];
+            const bool onLoop0 = k0 == VertexKind::Border || k0 == VertexKind::Seam;
+            const bool onLoop1 = k1 == VertexKind::Border || k1 == VertexKind::Seam;
+            if (onLoop0 == false && onLoop1 == false)
+                continue;
+            if ((onLoop0 && openOut[i0] != i1) || (onLoop1 && openIn[i1] != i0))
+                continue;
+            // a seam edge is open on both of its sides, once is enough
+            if ((k0 == VertexKind::Seam || k1 == VertexKind::Seam) && remap[i1] > remap[i0])
+                continue;
+
+            const glm::vec3 edge = vertexPositions[i1] - vertexPositions[i0];
+            const float length = glm::length(edge);
+            if (length == 0.f)
+                continue;
+            const glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+            const float weight = k0 == VertexKind::Border || k1 == VertexKind::Border ? BorderWeight : 1.f;
+
+            Quadric edgeQuadric{};
+            edgeQuadric.AddPlane(edgeNormal, -glm::dot(edgeNormal, vertexPositions[i0]), length * length * weight);
+            quadrics[remap[i0]] += edgeQuadric;
+            quadrics[remap[i1]] += edgeQuadric;
+        }
+    }
+
+    auto attributeError = [&](uint32_t a, uint32_t b)
+    {
+        float error = 0.f;
+        if (attributes.Count == 0)
+            return error;
+        const float* attributesA = getAttributes(a);
+        const float* attributesB = getAttributes(b);
+        for (uint32_t k = 0; k < attributes.Count; ++k)
+        {
+            const float difference = (attributesA[k] - attributesB[k]) * attributes.Weights[k];
+            error += difference * difference;
+        }
+        return error;
+    };
+
+    // the vertex on the other side of the seam that from's twin goes to
+    auto getSeamTarget = [&](uint32_t from, uint32_t to)
+    {
+        const uint32_t twin = wedges[from];
+        const uint32_t twinTarget = openOut[from] == to ? openIn[twin] : openOut[twin];
+        return twinTarget != NoVertex && remap[twinTarget] == remap[to] ? twinTarget : NoVertex;
+    };
+
+    // a border or seam vertex only moves along its loop
+    auto evaluate = [&](uint32_t from, uint32_t to, Collapse& collapse)
+    {
+        const VertexKind kind = kinds[from];
+        if (CanCollapse(kind, kinds[to]) == false)
+            return false;
+        if ((kind == VertexKind::Border || kind == VertexKind::Seam) && openOut[from] != to && openIn[from] != to)
+            return false;
+
+        collapse.From = from;
+        collapse.To = to;
+        collapse.PositionError = quadrics[remap[from]].Error(vertexPositions[to]);
+        collapse.Error = collapse.PositionError + attributeError(from, to);
+        if (kind == VertexKind::Seam)
+        {
+            const uint32_t twinTarget = getSeamTarget(from, to);
+            if (twinTarget == NoVertex)
+                return false;
+            collapse.Error += attributeError(wedges[from], twinTarget);
+        }
+        return true;
+    };
+
+    auto hasTriangleFlips = [&](const std::vector<uint32_t>& collapseRemap, uint32_t from, uint32_t to)
+    {
+        const glm::vec3& p0 = vertexPositions[from];
+        const glm::vec3& p1 = vertexPositions[to];
+        for (const auto& edge : adjacency.GetEdges(from))
+        {
+            const uint32_t a = collapseRemap[edge.Next];
+            const uint32_t b = collapseRemap[edge.Previous];
+            // the triangles along the collapsed edge go away
+            if (remap[a] == remap[to] || remap[b] == remap[to])
+                continue;
+            if (HasTriangleFlip(vertexPositions[a], vertexPositions[b], p0, p1))
+                return true;
+        }
+        return false;
+    };
+
+    // an edge between the positions of from and to, whatever their attributes
+    auto hasPositionEdge = [&](uint32_t from, uint32_t to)
+    {
+        for (uint32_t vertex = from;;)
+        {
+            for (const auto& edge : adjacency.GetEdges(vertex))
+            {
+                if (remap[edge.Next] == remap[to])
+                    return true;
+            }
+            vertex = wedges[vertex];
+            if (vertex == from)
+                return false;
+        }
+    };
+
+    const float errorLimit = (targetError / extent) * (targetError / extent);
+    float worstError = 0.f;
+    size_t resultCount = indexCount;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> collapseRemap(vertexCount);
+    std::vector<uint8_t> collapseLocked(vertexCount);
+    while (resultCount > targetIndexCount)
+    {
+        // every edge once, in the direction that costs the least
+        collapses.clear();
+        for (size_t i = 0; i < resultCount; ++i)
+        {
+            const uint32_t i0 = destination[i];
+            const uint32_t i1 = destination[i % 3 == 2 ? i - 2 : i + 1];
+            if (remap[i0] == remap[i1])
+                continue;
+
+            // collapses past the error limit never happen, no need to sort them
+            Collapse forward{};
+            Collapse backward{};
+            const bool canForward = evaluate(i0, i1, forward) && forward.PositionError <= errorLimit;
+            const bool canBackward = evaluate(i1, i0, backward) && backward.PositionError <= errorLimit;
+            // an edge with a triangle on the other side (seams included) shows up
+            // twice, checked last since a position shared by many vertices makes it slow
+            if ((canForward || canBackward) == false || (remap[i1] > remap[i0] && hasPositionEdge(i1, i0)))
+                continue;
+            if (canForward && (canBackward == false || forward.Error <= backward.Error))
+                collapses.push_back(forward);
+            else if (canBackward)
+                collapses.push_back(backward);
+        }
+        if (collapses.empty())
+            break;
+        std::sort(collapses.begin(), collapses.end(),
+            [](const Collapse& a, const Collapse& b) { return a.Error < b.Error; });
+
+        // A manifold collapse removes two triangles. The pass stops well before
+        // the cheap collapses run out, at 1.5 times the error the goal would
+        // reach, so that the next pass can pick from updated costs.
+        const size_t triangleCollapseGoal = (resultCount - targetIndexCount) / 3;
+        const size_t edgeCollapseGoal = triangleCollapseGoal / 2;
+        const float errorGoal = edgeCollapseGoal < collapses.size()
+            ? collapses[edgeCollapseGoal].Error * 1.5f
+            : std::numeric_limits<float>::max();
+
+        std::iota(collapseRemap.begin(), collapseRemap.end(), 0u);
+        std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+        size_t triangleCollapses = 0;
+        size_t edgeCollapses = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (collapse.Error > errorGoal || triangleCollapses >= triangleCollapseGoal)
+                break;
+
+            const uint32_t from = collapse.From;
+            const uint32_t to = collapse.To;
+            // the cost of the collapses around a collapsed vertex changed, they wait for the next pass
+            if (collapseLocked[remap[from]] || collapseLocked[remap[to]])
+                continue;
+
+            const VertexKind kind = kinds[from];
+            const uint32_t twin = kind == VertexKind::Seam ? wedges[from] : NoVertex;
+            const uint32_t twinTarget = kind == VertexKind::Seam ? getSeamTarget(from, to) : NoVertex;
+            if (hasTriangleFlips(collapseRemap, from, to)
+                || (kind == VertexKind::Seam && hasTriangleFlips(collapseRemap, twin, twinTarget)))
+                continue;
+
+            collapseRemap[from] = to;
+            if (kind == VertexKind::Seam)
+                collapseRemap[twin] = twinTarget;
+            quadrics[remap[to]] += quadrics[remap[from]];
+            collapseLocked[remap[from]] = 1;
+            collapseLocked[remap[to]] = 1;
+
+            worstError = std::max(worstError, collapse.PositionError);
+            triangleCollapses += kind == VertexKind::Border ? 1 : 2;
+            ++edgeCollapses;
+        }
+        if (edgeCollapses == 0)
+            break;
+
+        // the triangles that had both ends of a collapsed edge are now degenerate
+        size_t writeCount = 0;
+        for (size_t i = 0; i < resultCount; i += 3)
+        {
+            const uint32_t a = collapseRemap[destination[i]];
+            const uint32_t b = collapseRemap[destination[i + 1]];
+            const uint32_t c = collapseRemap[destination[i + 2]];
+            if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+                continue;
+            destination[writeCount++] = a;
+            destination[writeCount++] = b;
+            destination[writeCount++] = c;
+        }
+        resultCount = writeCount;
+        RemapEdgeLoops(openOut, collapseRemap);
+        RemapEdgeLoops(openIn, collapseRemap);
+        adjacency.Build(destination, resultCount, vertexCount);
+    }
+
+    if (resultError)
+        *resultError = std::sqrt(worstError) * extent;
+    return resultCount;
+}
+}
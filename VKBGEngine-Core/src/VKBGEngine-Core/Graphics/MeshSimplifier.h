@@ -0,0 +1,37 @@
+#pragma once
+
+namespace vkbg
+{
+// Vertex attributes weighed by the simplifier: Count floats starting at Data,
+// Stride bytes from one vertex to the next, each one scaled by its weight.
+struct SimplifyAttributes
+{
+    const float* Data{ nullptr };
+    size_t Stride{ 0 };
+    const float* Weights{ nullptr };
+    uint32_t Count{ 0 };
+};
+
+// Simplifies a triangle list by edge collapses, cheapest first by quadric error
+// metric (Garland and Heckbert, with the area weighted plane quadrics of the
+// triangles and edge quadrics keeping the borders in place), until there are
+// targetIndexCount indices left or a collapse would move the surface further
+// than targetError (in position units).
+//
+// A vertex only ever collapses onto one of its neighbors, so the simplified
+// indices use the same vertex buffer. Attributes are preserved by ranking the
+// collapses with the difference of the attributes as well, and by only
+// collapsing vertices on a border or an attribute seam (vertices sharing a
+// position) along that border or seam, both sides of a seam together.
+// Collapses that would flip a triangle are skipped.
+//
+// positions points to the first vertex's position (3 floats), positionStride
+// bytes apart. Writes the indices to destination, which has to hold
+// indexCount of them, and returns how many there are. resultError, when not
+// null, gets the error of the worst collapse done.
+size_t SimplifyMesh(
+    uint32_t* destination, const uint32_t* indices, size_t indexCount,
+    const float* positions, size_t positionStride, size_t vertexCount,
+    const SimplifyAttributes& attributes,
+    size_t targetIndexCount, float targetError, float* resultError = nullptr);
+}
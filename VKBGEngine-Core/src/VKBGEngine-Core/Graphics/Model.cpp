@@ -1,200 +1,308 @@
 #include "Buffer.h"
 #include "Model.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
 #include "RenderContext.h"
+#include "Profiling/Profiler.h"
+#include "Threading/JobSystem.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
-#define GLM_ENABLE_EXPERIMENTAL
-#include "glm/gtx/hash.hpp"
-
-#include "Helper.h"
-
-namespace std
+namespace vkbg
 {
-template<>
-struct hash <vkbg::Model::Vertex>
+Model::Model(RenderContext* context, const Model::Builder& builder)
+    : Model(
+        context,
+        builder.Vertices.data(), (uint32_t)builder.Vertices.size(),
+        builder.Indices.data(), (uint32_t)builder.Indices.size(),
+        builder.Lods,
+        builder.Layout)
 {
-    size_t operator()(const vkbg::Model::Vertex& vertex) const
-    {
-        size_t seed = 0;
-        vkbg::HashCombine(seed, vertex.Position, vertex.Color, vertex.Normal, vertex.UV);
-        return seed;
-    }
-};
 }
 
-namespace vkbg
-{
-Model::Model(RenderContext* context, const Model::Builder& builder)
+Model::Model(
+    RenderContext* context,
+    const Vertex* vertices, uint32_t vertexCount,
+    const uint32_t* indices, uint32_t indexCount,
+    std::span<const LodLevel> lods,
+    VertexLayout layout)
     : m_Context(context)
+    , m_Lods(lods.begin(), lods.end())
+    , m_VertexLayout(layout)
 {
-    CreateVertexBuffer(builder.Vertices);
-    if (builder.Indices.size() > 0)
+    assert(vertexCount >= 3 && "vertext count must be at least 3");
+    ComputeBounds(vertices, vertexCount);
+
+    std::vector<uint32_t> sequentialIndices;
+    if (indexCount == 0)
+    {
+        sequentialIndices.resize(vertexCount);
+        std::iota(sequentialIndices.begin(), sequentialIndices.end(), 0u);
+        indices = sequentialIndices.data();
+        indexCount = vertexCount;
+    }
+
+    if (m_Lods.empty())
+        m_Lods.push_back({ 0, indexCount, 0.f });
+    assert(m_Lods.size() <= MaxLodCount && "Too many levels of detail");
+
+    std::vector<uint8_t> quantizedVertices;
+    const void* vertexData = vertices;
+    if (m_VertexLayout != VertexLayout::Float)
     {
-        CreateIndexBuffer(builder.Indices);
-        m_HasIndexBuffer = true;
+        // one scale for the three axes, the largest side of the box over the unorm range
+        const glm::vec3 extent = m_BoundingBox.Max - m_BoundingBox.Min;
+        const float maxExtent = std::max({ extent.x, extent.y, extent.z });
+        m_QuantizationOffset = m_BoundingBox.Min;
+        m_QuantizationScale = maxExtent > 0.f ? maxExtent : 1.f;
+        quantizedVertices = QuantizeVertices(vertices, vertexCount, m_VertexLayout, m_QuantizationOffset, m_QuantizationScale);
+        vertexData = quantizedVertices.data();
     }
+
+    m_Geometry = m_Context->GetGeometryPool()->Allocate(
+        m_VertexLayout, vertexData, vertexCount, indices, indexCount, m_UploadTicket);
 }
 
 Model::~Model()
 {
+    m_Context->GetGeometryPool()->Free(m_Geometry, m_UploadTicket);
 }
 
-void Model::Bind(VkCommandBuffer commandBuffer)
+bool Model::IsReady()
 {
-    VkBuffer buffers[]{ m_VertexBuffer->GetBuffer()};
-    VkDeviceSize offsets[]{ 0 };
+    return m_Context->GetUploadManager()->IsComplete(m_UploadTicket);
+}
 
-    vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+void Model::Bind(VkCommandBuffer commandBuffer)
+{
+    m_Context->GetGeometryPool()->Bind(commandBuffer, m_Geometry.Block);
+}
 
-    if (m_HasIndexBuffer)
-        vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+void Model::Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod)
+{
+    const LodLevel& level = m_Lods[lod];
+    vkCmdDrawIndexed(
+        commandBuffer, level.IndexCount, instanceCount, m_Geometry.FirstIndex + level.FirstIndex, m_Geometry.VertexOffset, firstInstance);
 }
 
-void Model::Draw(VkCommandBuffer commandBuffer)
+MeshOptimizationStats Model::Builder::Optimize(bool optimizeOverdraw)
 {
-    if (m_HasIndexBuffer)
-        vkCmdDrawIndexed(commandBuffer, m_IndexCount, 1, 0, 0, 0);
-    else
-        vkCmdDraw(commandBuffer, m_VertexCount, 1, 0, 0);
+    VKBG_PROFILE_FUNCTION();
+
+    MeshOptimizationStats stats{};
+    if (Indices.empty())
+        return stats;
+
+    stats.Before = AnalyzeVertexCache(Indices.data(), Indices.size(), Vertices.size());
+    OptimizeVertexCache(Indices.data(), Indices.size(), Vertices.size());
+    if (optimizeOverdraw)
+        OptimizeOverdraw(Indices.data(), Indices.size(), &Vertices[0].Position.x, sizeof(Vertex), Vertices.size());
+    Vertices.resize(OptimizeVertexFetch(Vertices.data(), Vertices.size(), sizeof(Vertex), Indices.data(), Indices.size()));
+    stats.After = AnalyzeVertexCache(Indices.data(), Indices.size(), Vertices.size());
+    return stats;
 }
 
-std::unique_ptr<Model> Model::CreateModelFromObj(RenderContext* context, const std::string& filePath)
+void Model::Builder::GenerateLods(const LodSettings& settings)
 {
-    Builder builder{};
-    builder.LoadFromObj(filePath);
-    std::cout << "vertices count: " << builder.Vertices.size() << '\n';
-    return std::make_unique<Model>(context, builder);
+    VKBG_PROFILE_FUNCTION();
+
+    Lods.clear();
+    if (Indices.empty())
+        return;
+    Lods.push_back({ 0, (uint32_t)Indices.size(), 0.f });
+
+    glm::vec3 min{ Vertices[0].Position };
+    glm::vec3 max{ Vertices[0].Position };
+    for (const Vertex& vertex : Vertices)
+    {
+        min = glm::min(min, vertex.Position);
+        max = glm::max(max, vertex.Position);
+    }
+    const float maxError = settings.MaxError * std::max({ max.x - min.x, max.y - min.y, max.z - min.z });
+
+    // color, normal and UV, the UVs counting the most since a seam shows the most
+    static constexpr float AttributeWeights[]{ .1f, .1f, .1f, .25f, .25f, .25f, .5f, .5f };
+    static_assert(offsetof(Vertex, UV) - offsetof(Vertex, Color) == 6 * sizeof(float), "The attributes have to follow each other");
+    const SimplifyAttributes attributes{
+        .Data = &Vertices[0].Color.x,
+        .Stride = sizeof(Vertex),
+        .Weights = AttributeWeights,
+        .Count = 8
+    };
+
+    std::vector<uint32_t> previous = Indices;
+    std::vector<uint32_t> lodIndices(previous.size());
+    float error = 0.f;
+    const uint32_t lodCount = std::min(settings.LodCount, MaxLodCount);
+    while (Lods.size() < lodCount)
+    {
+        const size_t targetIndexCount = (size_t)(previous.size() / 3 * settings.TriangleRatio) * 3;
+        if (targetIndexCount == 0)
+            break;
+
+        // the errors of the levels add up, each one is simplified from the previous one
+        float lodError = 0.f;
+        const size_t indexCount = SimplifyMesh(
+            lodIndices.data(), previous.data(), previous.size(),
+            &Vertices[0].Position.x, sizeof(Vertex), Vertices.size(),
+            attributes, targetIndexCount, maxError - error, &lodError);
+        // a level that barely saves anything isn't worth its memory
+        if (indexCount == 0 || indexCount > (previous.size() + targetIndexCount) / 2)
+            break;
+
+        OptimizeVertexCache(lodIndices.data(), indexCount, Vertices.size());
+        error += lodError;
+        Lods.push_back({ (uint32_t)Indices.size(), (uint32_t)indexCount, error });
+        Indices.insert(Indices.end(), lodIndices.begin(), lodIndices.begin() + indexCount);
+        previous.assign(lodIndices.begin(), lodIndices.begin() + indexCount);
+    }
+
+    if (Lods.size() == 1)
+        Lods.clear();
 }
 
-void Model::CreateVertexBuffer(const std::vector<Vertex>& vertices)
+// The CPU side of loading an OBJ file, everything but the upload.
+struct ObjMeshData
 {
-    m_VertexCount = (uint32_t)vertices.size();
-    assert(m_VertexCount >= 3 && "vertext count must be at least 3");
-    VkDeviceSize vertexSize = sizeof(vertices[0]);
+    MeshCacheEntry Cached{};
+    bool IsCached{ false };
+    Model::Builder Builder{};
+};
+
+static void LoadObjMeshData(const std::string& filePath, ObjMeshData& mesh, JobSystem* jobSystem = nullptr)
+{
+    // warm path: the cached arrays are mapped and copied into the staging
+    // buffer, through the quantization for the compact layouts
+    if (MeshCache::Load(filePath, mesh.Cached))
+    {
+        LOG("Loaded " << filePath << " from the mesh cache\n");
+        mesh.IsCached = true;
+        return;
+    }
 
-    m_Context->CreateDeviceLocalBuffer(vertexSize, m_VertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_VertexBuffer, (void*)vertices.data());
+    mesh.Builder.LoadFromObj(filePath, jobSystem);
+    [[maybe_unused]] const MeshOptimizationStats stats = mesh.Builder.Optimize();
+    mesh.Builder.GenerateLods();
+    mesh.Builder.UseCompactLayout();
+    LOG(filePath << ": " << mesh.Builder.Vertices.size() << " vertices, ACMR " << stats.Before.ACMR << " -> " << stats.After.ACMR
+        << ", ATVR " << stats.Before.ATVR << " -> " << stats.After.ATVR
+        << ", " << std::max<size_t>(mesh.Builder.Lods.size(), 1) << " LODs\n");
+
+    if (MeshCache::Store(filePath, mesh.Builder) == false)
+        LOG("Failed to write the mesh cache of " << filePath << '\n');
+}
+
+static std::unique_ptr<Model> CreateModel(RenderContext* context, const ObjMeshData& mesh)
+{
+    if (mesh.IsCached)
+    {
+        return std::make_unique<Model>(
+            context,
+            mesh.Cached.Vertices, mesh.Cached.VertexCount,
+            mesh.Cached.Indices, mesh.Cached.IndexCount,
+            std::span{ mesh.Cached.Lods, mesh.Cached.LodCount },
+            Model::GetCompactLayout(mesh.Cached.Vertices, mesh.Cached.VertexCount));
+    }
+    return std::make_unique<Model>(context, mesh.Builder);
 }
 
-void Model::CreateIndexBuffer(const std::vector<uint32_t>& indices)
+std::unique_ptr<Model> Model::CreateModelFromObj(RenderContext* context, const std::string& filePath)
 {
-    m_IndexCount = (uint32_t)indices.size();
-    VkDeviceSize indexSize = sizeof(indices[0]);
+    VKBG_PROFILE_FUNCTION();
 
-    m_Context->CreateDeviceLocalBuffer(indexSize, m_IndexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_IndexBuffer, (void*)indices.data());
+    ObjMeshData mesh{};
+    LoadObjMeshData(filePath, mesh);
+    return CreateModel(context, mesh);
 }
 
-std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions()
+std::vector<std::unique_ptr<Model>> Model::CreateModelsFromObj(
+    RenderContext* context, const std::vector<std::string>& filePaths, JobSystem* jobSystem)
 {
-    std::vector<VkVertexInputBindingDescription> bindingDescriptions{
-        {
-            .binding = 0,
-            .stride = sizeof(Vertex),
-            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
-        }
-    };
-    return bindingDescriptions;
-}
-
-std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescriptions()
-{
-    std::vector<VkVertexInputAttributeDescription> attributeDescription{
-        {
-            .location = 0,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(Vertex, Position)
-        },
-        {
-            .location = 1,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(Vertex, Color)
-        },
-        {
-            .location = 2,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32B32_SFLOAT,
-            .offset = offsetof(Vertex, Normal)
-        },
-        {
-            .location = 3,
-            .binding = 0,
-            .format = VK_FORMAT_R32G32_SFLOAT,
-            .offset = offsetof(Vertex, UV)
-        }
+    VKBG_PROFILE_FUNCTION();
+
+    std::vector<ObjMeshData> meshes(filePaths.size());
+    auto loadMeshes = [&](uint32_t first, uint32_t last)
+    {
+        for (uint32_t i = first; i < last; ++i)
+            LoadObjMeshData(filePaths[i], meshes[i], jobSystem);
     };
-    return attributeDescription;
+    if (jobSystem)
+        jobSystem->ParallelFor((uint32_t)filePaths.size(), 1, loadMeshes);
+    else
+        loadMeshes(0, (uint32_t)filePaths.size());
+
+    std::vector<std::unique_ptr<Model>> models;
+    models.reserve(meshes.size());
+    for (const auto& mesh : meshes)
+        models.push_back(CreateModel(context, mesh));
+    return models;
 }
 
-////////////////////////////////////////////////////////
-// Builder /////////////////////////////////////////////
-////////////////////////////////////////////////////////
-void Model::Builder::LoadFromObj(const std::string& filePath)
+void Model::ComputeBounds(const Vertex* vertices, uint32_t vertexCount)
 {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
+    if (vertexCount == 0)
+        return;
 
-    if (tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filePath.data()) == false)
-        throw std::runtime_error(warn + err);
+    glm::vec3 min{ vertices[0].Position };
+    glm::vec3 max{ vertices[0].Position };
+    for (uint32_t i = 1; i < vertexCount; ++i)
+    {
+        min = glm::min(min, vertices[i].Position);
+        max = glm::max(max, vertices[i].Position);
+    }
+    m_BoundingBox = { min, max };
+
+    // centered on the box, a bit looser than the minimal sphere but stable and cheap
+    glm::vec3 center = (min + max) * .5f;
+    float radiusSquared = 0.f;
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        glm::vec3 d = vertices[i].Position - center;
+        radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+    }
+    m_BoundingSphere = { center, glm::sqrt(radiusSquared) };
+}
 
-    Vertices.clear();
-    Indices.clear();
+VertexLayout Model::GetCompactLayout(const Vertex* vertices, uint32_t vertexCount)
+{
+    constexpr float MaxHalf = 65504.f;
+    bool white = true;
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        const Vertex& vertex = vertices[i];
+        if (std::abs(vertex.UV.x) > MaxHalf || std::abs(vertex.UV.y) > MaxHalf)
+            return VertexLayout::Float;
+        if (glm::any(glm::lessThan(vertex.Color, glm::vec3{ 0.f })) || glm::any(glm::greaterThan(vertex.Color, glm::vec3{ 1.f })))
+            return VertexLayout::Float;
+        white = white && vertex.Color == glm::vec3{ 1.f };
+    }
+    return white ? VertexLayout::Quantized : VertexLayout::QuantizedColor;
+}
 
-    std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+std::vector<uint8_t> Model::QuantizeVertices(
+    const Vertex* vertices, uint32_t vertexCount, VertexLayout layout, const glm::vec3& offset, float scale)
+{
+    assert(layout != VertexLayout::Float && "The float layout is Vertex as is");
+    // round to nearest, the casts truncate toward zero
+    auto toUnorm16 = [](float value) { return (uint16_t)(std::clamp(value, 0.f, 1.f) * 65535.f + .5f); };
+    auto toSnorm16 = [](float value) { return (int16_t)(std::clamp(value, -1.f, 1.f) * 32767.f + (value >= 0.f ? .5f : -.5f)); };
+    auto toUnorm8 = [](float value) { return (uint8_t)(std::clamp(value, 0.f, 1.f) * 255.f + .5f); };
 
-    for (const auto& shape : shapes)
+    const uint32_t vertexSize = GetVertexSize(layout);
+    std::vector<uint8_t> quantizedVertices((size_t)vertexCount * vertexSize);
+    for (uint32_t i = 0; i < vertexCount; ++i)
     {
-        for (const auto& index : shape.mesh.indices)
-        {
-            Vertex vert{};
-            int32_t i{ 0 };
-            
-            if (index.vertex_index >= 0)
-            {
-                i = index.vertex_index;
-
-                vert.Position = {
-                    attrib.vertices[3 * i + 0],
-                    attrib.vertices[3 * i + 1],
-                    attrib.vertices[3 * i + 2]
-                };
-
-                vert.Color = {
-                    attrib.colors[3 * i + 0],
-                    attrib.colors[3 * i + 1],
-                    attrib.colors[3 * i + 2]
-                };
-            }
-            
-            if (index.normal_index >= 0)
-            {
-                i = index.normal_index;
-                vert.Normal = {
-                    attrib.normals[3 * i + 0],
-                    attrib.normals[3 * i + 1],
-                    attrib.normals[3 * i + 2],
-                };
-            }
-
-            if (index.texcoord_index >= 0)
-            {
-                i = index.texcoord_index;
-                vert.UV = {
-                    attrib.texcoords[2 * i + 0],
-                    attrib.texcoords[2 * i + 1],
-                };
-            }
-
-            if (uniqueVertices.count(vert) == 0)
-            {
-                uniqueVertices[vert] = (uint32_t)Vertices.size();
-                Vertices.push_back(vert);
-            }
-            Indices.push_back(uniqueVertices[vert]);
-        }
+        const Vertex& vertex = vertices[i];
+        const glm::vec3 position = (vertex.Position - offset) / scale;
+        const glm::vec2 normal = EncodeOctahedral(vertex.Normal);
+
+        QuantizedVertex quantized{
+            .Position = { toUnorm16(position.x), toUnorm16(position.y), toUnorm16(position.z), 0 },
+            .Normal = { toSnorm16(normal.x), toSnorm16(normal.y) },
+            .UV = { glm::packHalf1x16(vertex.UV.x), glm::packHalf1x16(vertex.UV.y) },
+            .Color = { toUnorm8(vertex.Color.r), toUnorm8(vertex.Color.g), toUnorm8(vertex.Color.b), 255 }
+        };
+        // the Quantized layout is the same vertex without its color
+        memcpy(quantizedVertices.data() + (size_t)i * vertexSize, &quantized, vertexSize);
     }
+    return quantizedVertices;
 }
 }
@@ -1,7 +1,22 @@
 #pragma once
+#include "GeometryPool.h"
+#include "MeshOptimizer.h"
+#include "VertexLayout.h"
 
 namespace vkbg
 {
+struct BoundingBox
+{
+    glm::vec3 Min{ 0.f };
+    glm::vec3 Max{ 0.f };
+};
+
+struct BoundingSphere
+{
+    glm::vec3 Center{ 0.f };
+    float Radius{ 0.f };
+};
+
 class Model
 {
 public:
@@ -12,9 +27,6 @@ public:
         glm::vec3 Normal;
         glm::vec2 UV;
 
-        static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions();
-        static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
-
         bool operator==(const Vertex& other) const
         {
             return Position == other.Position
@@ -24,36 +36,160 @@ public:
         }
     };
 
+    static constexpr uint32_t MaxLodCount = 8;
+
+    // A level of detail: a range of the model's indices drawing a simplified
+    // mesh out of the same vertices. Level 0 is the full detail mesh.
+    struct LodLevel
+    {
+        uint32_t FirstIndex;
+        uint32_t IndexCount;
+        // how far the surface may be from the full detail one, in model units
+        float Error;
+    };
+
+    struct LodSettings
+    {
+        // levels including the full detail one, up to MaxLodCount
+        uint32_t LodCount{ 4 };
+        // triangles of a level relative to the previous one
+        float TriangleRatio{ 0.5f };
+        // error the chain can't go past, relative to the largest side of the
+        // mesh's bounding box
+        float MaxError{ 0.05f };
+    };
+
+    // How LoadFromObj welded the corners of the faces into vertices. The
+    // probes per corner stay close to 1 as long as the welder tables don't
+    // cluster, whatever the number of threads.
+    struct ObjLoadStats
+    {
+        // false when the file went through tinyobjloader
+        bool Parallel{ false };
+        uint64_t CornerCount{ 0 };
+        // faces with indices out of range are skipped, tinyobjloader drops the
+        // quads with a position out of range before they are counted
+        uint32_t SkippedTriangleCount{ 0 };
+        uint64_t WeldProbeCount{ 0 };
+    };
+
     struct Builder
     {
         std::vector<Vertex> Vertices;
         std::vector<uint32_t> Indices;
+        // The levels stored one after the other in Indices, empty when there is
+        // only the full detail mesh.
+        std::vector<LodLevel> Lods;
+        // what the vertices are converted to when the model is created
+        VertexLayout Layout{ VertexLayout::Float };
 
-        void LoadFromObj(const std::string& filePath);
+        // Parses the OBJ file and welds its vertices. With a jobSystem the file is
+        // mapped and parsed in parallel (see ObjLoader.cpp) into the same vertices
+        // and indices, files the parallel parser can't handle fall back to
+        // tinyobjloader.
+        ObjLoadStats LoadFromObj(const std::string& filePath, class JobSystem* jobSystem = nullptr);
+        // Reorders the triangles for the vertex cache, then by cluster against
+        // overdraw when optimizeOverdraw is set, and the vertices for the fetches
+        // (see MeshOptimizer.h). Returns the vertex cache stats before and after.
+        MeshOptimizationStats Optimize(bool optimizeOverdraw = true);
+        // Simplifies the mesh into a chain of levels (see MeshSimplifier.h), each
+        // one from the previous one, and appends their indices. Stops early when a
+        // level can't get close enough to its triangle count within the error left.
+        void GenerateLods(const LodSettings& settings);
+        void GenerateLods() { GenerateLods(LodSettings{}); }
+        // Picks the smallest layout holding the vertices, see GetCompactLayout.
+        void UseCompactLayout() { Layout = GetCompactLayout(Vertices.data(), (uint32_t)Vertices.size()); }
     };
 
 public:
     Model(class RenderContext* context, const Builder& builder);
+    Model(
+        class RenderContext* context,
+        const Vertex* vertices, uint32_t vertexCount,
+        const uint32_t* indices, uint32_t indexCount,
+        std::span<const LodLevel> lods = {},
+        VertexLayout layout = VertexLayout::Float);
     ~Model();
 
     Model(const Model&) = delete;
     Model& operator=(const Model&) = delete;
 
+    // False while the vertex/index uploads are still in flight on the GPU.
+    // Drawing before that is fine, the upload batch is submitted ahead of the frame.
+    bool IsReady();
+
+    // Binds the buffers of the geometry pool block holding the mesh, shared by
+    // all the models of the block.
     void Bind(VkCommandBuffer commandBuffer);
-    void Draw(VkCommandBuffer commandBuffer);
+    void Draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0);
+
+    // At least one level, the full detail one covering all the indices when the
+    // model was built without LODs. FirstIndex is relative to the geometry's.
+    uint32_t GetLodCount() const { return (uint32_t)m_Lods.size(); }
+    const LodLevel& GetLod(uint32_t lod) const { return m_Lods[lod]; }
+
+    // Place of the mesh in the geometry pool. Every mesh is indexed, those built
+    // without indices get one index per vertex.
+    const GeometryAllocation& GetGeometry() const { return m_Geometry; }
+
+    // Local space bounds, computed from the vertices at build time.
+    const BoundingBox& GetBoundingBox() const { return m_BoundingBox; }
+    const BoundingSphere& GetBoundingSphere() const { return m_BoundingSphere; }
+
+    VertexLayout GetVertexLayout() const { return m_VertexLayout; }
+    // The matrix the shaders transform the stored positions with: world itself
+    // for the float layout, world times the mapping of the quantized positions
+    // back to local space otherwise.
+    glm::mat4 GetVertexToWorld(const glm::mat4& world) const
+    {
+        if (m_VertexLayout == VertexLayout::Float)
+            return world;
+        // world * translate(offset) * scale(scale)
+        return glm::mat4{
+            world[0] * m_QuantizationScale,
+            world[1] * m_QuantizationScale,
+            world[2] * m_QuantizationScale,
+            world * glm::vec4{ m_QuantizationOffset, 1.f } };
+    }
+    // The bounding sphere in the space of the stored positions, for the GPU
+    // culling which only knows GetVertexToWorld.
+    BoundingSphere GetVertexBoundingSphere() const
+    {
+        return {
+            (m_BoundingSphere.Center - m_QuantizationOffset) / m_QuantizationScale,
+            m_BoundingSphere.Radius / m_QuantizationScale };
+    }
+
+    // The smallest layout that holds the vertices: Quantized when they are all
+    // white, QuantizedColor when their colors are in [0, 1], and Float when the
+    // colors are out of that range or the UVs out of the half float range.
+    static VertexLayout GetCompactLayout(const Vertex* vertices, uint32_t vertexCount);
+    // Converts the vertices to a quantized layout (QuantizedVertex, without the
+    // color for Quantized), the positions stored as (position - offset) / scale.
+    static std::vector<uint8_t> QuantizeVertices(
+        const Vertex* vertices, uint32_t vertexCount, VertexLayout layout, const glm::vec3& offset, float scale);
 
     static std::unique_ptr<Model> CreateModelFromObj(class RenderContext* context, const std::string& filePath);
+    // Parses (or reads the mesh cache of) the files on jobSystem, each file split
+    // across the jobs as well, the models are then created on the calling thread
+    // since uploads aren't thread safe.
+    static std::vector<std::unique_ptr<Model>> CreateModelsFromObj(
+        class RenderContext* context, const std::vector<std::string>& filePaths, class JobSystem* jobSystem);
 
 private:
-    void CreateVertexBuffer(const std::vector<Vertex>& vertices);
-    void CreateIndexBuffer(const std::vector<uint32_t>& indices);
+    void ComputeBounds(const Vertex* vertices, uint32_t vertexCount);
     class RenderContext* m_Context;
 
-    std::unique_ptr<class Buffer> m_VertexBuffer;
-    uint32_t m_VertexCount;
+    GeometryAllocation m_Geometry{};
+    std::vector<LodLevel> m_Lods;
+    uint64_t m_UploadTicket{ 0 };
+
+    BoundingBox m_BoundingBox{};
+    BoundingSphere m_BoundingSphere{};
 
-    bool m_HasIndexBuffer{ false };
-    std::unique_ptr<class Buffer> m_IndexBuffer;
-    uint32_t m_IndexCount{ 0 };
+    // quantized positions are offset + scale * the unorms, identity for Float
+    VertexLayout m_VertexLayout{ VertexLayout::Float };
+    glm::vec3 m_QuantizationOffset{ 0.f };
+    float m_QuantizationScale{ 1.f };
 };
 }
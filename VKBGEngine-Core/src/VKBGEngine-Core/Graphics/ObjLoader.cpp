@@ -0,0 +1,703 @@
+#include "Model.h"
+#include "VertexWelder.h"
+#include "FileSystem/MappedFile.h"
+#include "Profiling/Profiler.h"
+#include "Threading/JobSystem.h"
+#include "Helper.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+namespace vkbg
+{
+// The welder compares vertices byte by byte.
+static_assert(sizeof(Model::Vertex) == 11 * sizeof(float), "Model::Vertex can't have padding");
+
+////////////////////////////////////////////////////////
+// Parallel parser /////////////////////////////////////
+////////////////////////////////////////////////////////
+// The file is mapped and cut at line boundaries into chunks parsed on the job
+// system. Each chunk keeps its own attributes and face corners, then the chunks
+// are merged: attributes are concatenated, relative (negative) indices get the
+// offset of their chunk, and the faces are triangulated the way tinyobjloader
+// does. Vertices are welded in parallel by hash partition, one VertexWelder per
+// partition going through its corners in file order, so that Vertices and
+// Indices come out exactly as the tinyobjloader path builds them.
+//
+// Polygons of more than 4 vertices (ear clipped by tinyobjloader) and lines
+// tinyobjloader rejects aren't handled, the file is then left to the serial path.
+
+// Smallest part of the file parsed by one job.
+static constexpr size_t MinObjChunkSize = 1u << 20;
+// Chunks per thread, so that a slow chunk doesn't hold the others back.
+static constexpr uint32_t ObjChunksPerThread = 4;
+
+// 0-based attribute indices of a face corner, -1 when the corner has none.
+struct ObjCorner
+{
+    int32_t Position{ -1 };
+    int32_t TexCoord{ -1 };
+    int32_t Normal{ -1 };
+};
+
+enum class ObjAttribute : uint8_t
+{
+    Position,
+    TexCoord,
+    Normal
+};
+
+// A corner index given relative to the end of the attributes read so far,
+// stored relative to the start of its chunk until the merge.
+struct ObjRelativeIndex
+{
+    uint32_t Corner;
+    ObjAttribute Attribute;
+};
+
+struct ObjChunk
+{
+    const char* Begin{ nullptr };
+    const char* End{ nullptr };
+
+    std::vector<float> Positions;
+    std::vector<float> Colors;
+    std::vector<float> Normals;
+    std::vector<float> TexCoords;
+    std::vector<ObjCorner> Corners;
+    // 3 or 4, the corners of the faces one after the other in Corners
+    std::vector<uint8_t> FaceSizes;
+    std::vector<ObjRelativeIndex> RelativeIndices;
+    // less the skipped ones once resolved
+    uint32_t TriangleCount{ 0 };
+    uint32_t SkippedTriangleCount{ 0 };
+    bool Unsupported{ false };
+    // a relative index pointing before the start of the file
+    bool InvalidIndex{ false };
+
+    // set by the merge
+    uint32_t FirstPosition{ 0 };
+    uint32_t FirstNormal{ 0 };
+    uint32_t FirstTexCoord{ 0 };
+    uint32_t FirstTriangle{ 0 };
+    // triangle corners of the chunk, by hash partition
+    std::vector<std::vector<uint32_t>> Partitions;
+};
+
+struct ObjAttributes
+{
+    std::vector<float> Positions;
+    std::vector<float> Colors;
+    std::vector<float> Normals;
+    std::vector<float> TexCoords;
+};
+
+static bool IsBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static const char* SkipBlanks(const char* token, const char* end)
+{
+    while (token < end && IsBlank(*token))
+        ++token;
+    return token;
+}
+
+// tinyobjloader's parseReal on a line that isn't null terminated.
+static bool ParseReal(const char*& token, const char* end, float& value)
+{
+    token = SkipBlanks(token, end);
+    const char* tokenEnd = token;
+    while (tokenEnd < end && IsBlank(*tokenEnd) == false)
+        ++tokenEnd;
+
+    double parsed{};
+    const bool found = tinyobj::tryParseDouble(token, tokenEnd, &parsed);
+    if (found)
+        value = (float)parsed;
+    token = tokenEnd;
+    return found;
+}
+
+static float ParseReal(const char*& token, const char* end)
+{
+    float value = 0.f;
+    ParseReal(token, end, value);
+    return value;
+}
+
+// atoi, which parseTriple uses: it doesn't move the token.
+static int ParseInt(const char* token, const char* end)
+{
+    token = SkipBlanks(token, end);
+    bool negative = false;
+    if (token < end && (*token == '+' || *token == '-'))
+        negative = *token++ == '-';
+
+    int value = 0;
+    while (token < end && *token >= '0' && *token <= '9')
+        value = value * 10 + (*token++ - '0');
+    return negative ? -value : value;
+}
+
+static const char* SkipToSeparator(const char* token, const char* end)
+{
+    while (token < end && *token != '/' && IsBlank(*token) == false)
+        ++token;
+    return token;
+}
+
+// tinyobjloader's fixIndex, relative indices are resolved against the chunk.
+static bool FixIndex(ObjChunk& chunk, int index, ObjAttribute attribute, int32_t& result)
+{
+    if (index > 0)
+    {
+        result = index - 1;
+        return true;
+    }
+    if (index == 0)
+    {
+        // not allowed for positions, no attribute for the others
+        result = -1;
+        return attribute != ObjAttribute::Position;
+    }
+
+    size_t count{};
+    switch (attribute)
+    {
+    case ObjAttribute::Position: count = chunk.Positions.size() / 3; break;
+    case ObjAttribute::TexCoord: count = chunk.TexCoords.size() / 2; break;
+    case ObjAttribute::Normal: count = chunk.Normals.size() / 3; break;
+    }
+    result = (int32_t)count + index;
+    chunk.RelativeIndices.push_back({ (uint32_t)chunk.Corners.size(), attribute });
+    return true;
+}
+
+// tinyobjloader's parseTriple: i, i/j, i//k or i/j/k.
+static bool ParseTriple(ObjChunk& chunk, const char*& token, const char* end, ObjCorner& corner)
+{
+    if (FixIndex(chunk, ParseInt(token, end), ObjAttribute::Position, corner.Position) == false)
+        return false;
+    token = SkipToSeparator(token, end);
+    if (token == end || *token != '/')
+        return true;
+    ++token;
+
+    if (token < end && *token == '/')
+    {
+        ++token;
+        if (FixIndex(chunk, ParseInt(token, end), ObjAttribute::Normal, corner.Normal) == false)
+            return false;
+        token = SkipToSeparator(token, end);
+        return true;
+    }
+
+    if (FixIndex(chunk, ParseInt(token, end), ObjAttribute::TexCoord, corner.TexCoord) == false)
+        return false;
+    token = SkipToSeparator(token, end);
+    if (token == end || *token != '/')
+        return true;
+    ++token;
+
+    if (FixIndex(chunk, ParseInt(token, end), ObjAttribute::Normal, corner.Normal) == false)
+        return false;
+    token = SkipToSeparator(token, end);
+    return true;
+}
+
+static void ParseFace(ObjChunk& chunk, const char* token, const char* end)
+{
+    const size_t firstCorner = chunk.Corners.size();
+    const size_t firstRelativeIndex = chunk.RelativeIndices.size();
+
+    token = SkipBlanks(token, end);
+    while (token < end)
+    {
+        ObjCorner corner{};
+        if (ParseTriple(chunk, token, end, corner) == false)
+        {
+            chunk.Unsupported = true;
+            return;
+        }
+        chunk.Corners.push_back(corner);
+        token = SkipBlanks(token, end);
+    }
+
+    const size_t cornerCount = chunk.Corners.size() - firstCorner;
+    if (cornerCount < 3)
+    {
+        // tinyobjloader drops degenerate faces
+        chunk.Corners.resize(firstCorner);
+        chunk.RelativeIndices.resize(firstRelativeIndex);
+        return;
+    }
+    if (cornerCount > 4)
+    {
+        chunk.Unsupported = true;
+        return;
+    }
+    chunk.FaceSizes.push_back((uint8_t)cornerCount);
+    chunk.TriangleCount += (uint32_t)cornerCount - 2;
+}
+
+// token is past the leading blanks, end excludes the line break.
+static void ParseLine(ObjChunk& chunk, const char* token, const char* end)
+{
+    if (end - token < 2)
+        return;
+
+    if (token[0] == 'v' && IsBlank(token[1]))
+    {
+        // tinyobjloader's parseVertexWithColor, the color defaults to white and
+        // a fourth value (w) lands in red
+        token += 2;
+        float x = ParseReal(token, end);
+        float y = ParseReal(token, end);
+        float z = ParseReal(token, end);
+        float r{}, g{}, b{};
+        if (ParseReal(token, end, r) == false)
+            r = g = b = 1.f;
+        else if (ParseReal(token, end, g) == false)
+            g = b = 1.f;
+        else if (ParseReal(token, end, b) == false)
+            r = g = b = 1.f;
+
+        chunk.Positions.insert(chunk.Positions.end(), { x, y, z });
+        chunk.Colors.insert(chunk.Colors.end(), { r, g, b });
+    }
+    else if (end - token >= 3 && token[0] == 'v' && token[1] == 'n' && IsBlank(token[2]))
+    {
+        token += 3;
+        float x = ParseReal(token, end);
+        float y = ParseReal(token, end);
+        float z = ParseReal(token, end);
+        chunk.Normals.insert(chunk.Normals.end(), { x, y, z });
+    }
+    else if (end - token >= 3 && token[0] == 'v' && token[1] == 't' && IsBlank(token[2]))
+    {
+        token += 3;
+        float u = ParseReal(token, end);
+        float v = ParseReal(token, end);
+        chunk.TexCoords.insert(chunk.TexCoords.end(), { u, v });
+    }
+    else if (token[0] == 'f' && IsBlank(token[1]))
+    {
+        ParseFace(chunk, token + 2, end);
+    }
+}
+
+static void ParseChunk(ObjChunk& chunk)
+{
+    const char* line = chunk.Begin;
+    while (line < chunk.End && chunk.Unsupported == false)
+    {
+        // \r\n leaves an empty line behind, which is skipped
+        const char* lineEnd = line;
+        while (lineEnd < chunk.End && *lineEnd != '\n' && *lineEnd != '\r')
+            ++lineEnd;
+
+        const char* token = SkipBlanks(line, lineEnd);
+        if (token < lineEnd && *token != '#')
+            ParseLine(chunk, token, lineEnd);
+        line = lineEnd + 1;
+    }
+}
+
+static Model::Vertex MakeVertex(const ObjAttributes& attributes, const ObjCorner& corner)
+{
+    Model::Vertex vertex{};
+    const size_t position = 3 * (size_t)corner.Position;
+    vertex.Position = { attributes.Positions[position], attributes.Positions[position + 1], attributes.Positions[position + 2] };
+    vertex.Color = { attributes.Colors[position], attributes.Colors[position + 1], attributes.Colors[position + 2] };
+    if (corner.Normal >= 0)
+    {
+        const size_t normal = 3 * (size_t)corner.Normal;
+        vertex.Normal = { attributes.Normals[normal], attributes.Normals[normal + 1], attributes.Normals[normal + 2] };
+    }
+    if (corner.TexCoord >= 0)
+    {
+        const size_t texCoord = 2 * (size_t)corner.TexCoord;
+        vertex.UV = { attributes.TexCoords[texCoord], attributes.TexCoords[texCoord + 1] };
+    }
+    return vertex;
+}
+
+static float SquaredDistance(const ObjAttributes& attributes, int32_t a, int32_t b)
+{
+    const float* pa = &attributes.Positions[3 * (size_t)a];
+    const float* pb = &attributes.Positions[3 * (size_t)b];
+    const float x = pb[0] - pa[0];
+    const float y = pb[1] - pa[1];
+    const float z = pb[2] - pa[2];
+    return x * x + y * y + z * z;
+}
+
+// Offsets the relative indices of the chunk, checks them all and writes its
+// triangles. Quads are split along their shorter diagonal, like tinyobjloader.
+// Faces out of range are skipped the way the tinyobjloader path does: quads
+// with a position out of range as a whole, then the triangles with a corner
+// out of range.
+static void ResolveChunk(ObjChunk& chunk, const ObjAttributes& attributes, ObjCorner* triangles)
+{
+    for (const ObjRelativeIndex& relative : chunk.RelativeIndices)
+    {
+        ObjCorner& corner = chunk.Corners[relative.Corner];
+        switch (relative.Attribute)
+        {
+        case ObjAttribute::Position: corner.Position += (int32_t)chunk.FirstPosition; break;
+        case ObjAttribute::TexCoord: corner.TexCoord += (int32_t)chunk.FirstTexCoord; break;
+        case ObjAttribute::Normal: corner.Normal += (int32_t)chunk.FirstNormal; break;
+        }
+    }
+
+    const int32_t positionCount = (int32_t)(attributes.Positions.size() / 3);
+    const int32_t texCoordCount = (int32_t)(attributes.TexCoords.size() / 2);
+    const int32_t normalCount = (int32_t)(attributes.Normals.size() / 3);
+    // an error for tinyobjloader as well
+    for (const ObjCorner& corner : chunk.Corners)
+    {
+        if (corner.Position < 0 || corner.TexCoord < -1 || corner.Normal < -1)
+        {
+            chunk.InvalidIndex = true;
+            return;
+        }
+    }
+
+    auto isInRange = [&](const ObjCorner& corner)
+    {
+        return corner.Position < positionCount && corner.TexCoord < texCoordCount && corner.Normal < normalCount;
+    };
+    ObjCorner* output = triangles + 3 * (size_t)chunk.FirstTriangle;
+    auto writeTriangle = [&](const ObjCorner* face, std::array<uint32_t, 3> corners)
+    {
+        if (isInRange(face[corners[0]]) && isInRange(face[corners[1]]) && isInRange(face[corners[2]]))
+        {
+            for (uint32_t corner : corners)
+                *output++ = face[corner];
+        }
+        else
+        {
+            ++chunk.SkippedTriangleCount;
+        }
+    };
+
+    const ObjCorner* face = chunk.Corners.data();
+    for (uint8_t faceSize : chunk.FaceSizes)
+    {
+        if (faceSize == 3)
+        {
+            writeTriangle(face, { 0, 1, 2 });
+        }
+        else if (std::any_of(face, face + 4, [&](const ObjCorner& corner) { return corner.Position >= positionCount; }))
+        {
+            chunk.SkippedTriangleCount += 2;
+        }
+        else if (SquaredDistance(attributes, face[0].Position, face[2].Position)
+            < SquaredDistance(attributes, face[1].Position, face[3].Position))
+        {
+            writeTriangle(face, { 0, 1, 2 });
+            writeTriangle(face, { 0, 2, 3 });
+        }
+        else
+        {
+            writeTriangle(face, { 0, 1, 3 });
+            writeTriangle(face, { 1, 2, 3 });
+        }
+        face += faceSize;
+    }
+    chunk.TriangleCount -= chunk.SkippedTriangleCount;
+}
+
+// Welding partition of a vertex hash. The welders take their home slot from
+// the low bits of the hash and their tag from the high half, so the partition
+// comes from a remix of the whole hash: taking it from the low bits would leave
+// only 1 / partitionCount of every welder's slots as home slots.
+static uint32_t GetWeldPartition(uint64_t hash, uint32_t partitionCount)
+{
+    const uint64_t remixed = hash * 0x9E3779B97F4A7C15ull;
+    return (uint32_t)(((remixed >> 32) * partitionCount) >> 32);
+}
+
+// Returns false when the file has to go through tinyobjloader instead.
+static bool LoadObjParallel(const std::string& filePath, JobSystem& jobSystem, Model::Builder& builder, Model::ObjLoadStats& stats)
+{
+    VKBG_PROFILE_FUNCTION();
+
+    MappedFile file{};
+    if (file.Open(filePath) == false)
+        return false;
+
+    const char* data = reinterpret_cast<const char*>(file.GetData());
+    const size_t size = file.GetSize();
+    const uint32_t threadCount = jobSystem.GetThreadCount();
+    const size_t chunkCount = std::clamp<size_t>(size / MinObjChunkSize, 1, threadCount * ObjChunksPerThread);
+
+    // every chunk but the first starts right after a line break
+    std::vector<ObjChunk> chunks(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        const char* begin = i == 0 ? data : chunks[i - 1].End;
+        const char* end = data + size * (i + 1) / chunkCount;
+        end = std::max(end, begin);
+        while (end > data && end < data + size && end[-1] != '\n')
+            ++end;
+        chunks[i].Begin = begin;
+        chunks[i].End = end;
+    }
+
+    {
+        VKBG_PROFILE_SCOPE("ParseChunks");
+        jobSystem.ParallelFor((uint32_t)chunkCount, 1, [&](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; ++i)
+                ParseChunk(chunks[i]);
+        });
+    }
+
+    ObjAttributes attributes{};
+    size_t positionCount = 0;
+    size_t normalCount = 0;
+    size_t texCoordCount = 0;
+    size_t triangleCount = 0;
+    for (ObjChunk& chunk : chunks)
+    {
+        if (chunk.Unsupported)
+            return false;
+        chunk.FirstPosition = (uint32_t)positionCount;
+        chunk.FirstNormal = (uint32_t)normalCount;
+        chunk.FirstTexCoord = (uint32_t)texCoordCount;
+        chunk.FirstTriangle = (uint32_t)triangleCount;
+        positionCount += chunk.Positions.size() / 3;
+        normalCount += chunk.Normals.size() / 3;
+        texCoordCount += chunk.TexCoords.size() / 2;
+        triangleCount += chunk.TriangleCount;
+    }
+    if (3 * triangleCount > UINT32_MAX)
+        return false;
+
+    attributes.Positions.resize(3 * positionCount);
+    attributes.Colors.resize(3 * positionCount);
+    attributes.Normals.resize(3 * normalCount);
+    attributes.TexCoords.resize(2 * texCoordCount);
+    uint32_t cornerCount = (uint32_t)(3 * triangleCount);
+    std::vector<ObjCorner> triangles(cornerCount);
+
+    {
+        VKBG_PROFILE_SCOPE("MergeChunks");
+        jobSystem.ParallelFor((uint32_t)chunkCount, 1, [&](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; ++i)
+            {
+                const ObjChunk& chunk = chunks[i];
+                std::copy(chunk.Positions.begin(), chunk.Positions.end(), attributes.Positions.begin() + 3 * (size_t)chunk.FirstPosition);
+                std::copy(chunk.Colors.begin(), chunk.Colors.end(), attributes.Colors.begin() + 3 * (size_t)chunk.FirstPosition);
+                std::copy(chunk.Normals.begin(), chunk.Normals.end(), attributes.Normals.begin() + 3 * (size_t)chunk.FirstNormal);
+                std::copy(chunk.TexCoords.begin(), chunk.TexCoords.end(), attributes.TexCoords.begin() + 2 * (size_t)chunk.FirstTexCoord);
+            }
+        });
+        // needs all the positions for the quads
+        jobSystem.ParallelFor((uint32_t)chunkCount, 1, [&](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; ++i)
+                ResolveChunk(chunks[i], attributes, triangles.data());
+        });
+    }
+    // the skipped triangles leave a gap at the end of their chunk's range
+    uint32_t resolvedTriangleCount = 0;
+    uint32_t skippedTriangleCount = 0;
+    for (ObjChunk& chunk : chunks)
+    {
+        if (chunk.InvalidIndex)
+            throw std::runtime_error("Relative face index out of range in " + filePath);
+        if (chunk.FirstTriangle != resolvedTriangleCount)
+        {
+            const auto first = triangles.begin() + 3 * (size_t)chunk.FirstTriangle;
+            std::copy(first, first + 3 * (size_t)chunk.TriangleCount, triangles.begin() + 3 * (size_t)resolvedTriangleCount);
+        }
+        chunk.FirstTriangle = resolvedTriangleCount;
+        resolvedTriangleCount += chunk.TriangleCount;
+        skippedTriangleCount += chunk.SkippedTriangleCount;
+    }
+    cornerCount = 3 * resolvedTriangleCount;
+    triangles.resize(cornerCount);
+    if (skippedTriangleCount > 0)
+        LOG("Skipped " << skippedTriangleCount << " triangles with indices out of range in " << filePath << '\n');
+
+    // Welding: corner c is given the first corner equal to it, found by one
+    // job per hash partition going through its corners in file order.
+    const uint32_t partitionCount = threadCount;
+    std::vector<uint64_t> hashes(cornerCount);
+    std::vector<uint32_t> firstCorners(cornerCount);
+    std::atomic<uint64_t> weldProbeCount{ 0 };
+    {
+        VKBG_PROFILE_SCOPE("WeldVertices");
+        jobSystem.ParallelFor((uint32_t)chunkCount, 1, [&](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; ++i)
+            {
+                ObjChunk& chunk = chunks[i];
+                chunk.Partitions.assign(partitionCount, {});
+                const uint32_t firstCorner = 3 * chunk.FirstTriangle;
+                for (uint32_t corner = firstCorner; corner < firstCorner + 3 * chunk.TriangleCount; ++corner)
+                {
+                    const Model::Vertex vertex = MakeVertex(attributes, triangles[corner]);
+                    hashes[corner] = HashBytes(&vertex, sizeof(Model::Vertex));
+                    chunk.Partitions[GetWeldPartition(hashes[corner], partitionCount)].push_back(corner);
+                }
+            }
+        });
+        jobSystem.ParallelFor(partitionCount, 1, [&](uint32_t first, uint32_t last)
+        {
+            for (uint32_t partition = first; partition < last; ++partition)
+            {
+                size_t partitionSize = 0;
+                for (const ObjChunk& chunk : chunks)
+                    partitionSize += chunk.Partitions[partition].size();
+
+                // the welder's vertex indices are local to the partition
+                VertexWelder welder{ sizeof(Model::Vertex), partitionSize };
+                std::vector<uint32_t> welderFirstCorners;
+                for (const ObjChunk& chunk : chunks)
+                {
+                    for (uint32_t corner : chunk.Partitions[partition])
+                    {
+                        const Model::Vertex vertex = MakeVertex(attributes, triangles[corner]);
+                        const uint32_t index = welder.Weld(&vertex, hashes[corner]);
+                        if (index == welderFirstCorners.size())
+                            welderFirstCorners.push_back(corner);
+                        firstCorners[corner] = welderFirstCorners[index];
+                    }
+                }
+                weldProbeCount.fetch_add(welder.GetProbeCount(), std::memory_order_relaxed);
+            }
+        });
+    }
+    stats = {
+        .Parallel = true,
+        .CornerCount = cornerCount,
+        .SkippedTriangleCount = skippedTriangleCount,
+        .WeldProbeCount = weldProbeCount.load()
+    };
+
+    // a first corner comes before the corners equal to it, its index is known by then
+    builder.Vertices.clear();
+    builder.Indices = std::move(firstCorners);
+    for (uint32_t corner = 0; corner < cornerCount; ++corner)
+    {
+        if (builder.Indices[corner] == corner)
+        {
+            builder.Indices[corner] = (uint32_t)builder.Vertices.size();
+            builder.Vertices.push_back(MakeVertex(attributes, triangles[corner]));
+        }
+        else
+        {
+            builder.Indices[corner] = builder.Indices[builder.Indices[corner]];
+        }
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////
+// Builder /////////////////////////////////////////////
+////////////////////////////////////////////////////////
+Model::ObjLoadStats Model::Builder::LoadFromObj(const std::string& filePath, JobSystem* jobSystem)
+{
+    VKBG_PROFILE_FUNCTION();
+
+    ObjLoadStats stats{};
+    if (jobSystem && LoadObjParallel(filePath, *jobSystem, *this, stats))
+        return stats;
+
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filePath.data()) == false)
+        throw std::runtime_error(warn + err);
+
+    size_t indexCount = 0;
+    for (const auto& shape : shapes)
+        indexCount += shape.mesh.indices.size();
+
+    Indices.clear();
+    Indices.reserve(indexCount);
+    VertexWelder welder{ sizeof(Vertex), indexCount };
+
+    // tinyobjloader only warns about the indices out of range, the triangles
+    // using them are skipped like the parallel path does
+    auto isInRange = [&](const tinyobj::index_t& index)
+    {
+        return index.vertex_index >= 0 && 3 * (size_t)index.vertex_index < attrib.vertices.size()
+            && 3 * (int64_t)index.normal_index < (int64_t)attrib.normals.size()
+            && 2 * (int64_t)index.texcoord_index < (int64_t)attrib.texcoords.size();
+    };
+    uint32_t skippedTriangleCount = 0;
+
+    for (const auto& shape : shapes)
+    {
+        const auto& indices = shape.mesh.indices;
+        for (size_t triangle = 0; triangle + 2 < indices.size(); triangle += 3)
+        {
+            if (isInRange(indices[triangle]) == false || isInRange(indices[triangle + 1]) == false
+                || isInRange(indices[triangle + 2]) == false)
+            {
+                ++skippedTriangleCount;
+                continue;
+            }
+
+            for (size_t corner = triangle; corner < triangle + 3; ++corner)
+            {
+                const tinyobj::index_t& index = indices[corner];
+                Vertex vert{};
+                int32_t i = index.vertex_index;
+                vert.Position = {
+                    attrib.vertices[3 * i + 0],
+                    attrib.vertices[3 * i + 1],
+                    attrib.vertices[3 * i + 2]
+                };
+
+                vert.Color = {
+                    attrib.colors[3 * i + 0],
+                    attrib.colors[3 * i + 1],
+                    attrib.colors[3 * i + 2]
+                };
+
+                if (index.normal_index >= 0)
+                {
+                    i = index.normal_index;
+                    vert.Normal = {
+                        attrib.normals[3 * i + 0],
+                        attrib.normals[3 * i + 1],
+                        attrib.normals[3 * i + 2],
+                    };
+                }
+
+                if (index.texcoord_index >= 0)
+                {
+                    i = index.texcoord_index;
+                    vert.UV = {
+                        attrib.texcoords[2 * i + 0],
+                        attrib.texcoords[2 * i + 1],
+                    };
+                }
+
+                Indices.push_back(welder.Weld(&vert));
+            }
+        }
+    }
+    if (skippedTriangleCount > 0)
+        LOG("Skipped " << skippedTriangleCount << " triangles with indices out of range in " << filePath << '\n');
+
+    const Vertex* vertices = reinterpret_cast<const Vertex*>(welder.GetVertices());
+    Vertices.assign(vertices, vertices + welder.GetVertexCount());
+    return {
+        .Parallel = false,
+        .CornerCount = Indices.size(),
+        .SkippedTriangleCount = skippedTriangleCount,
+        .WeldProbeCount = welder.GetProbeCount()
+    };
+}
+}
@@ -1,6 +1,7 @@
 #include "Pipeline.h"
 #include "RenderContext.h"
-#include "Model.h"
+#include "VertexLayout.h"
+#include "Profiling/Profiler.h"
 
 namespace vkbg
 {
@@ -27,8 +28,11 @@ void Pipeline::BindToCommandBuffer(VkCommandBuffer commandBuffer)
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
 }
 
-void Pipeline::GetDefaultPipelineProps(PipelineProps& properties)
+void Pipeline::GetDefaultPipelineProps(PipelineProps& properties, VertexLayout layout)
 {
+    properties.BindingDescriptions = GetBindingDescriptions(layout);
+    properties.AttributeDescriptions = GetAttributeDescriptions(layout);
+
     properties.InputAssemblyInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
         .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
@@ -96,13 +100,15 @@ void Pipeline::CreateGraphicsPipeline(
     const std::string & fragShaderPath,
     const PipelineProps& properties)
 {
+    VKBG_PROFILE_FUNCTION();
+
     auto vertShaderCode = ReadFile(vertShaderPath);
     LOG("vertShaderCode size: " << vertShaderCode.size() << std::endl);
     auto fragShaderCode = ReadFile(fragShaderPath);
     LOG("fragShaderCode size: " << fragShaderCode.size() << std::endl);
 
-    CreateShaderModule(vertShaderCode, &m_VertexShaderModule);
-    CreateShaderModule(fragShaderCode, &m_FragmentShaderModule);
+    m_VertexShaderModule = CreateShaderModule(m_Context, vertShaderCode);
+    m_FragmentShaderModule = CreateShaderModule(m_Context, fragShaderCode);
 
     VkPipelineShaderStageCreateInfo shaderStages[2]{
         {
@@ -121,8 +127,8 @@ void Pipeline::CreateGraphicsPipeline(
         }
     };
 
-    auto bindingDescriptions = Model::Vertex::GetBindingDescriptions();
-    auto attributeDescriptions = Model::Vertex::GetAttributeDescriptions();
+    const auto& bindingDescriptions = properties.BindingDescriptions;
+    const auto& attributeDescriptions = properties.AttributeDescriptions;
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
@@ -166,13 +172,18 @@ void Pipeline::CreateGraphicsPipeline(
         .basePipelineIndex = -1
     };
     
+    auto start = std::chrono::high_resolution_clock::now();
     if (vkCreateGraphicsPipelines(
-        m_Context->GetLogicalDevice(), VK_NULL_HANDLE
+        m_Context->GetLogicalDevice(), m_Context->GetPipelineCache()
         , 1, &pipelineInfo
         , nullptr, &m_Pipeline) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create the graphics pipeline");
     }
+    auto end = std::chrono::high_resolution_clock::now();
+    [[maybe_unused]] float creationTime = std::chrono::duration<float, std::milli>(end - start).count();
+    LOG("Graphics pipeline (" << vertShaderPath << ", " << fragShaderPath << ") created in "
+        << creationTime << " ms\n");
 }
 
 std::vector<uint8_t> Pipeline::ReadFile(const std::string & filePath)
@@ -195,7 +206,7 @@ std::vector<uint8_t> Pipeline::ReadFile(const std::string & filePath)
     return buffer;
 }
 
-void Pipeline::CreateShaderModule(const std::vector<uint8_t>& code, VkShaderModule* shaderModule)
+VkShaderModule Pipeline::CreateShaderModule(RenderContext* context, const std::vector<uint8_t>& code)
 {
     VkShaderModuleCreateInfo createInfo{
         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
@@ -203,8 +214,54 @@ void Pipeline::CreateShaderModule(const std::vector<uint8_t>& code, VkShaderModu
         .pCode = reinterpret_cast<const uint32_t*>(code.data())
     };
 
-    if (vkCreateShaderModule(m_Context->GetLogicalDevice(), &createInfo, nullptr, shaderModule) != VK_SUCCESS)
+    VkShaderModule shaderModule{};
+    if (vkCreateShaderModule(context->GetLogicalDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
         throw std::runtime_error("Failed to create shader module");
+    return shaderModule;
+}
+
+ComputePipeline::ComputePipeline(
+    RenderContext* context,
+    const std::string& compShaderPath,
+    VkPipelineLayout pipelineLayout)
+    : m_Context{ context }
+{
+    VKBG_PROFILE_FUNCTION();
+
+    m_ShaderModule = Pipeline::CreateShaderModule(m_Context, Pipeline::ReadFile(compShaderPath));
+
+    VkComputePipelineCreateInfo pipelineInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = m_ShaderModule,
+            .pName = "main",
+            .pSpecializationInfo = nullptr
+        },
+        .layout = pipelineLayout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1
+    };
+
+    if (vkCreateComputePipelines(
+        m_Context->GetLogicalDevice(), m_Context->GetPipelineCache()
+        , 1, &pipelineInfo
+        , nullptr, &m_Pipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create the compute pipeline " + compShaderPath);
+    }
+}
+
+ComputePipeline::~ComputePipeline()
+{
+    vkDestroyPipeline(m_Context->GetLogicalDevice(), m_Pipeline, nullptr);
+    vkDestroyShaderModule(m_Context->GetLogicalDevice(), m_ShaderModule, nullptr);
+}
+
+void ComputePipeline::BindToCommandBuffer(VkCommandBuffer commandBuffer)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
 }
 
 }
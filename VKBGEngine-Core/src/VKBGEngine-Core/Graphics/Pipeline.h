@@ -1,4 +1,5 @@
 #pragma once
+#include "VertexLayout.h"
 
 namespace vkbg
 {
@@ -9,6 +10,8 @@ struct PipelineProps
     PipelineProps(const PipelineProps&) = delete;
     PipelineProps& operator=(const PipelineProps&) = delete;
 
+    std::vector<VkVertexInputBindingDescription> BindingDescriptions;
+    std::vector<VkVertexInputAttributeDescription> AttributeDescriptions;
     VkPipelineInputAssemblyStateCreateInfo InputAssemblyInfo;
     VkPipelineRasterizationStateCreateInfo RasterizationInfo;
     VkPipelineMultisampleStateCreateInfo MultisampleInfo;
@@ -37,7 +40,13 @@ public:
     void BindToCommandBuffer(VkCommandBuffer commandBuffer);
 
 public:
-    static void GetDefaultPipelineProps(PipelineProps& properties);
+    // Vertex input of the layout, the vertex shader has to be its variant.
+    static void GetDefaultPipelineProps(PipelineProps& properties, VertexLayout layout = VertexLayout::Float);
+    /// <summary>
+    /// Read a binary files and return a vector of bytes
+    /// </summary>
+    static std::vector<uint8_t> ReadFile(const std::string& filePath);
+    static VkShaderModule CreateShaderModule(class RenderContext* context, const std::vector<uint8_t>& code);
 
 private:
     void CreateGraphicsPipeline(
@@ -45,13 +54,6 @@ private:
         const std::string& fragShaderPath,
         const PipelineProps& properties);
 
-private:
-    /// <summary>
-    /// Read a binary files and return a vector of bytes
-    /// </summary>
-    static std::vector<uint8_t> ReadFile(const std::string& filePath);
-    void CreateShaderModule(const std::vector<uint8_t>& code, VkShaderModule* shaderModule);
-
 private:
     class RenderContext* m_Context;
     VkPipeline m_Pipeline;
@@ -59,5 +61,25 @@ private:
     VkShaderModule m_FragmentShaderModule;
 };
 
+class ComputePipeline
+{
+public:
+    ComputePipeline(
+        class RenderContext* context,
+        const std::string& compShaderPath,
+        VkPipelineLayout pipelineLayout);
+    ~ComputePipeline();
+
+    ComputePipeline(const ComputePipeline&) = delete;
+    ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+    void BindToCommandBuffer(VkCommandBuffer commandBuffer);
+
+private:
+    class RenderContext* m_Context;
+    VkPipeline m_Pipeline;
+    VkShaderModule m_ShaderModule;
+};
+
 }
 
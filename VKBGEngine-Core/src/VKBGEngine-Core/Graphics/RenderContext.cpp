@@ -1,7 +1,10 @@
 #include "Buffer.h"
 #include "RenderContext.h"
+#include "MemoryAllocator.h"
+#include "GeometryPool.h"
 #include "Window.h"
 #include "VulkanExtensionHelper.h"
+#include "Helper.h"
 
 namespace vkbg
 {
@@ -19,19 +22,33 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
 RenderContext::RenderContext(Window* window)
     : m_pWindow{window}
 {
+    if (IsHeadless())
+        m_DeviceExtensions.clear();
+
     CreateInstance();
     SetupDebugMessage();
     CreateSurface();
     PickPhysicalDevice();
     CreateLogicalDevice();
     CreateCommandPool();
+    CreatePipelineCache();
+
+    m_Allocator = new MemoryAllocator(this);
+    m_UploadManager = new UploadManager(this);
+    m_GeometryPool = new GeometryPool(this);
 }
 
 RenderContext::~RenderContext()
 {
+    delete m_GeometryPool;
+    delete m_UploadManager;
+    delete m_Allocator;
+    SavePipelineCache();
+    vkDestroyPipelineCache(m_Device, m_PipelineCache, nullptr);
     vkDestroyCommandPool(m_Device, m_GraphicsCommandPool, nullptr);
     vkDestroyDevice(m_Device, nullptr);
-    vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+    if (m_Surface != VK_NULL_HANDLE)
+        vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
     if constexpr (EnableValidationLayers)
     {
         DestroyDebugUtilsMessengerEXT(m_Instance, m_DebugMessenger, nullptr);
@@ -71,7 +88,7 @@ uint32_t RenderContext::FindMemoryType(uint32_t memoryTypeFilter, VkMemoryProper
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
-void RenderContext::CreateImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags memoryProperties, VkImage& image, VkDeviceMemory& imageMemory)
+void RenderContext::CreateImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags memoryProperties, VkImage& image, Allocation& imageMemory)
 {
     if (vkCreateImage(m_Device, &imageInfo, nullptr, &image) != VK_SUCCESS)
         throw std::runtime_error("Failed to create image");
@@ -79,22 +96,16 @@ void RenderContext::CreateImageWithInfo(const VkImageCreateInfo& imageInfo, VkMe
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(m_Device, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memRequirements.size,
-        .memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, memoryProperties)
-    };
+    imageMemory = m_Allocator->Allocate(
+        memRequirements, memoryProperties, imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
 
-    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate image memory");
-
-    if (vkBindImageMemory(m_Device, image, imageMemory, 0) != VK_SUCCESS)
+    if (vkBindImageMemory(m_Device, image, imageMemory.Memory, imageMemory.Offset) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to bind image memory!");
     }
 }
 
-void RenderContext::CreateBuffer(VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+void RenderContext::CreateBuffer(VkDeviceSize bufferSize, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, Allocation& bufferMemory)
 {
     VkBufferCreateInfo bufferInfo{
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
@@ -109,31 +120,13 @@ void RenderContext::CreateBuffer(VkDeviceSize bufferSize, VkBufferUsageFlags usa
     VkMemoryRequirements memRequirements{};
     vkGetBufferMemoryRequirements(m_Device, buffer, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .allocationSize = memRequirements.size,
-        .memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, properties)
-    };
-
-    if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-        throw std::runtime_error("Failed to allocate buffer memory");
+    bufferMemory = m_Allocator->Allocate(memRequirements, properties, true);
 
-    vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
+    vkBindBufferMemory(m_Device, buffer, bufferMemory.Memory, bufferMemory.Offset);
 }
 
-void RenderContext::CreateDeviceLocalBuffer(VkDeviceSize elementSize, uint32_t elementCount, VkBufferUsageFlags usage, std::unique_ptr<Buffer>& buffer, void* data)
+UploadTicket RenderContext::CreateDeviceLocalBuffer(VkDeviceSize elementSize, uint32_t elementCount, VkBufferUsageFlags usage, std::unique_ptr<Buffer>& buffer, const void* data)
 {
-    Buffer stagingBuffer{
-        this,
-        elementSize,
-        elementCount,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    };
-
-    stagingBuffer.Map();
-    stagingBuffer.WriteToBuffer(data);
-
     buffer.reset(new Buffer(
         this,
         elementSize,
@@ -142,7 +135,7 @@ void RenderContext::CreateDeviceLocalBuffer(VkDeviceSize elementSize, uint32_t e
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT // host = CPU, Device = GPU
     ));
 
-    CopyBuffer(stagingBuffer.GetBuffer(), buffer->GetBuffer(), elementSize * elementCount);
+    return m_UploadManager->Upload(data, elementSize * elementCount, buffer->GetBuffer());
 }
 
 void RenderContext::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize)
@@ -240,10 +233,13 @@ bool RenderContext::CheckValidationLayerSupport()
 
 std::vector<const char*> RenderContext::GetRequiredExtensions()
 {
-    uint32_t glfwExtensionCount{ 0 };
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char*> extensions;
+    if (IsHeadless() == false)
+    {
+        uint32_t glfwExtensionCount{ 0 };
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if constexpr (EnableValidationLayers)
     {
@@ -307,6 +303,8 @@ void RenderContext::SetupDebugMessage()
 
 void RenderContext::CreateSurface()
 {
+    if (IsHeadless())
+        return;
     m_pWindow->CreateSurface(m_Instance, &m_Surface);
 }
 
@@ -348,10 +346,12 @@ bool RenderContext::IsDeviceSuitable(VkPhysicalDevice device, uint32_t& score)
     if (!CheckDeviceExtensionSupport(device))
         return false;
 
-    bool swapChainAdequate = false;
-    SwapChainSupportDetails swapChainDetails = QuerySwapChainSupport(device);
-    if (swapChainDetails.Formats.empty() || swapChainDetails.PresentModes.empty())
-        return false;
+    if (IsHeadless() == false)
+    {
+        SwapChainSupportDetails swapChainDetails = QuerySwapChainSupport(device);
+        if (swapChainDetails.Formats.empty() || swapChainDetails.PresentModes.empty())
+            return false;
+    }
 
     VkPhysicalDeviceProperties deviceProperties{};
     vkGetPhysicalDeviceProperties(device, &deviceProperties);
@@ -412,10 +412,16 @@ QueueFamilyIndices RenderContext::FindQueueFamilies(VkPhysicalDevice device)
             continue;
 
         if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+        {
             indices.GraphicsFamily = i;
+            // nothing is presented, the "present" queue is the graphics one
+            if (IsHeadless())
+                indices.PresentFamily = i;
+        }
 
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
+        if (IsHeadless() == false)
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_Surface, &presentSupport);
         if (presentSupport)
             indices.PresentFamily = i;
 
@@ -450,6 +456,22 @@ bool RenderContext::CheckDeviceExtensionSupport(VkPhysicalDevice device)
     return requiredExtensions.empty();
 }
 
+bool RenderContext::IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName)
+{
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto& extension : availableExtensions)
+    {
+        if (std::strcmp(extension.extensionName, extensionName) == 0)
+            return true;
+    }
+    return false;
+}
+
 SwapChainSupportDetails RenderContext::QuerySwapChainSupport(VkPhysicalDevice device)
 {
     SwapChainSupportDetails details{};
@@ -502,8 +524,21 @@ void RenderContext::CreateLogicalDevice()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    // software implementations (lavapipe...) don't necessarily have it
+    VkPhysicalDeviceFeatures supportedFeatures{};
+    vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+
+    // optional, the GPU driven path needs all three
+    const bool drawIndirectCount = supportedFeatures.multiDrawIndirect
+        && supportedFeatures.drawIndirectFirstInstance
+        && IsDeviceExtensionAvailable(m_PhysicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    if (drawIndirectCount)
+        m_DeviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
     VkPhysicalDeviceFeatures deviceFeatures{
-        .samplerAnisotropy = VK_TRUE
+        .multiDrawIndirect = drawIndirectCount,
+        .drawIndirectFirstInstance = drawIndirectCount,
+        .samplerAnisotropy = supportedFeatures.samplerAnisotropy
     };
 
     VkDeviceCreateInfo createInfo{
@@ -530,6 +565,12 @@ void RenderContext::CreateLogicalDevice()
 
     vkGetDeviceQueue(m_Device, indices.GraphicsFamily.value(), 0, &m_GraphicsQueue);
     vkGetDeviceQueue(m_Device, indices.PresentFamily.value(), 0, &m_PresentQueue);
+
+    if (drawIndirectCount)
+    {
+        m_CmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(m_Device, "vkCmdDrawIndexedIndirectCountKHR"));
+    }
 }
 
 void RenderContext::CreateCommandPool()
@@ -549,6 +590,118 @@ void RenderContext::CreateCommandPool()
 }
 #pragma endregion
 
+#pragma region Pipeline Cache
+// The driver blob is wrapped in a small header of our own so that a truncated
+// or corrupted file is rejected before it reaches the driver.
+struct PipelineCacheFileHeader
+{
+    uint32_t Magic;
+    uint32_t Reserved;
+    uint64_t DataSize;
+    uint64_t DataHash;
+};
+static constexpr uint32_t PipelineCacheFileMagic = 0x43504256; // "VBPC"
+
+void RenderContext::CreatePipelineCache()
+{
+    std::vector<uint8_t> cacheData;
+
+    std::ifstream file(PipelineCachePath, std::ios::ate | std::ios::binary);
+    if (file.is_open())
+    {
+        size_t fileSize = (size_t)file.tellg();
+        PipelineCacheFileHeader header{};
+        if (fileSize >= sizeof(header))
+        {
+            file.seekg(0);
+            file.read((char*)&header, sizeof(header));
+            if (header.Magic == PipelineCacheFileMagic && header.DataSize == fileSize - sizeof(header))
+            {
+                cacheData.resize(header.DataSize);
+                file.read((char*)cacheData.data(), cacheData.size());
+                if (!file.good() || HashBytes(cacheData.data(), cacheData.size()) != header.DataHash)
+                    cacheData.clear();
+            }
+        }
+    }
+
+    if (cacheData.empty() == false && IsPipelineCacheCompatible(cacheData) == false)
+    {
+        LOG("Pipeline cache was created by another device or driver, ignoring it\n");
+        cacheData.clear();
+    }
+    LOG("Pipeline cache: " << (cacheData.empty() ? "cold" : "warm, " + std::to_string(cacheData.size()) + " bytes") << '\n');
+
+    VkPipelineCacheCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = cacheData.size(),
+        .pInitialData = cacheData.empty() ? nullptr : cacheData.data()
+    };
+
+    if (vkCreatePipelineCache(m_Device, &createInfo, nullptr, &m_PipelineCache) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create pipeline cache");
+}
+
+void RenderContext::SavePipelineCache()
+{
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_Device, m_PipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+        return;
+
+    std::vector<uint8_t> cacheData(dataSize);
+    if (vkGetPipelineCacheData(m_Device, m_PipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS)
+        return;
+
+    PipelineCacheFileHeader header{
+        .Magic = PipelineCacheFileMagic,
+        .Reserved = 0,
+        .DataSize = dataSize,
+        .DataHash = HashBytes(cacheData.data(), dataSize)
+    };
+
+    std::error_code error;
+    std::filesystem::path cachePath = PipelineCachePath;
+    std::filesystem::create_directories(cachePath.parent_path(), error);
+
+    // same as the mesh cache: write aside and swap in, never leave a half written file
+    std::filesystem::path tempPath = cachePath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return;
+        file.write((const char*)&header, sizeof(header));
+        file.write((const char*)cacheData.data(), dataSize);
+        if (!file.good())
+            return;
+    }
+
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+        std::filesystem::remove(tempPath, error);
+}
+
+bool RenderContext::IsPipelineCacheCompatible(const std::vector<uint8_t>& cacheData)
+{
+    // VkPipelineCacheHeaderVersionOne, read field by field since the blob has no alignment guarantee
+    constexpr size_t headerSize = 16 + VK_UUID_SIZE;
+    if (cacheData.size() < headerSize)
+        return false;
+
+    uint32_t length{}, version{}, vendorID{}, deviceID{};
+    memcpy(&length, cacheData.data() + 0, sizeof(uint32_t));
+    memcpy(&version, cacheData.data() + 4, sizeof(uint32_t));
+    memcpy(&vendorID, cacheData.data() + 8, sizeof(uint32_t));
+    memcpy(&deviceID, cacheData.data() + 12, sizeof(uint32_t));
+
+    return length >= headerSize
+        && version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && vendorID == m_PhysicalDeviceProperties.vendorID
+        && deviceID == m_PhysicalDeviceProperties.deviceID
+        && memcmp(cacheData.data() + 16, m_PhysicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+#pragma endregion
+
 VkCommandBuffer RenderContext::BeginSingleTimeCommands()
 {
     VkCommandBufferAllocateInfo allocInfo{};
@@ -1,4 +1,5 @@
 #pragma once
+#include "UploadManager.h"
 
 namespace vkbg
 {
@@ -25,11 +26,15 @@ public:
 #else
     constexpr static bool EnableValidationLayers = true;
 #endif // NDEBUG
+    // Without a window (nullptr) the context is headless: no surface, no
+    // swap chain extension, and presentation goes to the graphics queue.
     RenderContext(class Window* window);
     ~RenderContext();
 
     // Getters
+    bool IsHeadless() const { return m_pWindow == nullptr; }
     VkDevice GetLogicalDevice() const { return m_Device; }
+    VkPhysicalDevice GetPhysicalDevice() const { return m_PhysicalDevice; }
     SwapChainSupportDetails GetSwapChainSupport() { return QuerySwapChainSupport(m_PhysicalDevice); }
     VkSurfaceKHR GetSurface() { return m_Surface; }
     QueueFamilyIndices GetQueueFamilies() { return FindQueueFamilies(m_PhysicalDevice); }
@@ -37,6 +42,10 @@ public:
     VkQueue GetPresentQueue() const { return m_PresentQueue; }
     VkCommandPool GetGraphicsCommandPool() const { return m_GraphicsCommandPool; }
     VkPhysicalDeviceProperties GetPhysicalDeviceProperties() { return m_PhysicalDeviceProperties; }
+    class MemoryAllocator* GetAllocator() const { return m_Allocator; }
+    UploadManager* GetUploadManager() const { return m_UploadManager; }
+    class GeometryPool* GetGeometryPool() const { return m_GeometryPool; }
+    VkPipelineCache GetPipelineCache() const { return m_PipelineCache; }
 
     VkFormat FindSupportedFormat(
         const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
@@ -46,24 +55,38 @@ public:
         const VkImageCreateInfo& imageInfo,
         VkMemoryPropertyFlags memoryProperties,
         VkImage& image,
-        VkDeviceMemory& imageMemory
+        struct Allocation& imageMemory
     );
     void CreateBuffer(
         VkDeviceSize bufferSize,
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory
+        struct Allocation& bufferMemory
     );
-    void CreateDeviceLocalBuffer(
+    // Creates the buffer right away, its content is uploaded asynchronously
+    // through the UploadManager. The returned ticket tells when it has landed.
+    UploadTicket CreateDeviceLocalBuffer(
         VkDeviceSize elementSize,
         uint32_t elementCount,
         VkBufferUsageFlags usage,
         std::unique_ptr<class Buffer>& buffer,
-        void* data
+        const void* data
     );
     void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize bufferSize);
 
+    // GPU driven drawing: VK_KHR_draw_indirect_count along with the multiDrawIndirect
+    // and drawIndirectFirstInstance features, enabled when the device has them.
+    bool SupportsDrawIndirectCount() const { return m_CmdDrawIndexedIndirectCount != nullptr; }
+    void CmdDrawIndexedIndirectCount(
+        VkCommandBuffer commandBuffer,
+        VkBuffer buffer, VkDeviceSize offset,
+        VkBuffer countBuffer, VkDeviceSize countOffset,
+        uint32_t maxDrawCount, uint32_t stride) const
+    {
+        m_CmdDrawIndexedIndirectCount(commandBuffer, buffer, offset, countBuffer, countOffset, maxDrawCount, stride);
+    }
+
 private:
 
 #pragma region Initialization Code
@@ -81,6 +104,7 @@ private:
     bool IsDeviceSuitable(VkPhysicalDevice device, uint32_t& score);
     QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device);
     bool CheckDeviceExtensionSupport(VkPhysicalDevice device);
+    static bool IsDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName);
     SwapChainSupportDetails QuerySwapChainSupport(VkPhysicalDevice device);
 
     void CreateLogicalDevice();
@@ -88,6 +112,12 @@ private:
     void CreateCommandPool();
 #pragma endregion
 
+#pragma region Pipeline Cache
+    void CreatePipelineCache();
+    void SavePipelineCache();
+    bool IsPipelineCacheCompatible(const std::vector<uint8_t>& cacheData);
+#pragma endregion
+
     VkCommandBuffer BeginSingleTimeCommands();
     void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
 
@@ -99,12 +129,20 @@ private:
     VkDebugUtilsMessengerEXT m_DebugMessenger;
     class Window* m_pWindow;
     
-    VkSurfaceKHR m_Surface;
+    VkSurfaceKHR m_Surface{ VK_NULL_HANDLE };
     VkDevice m_Device;
     VkQueue m_GraphicsQueue;
     VkCommandPool m_GraphicsCommandPool;
     VkQueue m_PresentQueue;
 
+    class MemoryAllocator* m_Allocator{ nullptr };
+    UploadManager* m_UploadManager{ nullptr };
+    class GeometryPool* m_GeometryPool{ nullptr };
+    PFN_vkCmdDrawIndexedIndirectCountKHR m_CmdDrawIndexedIndirectCount{ nullptr };
+
+    static constexpr const char* PipelineCachePath = "res/Cache/pipeline.cache";
+    VkPipelineCache m_PipelineCache{ VK_NULL_HANDLE };
+
     std::vector<const char*> m_ValidationLayers{
         "VK_LAYER_KHRONOS_validation"
     };
@@ -2,24 +2,37 @@
 #include "Window.h"
 #include "RenderContext.h"
 #include "SwapChain.h"
+#include "UploadManager.h"
+#include "GeometryPool.h"
+#include "GpuProfiler.h"
+#include "Profiling/Profiler.h"
 
 namespace vkbg
 {
 Renderer::Renderer(Window* window, RenderContext* context)
     :m_Window(window), m_Context(context)
 {
-    RecreateSwapChain();
-    CreateCommandBuffers();
+    Init();
+}
+
+Renderer::Renderer(RenderContext* context, VkExtent2D offscreenExtent)
+    :m_Context(context), m_OffscreenExtent(offscreenExtent)
+{
+    assert(m_Context->IsHeadless() && "Offscreen rendering needs a headless render context");
+    Init();
 }
 
 Renderer::~Renderer()
 {
+    delete m_GpuProfiler;
+    DestroySecondaryCommandPools();
     FreeCommandBuffers();
     delete m_SwapChain;
 }
 
 bool Renderer::BeginFrame(VkCommandBuffer& commandBufferToUse)
 {
+    VKBG_PROFILE_FUNCTION();
     assert(m_IsFrameStarted == false && "Can't start a frame if a frame is already recording");
     VkResult result = m_SwapChain->AcquireNextImage(&m_CurrentImageIndex);
 
@@ -34,6 +47,17 @@ bool Renderer::BeginFrame(VkCommandBuffer& commandBufferToUse)
 
     m_IsFrameStarted = true;
 
+    // the frame fence was waited on by AcquireNextImage, nothing uses them anymore
+    for (uint32_t thread = 0; thread < m_SecondaryThreadCount; ++thread)
+    {
+        SecondaryCommandPool& pool = m_SecondaryPools[m_CurrentFrameIndex * m_SecondaryThreadCount + thread];
+        if (pool.UsedCount == 0)
+            continue;
+        vkResetCommandPool(m_Context->GetLogicalDevice(), pool.Pool, 0);
+        pool.UsedCount = 0;
+    }
+    m_Context->GetGeometryPool()->BeginFrame();
+
     VkCommandBuffer commandBuffer = GetCurrentCommandBuffer();
 
     VkCommandBufferBeginInfo beginInfo{
@@ -43,23 +67,34 @@ bool Renderer::BeginFrame(VkCommandBuffer& commandBufferToUse)
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
         throw std::runtime_error("A command buffer has failed to begin recording");
 
+    m_GpuProfiler->BeginFrame(commandBuffer, m_CurrentFrameIndex);
+    m_FrameQuery = m_GpuProfiler->BeginScope(commandBuffer, "Frame");
+
     commandBufferToUse = commandBuffer;
     return true;
 }
 
 void Renderer::EndFrame()
 {
+    VKBG_PROFILE_FUNCTION();
     assert(m_IsFrameStarted && "Can't end a frame if nothing is recording");
     VkCommandBuffer commandBuffer = GetCurrentCommandBuffer();
 
+    m_GpuProfiler->EndScope(commandBuffer, m_FrameQuery);
+
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
         throw std::runtime_error("A command buffer has failed to end recording");
 
+    // pending uploads go first so that this frame sees them
+    m_Context->GetUploadManager()->Flush();
+
     VkResult result = m_SwapChain->SubmitCommandBuffers(&commandBuffer, &m_CurrentImageIndex);
 
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_Window->WasWindowResized())
+    bool windowResized = m_Window != nullptr && m_Window->WasWindowResized();
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || windowResized)
     {
-        m_Window->ResetWindowResizeFlag();
+        if (m_Window != nullptr)
+            m_Window->ResetWindowResizeFlag();
         RecreateSwapChain();
     }
     else if (result != VK_SUCCESS)
@@ -69,7 +104,7 @@ void Renderer::EndFrame()
     m_IsFrameStarted = false;
 }
 
-void Renderer::BeginSwapChainRenderPass(VkCommandBuffer commandBuffer)
+void Renderer::BeginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents)
 {
     assert(m_IsFrameStarted && "Can't call this function if the frame isn't started");
     assert(commandBuffer == GetCurrentCommandBuffer() && "The given command buffer doesn't match the buffer for this frame");
@@ -90,12 +125,100 @@ void Renderer::BeginSwapChainRenderPass(VkCommandBuffer commandBuffer)
         .pClearValues = clearValues.data()
     };
 
-    // inline because it's a primary command buffer and that the commands
-    // are in the render pass itself
-    // if we used secondary command buffers, we could have used multiple command buffer
-    // in one render pass but we can't mix both of these methods
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // inline: the commands are recorded in the primary command buffer itself,
+    // secondary: the pass only executes secondary command buffers, the two
+    // can't be mixed in one subpass
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+
+    if (contents == VK_SUBPASS_CONTENTS_INLINE)
+        SetViewportAndScissor(commandBuffer);
+}
+void Renderer::EndSwapChainRenderPass(VkCommandBuffer commandBuffer)
+{
+    assert(m_IsFrameStarted && "Can't call this function if the frame isn't started");
+    assert(commandBuffer == GetCurrentCommandBuffer() && "The given command buffer doesn't match the buffer for this frame");
+
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+void Renderer::CreateSecondaryCommandPools(uint32_t threadCount)
+{
+    DestroySecondaryCommandPools();
+
+    VkCommandPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = m_Context->GetQueueFamilies().GraphicsFamily.value()
+    };
+
+    m_SecondaryThreadCount = threadCount;
+    m_SecondaryPools.resize(SwapChain::MAX_FRAMES_IN_FLIGHT * threadCount);
+    for (auto& pool : m_SecondaryPools)
+    {
+        if (vkCreateCommandPool(m_Context->GetLogicalDevice(), &poolInfo, nullptr, &pool.Pool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create a secondary command pool");
+    }
+}
+
+void Renderer::DestroySecondaryCommandPools()
+{
+    // destroying a pool frees its command buffers
+    for (auto& pool : m_SecondaryPools)
+        vkDestroyCommandPool(m_Context->GetLogicalDevice(), pool.Pool, nullptr);
+    m_SecondaryPools.clear();
+    m_SecondaryThreadCount = 0;
+}
+
+VkCommandBuffer Renderer::BeginSecondaryCommandBuffer(uint32_t threadIndex)
+{
+    assert(m_IsFrameStarted && "Can't record secondary command buffers if the frame isn't started");
+    assert(threadIndex < m_SecondaryThreadCount && "No secondary command pool for this thread");
+
+    SecondaryCommandPool& pool = m_SecondaryPools[m_CurrentFrameIndex * m_SecondaryThreadCount + threadIndex];
+    if (pool.UsedCount == pool.CommandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo{
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = pool.Pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+            .commandBufferCount = 1,
+        };
+
+        VkCommandBuffer commandBuffer{};
+        if (vkAllocateCommandBuffers(m_Context->GetLogicalDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("Failed to allocate a secondary command buffer");
+        pool.CommandBuffers.push_back(commandBuffer);
+    }
+    VkCommandBuffer commandBuffer = pool.CommandBuffers[pool.UsedCount++];
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .renderPass = m_SwapChain->GetRenderPass(),
+        .subpass = 0,
+        .framebuffer = m_SwapChain->GetFramebuffer(m_CurrentImageIndex),
+    };
+
+    VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+        .pInheritanceInfo = &inheritanceInfo
+    };
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("A secondary command buffer has failed to begin recording");
+
+    SetViewportAndScissor(commandBuffer);
+    return commandBuffer;
+}
 
+void Renderer::EndSecondaryCommandBuffer(VkCommandBuffer commandBuffer)
+{
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("A secondary command buffer has failed to end recording");
+}
+
+void Renderer::SetViewportAndScissor(VkCommandBuffer commandBuffer)
+{
     VkViewport viewport{
         .x = 0.f,
         .y = 0.f,
@@ -109,13 +232,6 @@ void Renderer::BeginSwapChainRenderPass(VkCommandBuffer commandBuffer)
     vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
-void Renderer::EndSwapChainRenderPass(VkCommandBuffer commandBuffer)
-{
-    assert(m_IsFrameStarted && "Can't call this function if the frame isn't started");
-    assert(commandBuffer == GetCurrentCommandBuffer() && "The given command buffer doesn't match the buffer for this frame");
-
-    vkCmdEndRenderPass(commandBuffer);
-}
 
 VkRenderPass Renderer::GetSwapChainRenderPass() const
 {
@@ -133,6 +249,13 @@ float Renderer::GetAspectRatio() const
     return (float)width / height;
 }
 
+void Renderer::Init()
+{
+    RecreateSwapChain();
+    CreateCommandBuffers();
+    m_GpuProfiler = new GpuProfiler(m_Context, SwapChain::MAX_FRAMES_IN_FLIGHT);
+}
+
 void Renderer::CreateCommandBuffers()
 {
     m_CommandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
@@ -160,11 +283,15 @@ void Renderer::FreeCommandBuffers()
 
 void Renderer::RecreateSwapChain()
 {
-    auto extent = m_Window->GetExtent();
-    while (extent.height == 0 || extent.width == 0)
+    VkExtent2D extent = m_OffscreenExtent;
+    if (m_Window != nullptr)
     {
-        glfwWaitEvents();
         extent = m_Window->GetExtent();
+        while (extent.height == 0 || extent.width == 0)
+        {
+            glfwWaitEvents();
+            extent = m_Window->GetExtent();
+        }
     }
 
     // wait for everything on the GPU to finish its executuion 
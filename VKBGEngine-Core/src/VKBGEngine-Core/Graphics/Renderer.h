@@ -6,13 +6,28 @@ class Renderer
 {
 public:
     Renderer(class Window* window, class RenderContext* context);
+    // headless: renders into offscreen images of the given size
+    Renderer(class RenderContext* context, VkExtent2D offscreenExtent);
     ~Renderer();
 
     bool BeginFrame(VkCommandBuffer& commandBufferToUse);
     void EndFrame();
-    void BeginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+    // With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the pass can only hold
+    // vkCmdExecuteCommands, the secondary buffers set their own viewport and scissor.
+    void BeginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
     void EndSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+    // Secondary command buffers for recording the swap chain render pass on
+    // several threads. Each recording thread gets its own command pool per frame
+    // in flight (command pools can't be used by two threads at once), the pools
+    // being reset when the frame begins again.
+    void CreateSecondaryCommandPools(uint32_t threadCount);
+    uint32_t GetSecondaryThreadCount() const { return m_SecondaryThreadCount; }
+    // Begins a secondary buffer continuing the render pass of the current frame,
+    // from the pool of threadIndex, with the viewport and scissor already set.
+    VkCommandBuffer BeginSecondaryCommandBuffer(uint32_t threadIndex);
+    void EndSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+
     // Getters
     bool IsFrameStarted() { return m_IsFrameStarted; }
     VkCommandBuffer GetCurrentCommandBuffer() const 
@@ -25,6 +40,7 @@ public:
         assert(m_IsFrameStarted && "Cannot get frame index if frame isn't in progress");
         return m_CurrentFrameIndex;
     }
+    class GpuProfiler* GetGpuProfiler() const { return m_GpuProfiler; }
     VkRenderPass GetSwapChainRenderPass() const;
     VkExtent2D GetSwapChainExtent() const;
     float GetAspectRatio() const;
@@ -35,8 +51,11 @@ private:
     Renderer(Renderer&&) = delete;
     Renderer& operator=(Renderer&&) = delete;
 
+    void Init();
     void CreateCommandBuffers();
     void FreeCommandBuffers();
+    void DestroySecondaryCommandPools();
+    void SetViewportAndScissor(VkCommandBuffer commandBuffer);
 
     void RecreateSwapChain();
 
@@ -44,10 +63,25 @@ private:
     // references
     class Window* m_Window{ nullptr };
     class RenderContext* m_Context{ nullptr };
+    VkExtent2D m_OffscreenExtent{};
 
 private:
     class SwapChain* m_SwapChain{ nullptr };
     std::vector<VkCommandBuffer> m_CommandBuffers;
+    class GpuProfiler* m_GpuProfiler{ nullptr };
+
+    struct SecondaryCommandPool
+    {
+        VkCommandPool Pool{ VK_NULL_HANDLE };
+        std::vector<VkCommandBuffer> CommandBuffers;
+        // buffers handed out since the last reset, the others are reused
+        uint32_t UsedCount{ 0 };
+    };
+    // [frameIndex * m_SecondaryThreadCount + threadIndex]
+    std::vector<SecondaryCommandPool> m_SecondaryPools;
+    uint32_t m_SecondaryThreadCount{ 0 };
+
+    uint32_t m_FrameQuery{ 0 };
 
     uint32_t m_CurrentImageIndex{ 0 }; // use swap chain next image
     uint32_t m_CurrentFrameIndex{ 0 }; // use frame in flight
@@ -1,5 +1,7 @@
 #include "SwapChain.h"
 #include "RenderContext.h"
+#include "MemoryAllocator.h"
+#include "Profiling/Profiler.h"
 
 namespace vkbg
 {
@@ -23,6 +25,12 @@ SwapChain::~SwapChain()
         vkDestroyImageView(device, imageView, nullptr);
     m_SwapChainImageViews.clear();
 
+    for (size_t i = 0; i < m_OffscreenImageMemories.size(); ++i)
+    {
+        vkDestroyImage(device, m_SwapChainImages[i], nullptr);
+        m_Context->GetAllocator()->Free(m_OffscreenImageMemories[i]);
+    }
+
     if (m_SwapChain != nullptr)
     {
         vkDestroySwapchainKHR(device, m_SwapChain, nullptr);
@@ -33,7 +41,7 @@ SwapChain::~SwapChain()
     {
         vkDestroyImageView(device, m_DepthImageViews[i], nullptr);
         vkDestroyImage(device, m_DepthImages[i], nullptr);
-        vkFreeMemory(device, m_DepthImageMemories[i], nullptr);
+        m_Context->GetAllocator()->Free(m_DepthImageMemories[i]);
     }
 
     for (auto framebuffer : m_SwapChainFramebuffers)
@@ -53,7 +61,11 @@ SwapChain::~SwapChain()
 
 void SwapChain::Init()
 {
-    CreateSwapChain();
+    m_Headless = m_Context->IsHeadless();
+    if (m_Headless)
+        CreateOffscreenImages();
+    else
+        CreateSwapChain();
     CreateImageViews();
     CreateRenderPass();
     CreateDepthResources();
@@ -63,10 +75,22 @@ void SwapChain::Init()
 
 VkResult SwapChain::AcquireNextImage(uint32_t* imageIndex)
 {
-    vkWaitForFences(
-        m_Context->GetLogicalDevice(), 
-        1, &m_InFlightFences[m_CurrentFrame], 
-        VK_TRUE, std::numeric_limits<uint64_t>::max());
+    VKBG_PROFILE_FUNCTION();
+
+    {
+        VKBG_PROFILE_SCOPE("WaitForFrameFence");
+        vkWaitForFences(
+            m_Context->GetLogicalDevice(), 
+            1, &m_InFlightFences[m_CurrentFrame], 
+            VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+
+    if (m_Headless)
+    {
+        // one offscreen image per frame in flight, guarded by the fence above
+        *imageIndex = (uint32_t)m_CurrentFrame;
+        return VK_SUCCESS;
+    }
 
     VkResult result = vkAcquireNextImageKHR(
         m_Context->GetLogicalDevice(), m_SwapChain,
@@ -78,8 +102,11 @@ VkResult SwapChain::AcquireNextImage(uint32_t* imageIndex)
 
 VkResult SwapChain::SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex)
 {
+    VKBG_PROFILE_FUNCTION();
+
     if (m_ImagesInFlight[*imageIndex] != VK_NULL_HANDLE)
     {
+        VKBG_PROFILE_SCOPE("WaitForImageFence");
         vkWaitForFences(
             m_Context->GetLogicalDevice(), 
             1, &m_ImagesInFlight[*imageIndex], 
@@ -92,15 +119,16 @@ VkResult SwapChain::SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_
 
     VkSemaphore waitSemaphores[] = { m_ImageAvailableSemaphores[m_CurrentFrame] };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = m_Headless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = buffers;
 
+    // nothing is presented in headless mode, so nothing waits on the semaphores
     VkSemaphore signalSemaphores[] = { m_RenderFinishedSemaphores[m_CurrentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = m_Headless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     vkResetFences(m_Context->GetLogicalDevice(), 1, &m_InFlightFences[m_CurrentFrame]);
@@ -110,6 +138,12 @@ VkResult SwapChain::SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_
         throw std::runtime_error("failed to submit draw command buffer!");
     }
 
+    if (m_Headless)
+    {
+        m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        return VK_SUCCESS;
+    }
+
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
@@ -122,6 +156,7 @@ VkResult SwapChain::SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_
 
     presentInfo.pImageIndices = imageIndex;
 
+    VKBG_PROFILE_SCOPE("QueuePresent");
     auto result = vkQueuePresentKHR(m_Context->GetPresentQueue(), &presentInfo);
 
     m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
@@ -189,6 +224,51 @@ void SwapChain::CreateSwapChain()
     m_SwapChainExtent = extent;
 }
 
+void SwapChain::CreateOffscreenImages()
+{
+    m_SwapChainImageFormat = m_Context->FindSupportedFormat(
+        {
+            VK_FORMAT_B8G8R8A8_SRGB,
+            VK_FORMAT_R8G8B8A8_SRGB,
+            VK_FORMAT_B8G8R8A8_UNORM,
+            VK_FORMAT_R8G8B8A8_UNORM
+        },
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+    m_SwapChainExtent = m_WindowExtent;
+
+    // nothing holds on to the images for presentation, one per frame in flight is enough
+    m_SwapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+    m_OffscreenImageMemories.resize(MAX_FRAMES_IN_FLIGHT);
+
+    for (size_t i = 0; i < m_SwapChainImages.size(); ++i)
+    {
+        VkImageCreateInfo imageInfo{
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = m_SwapChainImageFormat,
+            .extent = {
+                .width = m_SwapChainExtent.width,
+                .height = m_SwapChainExtent.height,
+                .depth = 1,
+            },
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        };
+
+        m_Context->CreateImageWithInfo(
+            imageInfo,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            m_SwapChainImages[i],
+            m_OffscreenImageMemories[i]);
+    }
+}
+
 void SwapChain::CreateImageViews()
 {
     m_SwapChainImageViews.resize(m_SwapChainImages.size());
@@ -240,7 +320,8 @@ void SwapChain::CreateRenderPass()
         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+        // the layout isn't part of render pass compatibility, pipelines work with both
+        .finalLayout = m_Headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
     };
     VkAttachmentReference colorAttachmentRef = {
         .attachment = 0,
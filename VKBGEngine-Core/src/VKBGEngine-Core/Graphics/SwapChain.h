@@ -2,6 +2,9 @@
 
 namespace vkbg
 {
+// Without a surface (headless RenderContext) the "swap chain" is a set of
+// offscreen color images with the same render pass and framebuffer layout;
+// frames are submitted but never presented.
 class SwapChain
 {
 public:
@@ -32,12 +35,15 @@ public:
     size_t GetImageCount() const { return m_SwapChainImages.size(); }
     VkRenderPass GetRenderPass() const { return m_RenderPass; }
     VkFramebuffer GetFramebuffer(uint32_t index) { return m_SwapChainFramebuffers[index]; }
+    VkImage GetImage(uint32_t index) const { return m_SwapChainImages[index]; }
+    bool IsHeadless() const { return m_Headless; }
 
 private:
     class RenderContext* m_Context;
     VkExtent2D m_WindowExtent;
 
-    VkSwapchainKHR m_SwapChain;
+    bool m_Headless{ false };
+    VkSwapchainKHR m_SwapChain{ VK_NULL_HANDLE };
     VkFormat m_SwapChainImageFormat;
     VkFormat m_SwapChainDepthFormat;
     VkExtent2D m_SwapChainExtent;
@@ -45,9 +51,11 @@ private:
     std::vector<VkImage> m_SwapChainImages;
     std::vector<VkImageView> m_SwapChainImageViews;
     std::vector<VkFramebuffer> m_SwapChainFramebuffers;
+    // headless only, swap chain images are owned by the swap chain
+    std::vector<struct Allocation> m_OffscreenImageMemories;
 
     std::vector<VkImage> m_DepthImages;
-    std::vector<VkDeviceMemory> m_DepthImageMemories;
+    std::vector<struct Allocation> m_DepthImageMemories;
     std::vector<VkImageView> m_DepthImageViews;
 
     VkRenderPass m_RenderPass;
@@ -62,6 +70,7 @@ private:
 
 private:
     void CreateSwapChain();
+    void CreateOffscreenImages();
     void CreateImageViews();
     void CreateRenderPass();
     void CreateDepthResources();
@@ -0,0 +1,174 @@
+#include "CullingSystem.h"
+#include "Graphics/Model.h"
+#include "Threading/JobSystem.h"
+
+namespace vkbg
+{
+static bool IsSphereVisible(float x, float y, float z, float radius, const Frustum& frustum)
+{
+    for (const auto& plane : frustum.Planes)
+    {
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w + radius < 0.f)
+            return false;
+    }
+    return true;
+}
+
+static uint32_t CullSpheresTail(const SphereSoA& spheres, uint32_t first, const Frustum& frustum, uint32_t* outVisible, uint32_t visibleCount)
+{
+    for (uint32_t i = first; i < spheres.Size(); ++i)
+    {
+        if (IsSphereVisible(spheres.X[i], spheres.Y[i], spheres.Z[i], spheres.Radius[i], frustum))
+            outVisible[visibleCount++] = i;
+    }
+    return visibleCount;
+}
+
+uint32_t CullingSystem::CullEntities(const Scene& scene, const Frustum& frustum, std::vector<uint32_t>& visibleEntities)
+{
+    const uint32_t entityCount = scene.GetEntityCount();
+    m_Spheres.Resize(entityCount);
+
+    uint32_t testedCount = 0;
+    if (m_JobSystem == nullptr || entityCount < 2 * JobSystem::MinRangeSize)
+    {
+        testedCount = ComputeSpheres(scene, 0, entityCount);
+    }
+    else
+    {
+        std::atomic<uint32_t> tested{ 0 };
+        m_JobSystem->ParallelFor(entityCount, JobSystem::MinRangeSize, [&](uint32_t first, uint32_t last)
+        {
+            tested.fetch_add(ComputeSpheres(scene, first, last), std::memory_order_relaxed);
+        });
+        testedCount = tested.load();
+    }
+
+    // spheres are indexed like the entities, so the kernel writes the visible entities directly
+    visibleEntities.resize(entityCount);
+    visibleEntities.resize(CullSpheres(m_Spheres, frustum, visibleEntities.data()));
+    return testedCount;
+}
+
+uint32_t CullingSystem::ComputeSpheres(const Scene& scene, uint32_t first, uint32_t last)
+{
+    const auto worldMatrices = scene.GetWorldMatrices();
+    const auto meshHandles = scene.GetMeshHandles();
+
+    uint32_t meshCount = 0;
+    for (uint32_t i = first; i < last; ++i)
+    {
+        if (meshHandles[i] == InvalidMesh)
+        {
+            // fails every plane test
+            m_Spheres.X[i] = m_Spheres.Y[i] = m_Spheres.Z[i] = 0.f;
+            m_Spheres.Radius[i] = -std::numeric_limits<float>::max();
+            continue;
+        }
+
+        const BoundingSphere& local = scene.GetMesh(meshHandles[i])->GetBoundingSphere();
+        const glm::mat4& world = worldMatrices[i];
+        const glm::vec3 center = world * glm::vec4(local.Center, 1.f);
+        const float maxScale = TransformComponent::GetMaxScale(world);
+
+        m_Spheres.X[i] = center.x;
+        m_Spheres.Y[i] = center.y;
+        m_Spheres.Z[i] = center.z;
+        m_Spheres.Radius[i] = local.Radius * maxScale;
+        ++meshCount;
+    }
+    return meshCount;
+}
+
+uint32_t CullingSystem::CullSpheres(const SphereSoA& spheres, const Frustum& frustum, uint32_t* outVisible)
+{
+#if defined(VKBG_SIMD_AVX)
+    if (simd::HasAvx2())
+        return CullSpheresAvx2(spheres, frustum, outVisible);
+#endif
+#if defined(VKBG_SIMD_SSE)
+    return CullSpheresSse(spheres, frustum, outVisible);
+#else
+    return CullSpheresScalar(spheres, frustum, outVisible);
+#endif
+}
+
+uint32_t CullingSystem::CullSpheresScalar(const SphereSoA& spheres, const Frustum& frustum, uint32_t* outVisible)
+{
+    return CullSpheresTail(spheres, 0, frustum, outVisible, 0);
+}
+
+#if defined(VKBG_SIMD_SSE)
+uint32_t CullingSystem::CullSpheresSse(const SphereSoA& spheres, const Frustum& frustum, uint32_t* outVisible)
+{
+    const uint32_t count = spheres.Size();
+    const uint32_t simdCount = count & ~3u;
+    const __m128 zero = _mm_setzero_ps();
+
+    uint32_t visibleCount = 0;
+    for (uint32_t i = 0; i < simdCount; i += 4)
+    {
+        const __m128 x = _mm_loadu_ps(&spheres.X[i]);
+        const __m128 y = _mm_loadu_ps(&spheres.Y[i]);
+        const __m128 z = _mm_loadu_ps(&spheres.Z[i]);
+        const __m128 r = _mm_loadu_ps(&spheres.Radius[i]);
+
+        __m128 outside = _mm_setzero_ps();
+        for (const auto& plane : frustum.Planes)
+        {
+            __m128 d = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+            d = _mm_add_ps(d, _mm_mul_ps(y, _mm_set1_ps(plane.y)));
+            d = _mm_add_ps(d, _mm_mul_ps(z, _mm_set1_ps(plane.z)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+        }
+
+        uint32_t mask = ~(uint32_t)_mm_movemask_ps(outside) & 0xFu;
+        while (mask != 0)
+        {
+            outVisible[visibleCount++] = i + std::countr_zero(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return CullSpheresTail(spheres, simdCount, frustum, outVisible, visibleCount);
+}
+#endif
+
+#if defined(VKBG_SIMD_AVX)
+VKBG_TARGET_AVX2
+uint32_t CullingSystem::CullSpheresAvx2(const SphereSoA& spheres, const Frustum& frustum, uint32_t* outVisible)
+{
+    const uint32_t count = spheres.Size();
+    const uint32_t simdCount = count & ~7u;
+
+    const __m256 zero = _mm256_setzero_ps();
+
+    uint32_t visibleCount = 0;
+    for (uint32_t i = 0; i < simdCount; i += 8)
+    {
+        const __m256 x = _mm256_loadu_ps(&spheres.X[i]);
+        const __m256 y = _mm256_loadu_ps(&spheres.Y[i]);
+        const __m256 z = _mm256_loadu_ps(&spheres.Z[i]);
+        const __m256 r = _mm256_loadu_ps(&spheres.Radius[i]);
+
+        __m256 outside = _mm256_setzero_ps();
+        for (const auto& plane : frustum.Planes)
+        {
+            __m256 d = _mm256_fmadd_ps(x, _mm256_set1_ps(plane.x), _mm256_add_ps(r, _mm256_set1_ps(plane.w)));
+            d = _mm256_fmadd_ps(y, _mm256_set1_ps(plane.y), d);
+            d = _mm256_fmadd_ps(z, _mm256_set1_ps(plane.z), d);
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, zero, _CMP_LT_OQ));
+        }
+
+        uint32_t mask = ~(uint32_t)_mm256_movemask_ps(outside) & 0xFFu;
+        while (mask != 0)
+        {
+            outVisible[visibleCount++] = i + std::countr_zero(mask);
+            mask &= mask - 1;
+        }
+    }
+
+    return CullSpheresTail(spheres, simdCount, frustum, outVisible, visibleCount);
+}
+#endif
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "Entities/Scene.h"
+#include "Entities/Camera.h"
+#include "Math/Simd.h"
+
+namespace vkbg
+{
+// World space bounding spheres in structure-of-arrays form, so that the culling
+// kernels can test 4 (SSE) or 8 (AVX) spheres against a plane at once.
+struct SphereSoA
+{
+    std::vector<float> X;
+    std::vector<float> Y;
+    std::vector<float> Z;
+    std::vector<float> Radius;
+
+    void Clear() { X.clear(); Y.clear(); Z.clear(); Radius.clear(); }
+    void Resize(uint32_t size) { X.resize(size); Y.resize(size); Z.resize(size); Radius.resize(size); }
+    uint32_t Size() const { return (uint32_t)X.size(); }
+};
+
+// Frustum culling of the entities' bounding spheres, run before RenderEntities.
+class CullingSystem
+{
+public:
+    // The world space spheres are computed on jobSystem when there is one.
+    explicit CullingSystem(class JobSystem* jobSystem = nullptr) : m_JobSystem{ jobSystem } {}
+
+    // Writes the dense indices of the entities whose bounding sphere touches the
+    // frustum to visibleEntities. Entities without a mesh are skipped.
+    // Returns the number of entities tested.
+    uint32_t CullEntities(const Scene& scene, const Frustum& frustum, std::vector<uint32_t>& visibleEntities);
+
+    // Kernels writing the indices of the visible spheres to outVisible (which must
+    // hold spheres.Size() entries) and returning how many there are.
+    // CullSpheres dispatches to the widest one the CPU supports.
+    static uint32_t CullSpheres(const SphereSoA& spheres, const Frustum& frustum, uint32_t* outVisible);
+    static uint32_t CullSpheresScalar(const SphereSoA& spheres, const Frustum& frustum, uint32_t* outVisible);
+#if defined(VKBG_SIMD_SSE)
+    static uint32_t CullSpheresSse(const SphereSoA& spheres, const Frustum& frustum, uint32_t* outVisible);
+#endif
+#if defined(VKBG_SIMD_AVX)
+    static uint32_t CullSpheresAvx2(const SphereSoA& spheres, const Frustum& frustum, uint32_t* outVisible);
+#endif
+
+private:
+    // world space spheres of the entities in [first, last), returns how many have a mesh
+    uint32_t ComputeSpheres(const Scene& scene, uint32_t first, uint32_t last);
+
+private:
+    class JobSystem* m_JobSystem{ nullptr };
+    // one sphere per entity, those without a mesh can't be visible
+    SphereSoA m_Spheres;
+};
+}
@@ -0,0 +1,50 @@
+#include "DrawSort.h"
+
+namespace vkbg
+{
+static constexpr uint32_t RadixBits = 8;
+static constexpr uint32_t BucketCount = 1u << RadixBits;
+static constexpr uint32_t PassCount = 64 / RadixBits;
+
+void RadixSortDraws(std::vector<SortedDraw>& draws, std::vector<SortedDraw>& scratch)
+{
+    const size_t count = draws.size();
+    if (count < 2)
+        return;
+
+    std::array<std::array<uint32_t, BucketCount>, PassCount> histograms{};
+    for (const SortedDraw& draw : draws)
+    {
+        for (uint32_t pass = 0; pass < PassCount; ++pass)
+            ++histograms[pass][(draw.Key >> (pass * RadixBits)) & (BucketCount - 1)];
+    }
+
+    scratch.resize(count);
+    SortedDraw* source = draws.data();
+    SortedDraw* destination = scratch.data();
+    for (uint32_t pass = 0; pass < PassCount; ++pass)
+    {
+        auto& histogram = histograms[pass];
+        const uint32_t shift = pass * RadixBits;
+        // a pass only moves the draws around, the byte of the first one is
+        // still a byte of the keys
+        if (histogram[(source[0].Key >> shift) & (BucketCount - 1)] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (uint32_t& bucket : histogram)
+        {
+            const uint32_t bucketSize = bucket;
+            bucket = offset;
+            offset += bucketSize;
+        }
+        for (size_t i = 0; i < count; ++i)
+            destination[histogram[(source[i].Key >> shift) & (BucketCount - 1)]++] = source[i];
+        std::swap(source, destination);
+    }
+
+    // an odd number of passes left the result in scratch
+    if (source != draws.data())
+        draws.swap(scratch);
+}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+namespace vkbg
+{
+// 64-bit sort key of a draw, most significant field first:
+//   | pass 2 | pipeline 6 | geometry block 8 | mesh 21 | lod 3 | depth 24 |
+// Sorting the keys ascending groups the draws by the state they bind, in the
+// order it is the most expensive to change, and orders the draws of a same
+// state front to back. Everything above the depth is the draw's state: draws
+// whose keys only differ by their depth can share an instanced draw.
+namespace DrawKey
+{
+static constexpr uint32_t DepthBits = 24;
+static constexpr uint32_t LodBits = 3;
+static constexpr uint32_t MeshBits = 21;
+static constexpr uint32_t BlockBits = 8;
+static constexpr uint32_t PipelineBits = 6;
+static constexpr uint32_t PassBits = 2;
+static_assert(DepthBits + LodBits + MeshBits + BlockBits + PipelineBits + PassBits == 64);
+
+static constexpr uint64_t StateMask = ~((1ull << DepthBits) - 1);
+
+// Front to back order of view space depths (distance along the view
+// direction). The bits of a non negative float sort like the float itself, the
+// key keeps the exponent and the top 15 bits of the mantissa. Negative depths
+// (behind the camera) all land on 0.
+inline uint32_t QuantizeDepth(float depth)
+{
+    return std::bit_cast<uint32_t>(depth > 0.f ? depth : 0.f) >> (32 - 1 - DepthBits);
+}
+
+inline uint64_t Make(uint32_t pass, uint32_t pipeline, uint32_t block, uint32_t mesh, uint32_t lod, float depth)
+{
+    assert(pass < (1u << PassBits) && pipeline < (1u << PipelineBits) && "Draw key field out of range");
+    assert(block < (1u << BlockBits) && mesh < (1u << MeshBits) && lod < (1u << LodBits) && "Draw key field out of range");
+    return (uint64_t)pass << (64 - PassBits)
+        | (uint64_t)pipeline << (DepthBits + LodBits + MeshBits + BlockBits)
+        | (uint64_t)block << (DepthBits + LodBits + MeshBits)
+        | (uint64_t)mesh << (DepthBits + LodBits)
+        | (uint64_t)lod << DepthBits
+        | QuantizeDepth(depth);
+}
+
+inline uint32_t GetLod(uint64_t key)
+{
+    return (uint32_t)(key >> DepthBits) & ((1u << LodBits) - 1);
+}
+}
+
+struct SortedDraw
+{
+    uint64_t Key;
+    // dense index of the entity in the scene
+    uint32_t Entity;
+};
+
+// Stable LSD radix sort of the draws by key, 8 bits per pass. The histograms of
+// all the passes are built in one read of the keys, and the passes whose byte is
+// the same for every key (the pass and pipeline most of the time) are skipped.
+// scratch is resized to the number of draws and only kept to reuse its memory.
+void RadixSortDraws(std::vector<SortedDraw>& draws, std::vector<SortedDraw>& scratch);
+}
@@ -0,0 +1,426 @@
+#include "GpuDrivenRenderSystem.h"
+#include "ObjectData.h"
+#include "Graphics/Pipeline.h"
+#include "Graphics/RenderContext.h"
+#include "Graphics/Model.h"
+#include "Graphics/GeometryPool.h"
+#include "Graphics/Buffer.h"
+#include "Graphics/SwapChain.h"
+#include "Graphics/Descriptors.h"
+#include "FrameInfo.h"
+
+namespace vkbg
+{
+// std430 layout of MeshData in Cull.comp, one per level of detail of every mesh
+struct MeshData
+{
+    glm::vec4 BoundingSphere{ 0.f };
+    uint32_t IndexCount{ 0 };
+    uint32_t FirstIndex{ 0 };
+    int32_t VertexOffset{ 0 };
+    uint32_t Block{ 0 };
+};
+
+// std430 layout of BlockDraws in Cull.comp, the count read by the indirect draw
+// of the block and where its draws start
+struct BlockDraws
+{
+    uint32_t Count{ 0 };
+    uint32_t FirstDraw{ 0 };
+};
+
+struct CullPushConstants
+{
+    std::array<glm::vec4, Frustum::Side::Count> FrustumPlanes;
+    uint32_t ObjectCount;
+};
+
+static constexpr uint32_t MinObjectCapacity = 1024;
+static constexpr uint32_t MinMeshCapacity = 64;
+static constexpr uint32_t MinBlockCapacity = 4;
+// local_size_x of Cull.comp
+static constexpr uint32_t CullGroupSize = 64;
+
+GpuDrivenRenderSystem::GpuDrivenRenderSystem(
+    RenderContext* context,
+    VkRenderPass renderPass,
+    VkDescriptorSetLayout globalSetLayout)
+    : m_Context{ context }
+{
+    assert(m_Context->SupportsDrawIndirectCount() && "The device can't draw with an indirect count");
+    m_MaxDrawCount = m_Context->GetPhysicalDeviceProperties().limits.maxDrawIndirectCount;
+
+    CreateDescriptors();
+    CreatePipelineLayouts(globalSetLayout);
+    CreatePipelines(renderPass);
+}
+
+GpuDrivenRenderSystem::~GpuDrivenRenderSystem()
+{
+    vkDestroyPipelineLayout(m_Context->GetLogicalDevice(), m_CullPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(m_Context->GetLogicalDevice(), m_PipelineLayout, nullptr);
+    delete m_CullPipeline;
+    for (Pipeline* pipeline : m_Pipelines)
+        delete pipeline;
+}
+
+uint32_t GpuDrivenRenderSystem::CullEntities(
+    VkCommandBuffer commandBuffer,
+    const Scene& scene,
+    const Frustum& frustum,
+    const FrameInfo& frameInfo)
+{
+    FrameResources& frame = m_Frames[frameInfo.FrameIndex];
+
+    // the frame fence has been waited on, the counts of its last use are final
+    frame.BlockDraws->Invalidate();
+    const auto* lastBlockDraws = static_cast<const BlockDraws*>(frame.BlockDraws->GetMappedMemory());
+    m_LastVisibleCount = 0;
+    for (uint32_t block = 0; block < frame.BlockObjectCounts.size(); ++block)
+        m_LastVisibleCount += lastBlockDraws[block].Count;
+
+    const auto meshHandles = scene.GetMeshHandles();
+    const auto worldMatrices = scene.GetWorldMatrices();
+    const auto normalMatrices = scene.GetNormalMatrices();
+    const auto colors = scene.GetColors();
+    const auto materialIndices = scene.GetMaterialIndices();
+    const auto lodLevels = scene.GetLodLevels();
+
+    const uint32_t entityCount = scene.GetEntityCount();
+    const uint32_t meshCount = scene.GetMeshCount();
+    const uint32_t blockCount = m_Context->GetGeometryPool()->GetBlockCount();
+
+    // the levels of a mesh follow each other, an object points at the one it draws
+    m_MeshFirstEntries.resize(meshCount);
+    uint32_t meshEntryCount = 0;
+    for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+    {
+        m_MeshFirstEntries[mesh] = meshEntryCount;
+        meshEntryCount += scene.GetMesh(mesh)->GetLodCount();
+    }
+    ReserveFrameBuffers(frameInfo.FrameIndex, entityCount, meshEntryCount, blockCount);
+
+    auto* meshes = static_cast<MeshData*>(frame.Meshes->GetMappedMemory());
+    m_MeshBlocks.resize(meshCount);
+    for (uint32_t mesh = 0; mesh < meshCount; ++mesh)
+    {
+        const Model* model = scene.GetMesh(mesh);
+        // in the space of the vertices, the object's matrix maps them to the world
+        const BoundingSphere sphere = model->GetVertexBoundingSphere();
+        const GeometryAllocation& geometry = model->GetGeometry();
+        for (uint32_t lod = 0; lod < model->GetLodCount(); ++lod)
+        {
+            meshes[m_MeshFirstEntries[mesh] + lod] = MeshData{
+                .BoundingSphere = glm::vec4{ sphere.Center, sphere.Radius },
+                .IndexCount = model->GetLod(lod).IndexCount,
+                .FirstIndex = geometry.FirstIndex + model->GetLod(lod).FirstIndex,
+                .VertexOffset = geometry.VertexOffset,
+                .Block = geometry.Block
+            };
+        }
+        m_MeshBlocks[mesh] = geometry.Block;
+    }
+
+    // only the entities with a mesh become objects, packed at the front
+    frame.BlockObjectCounts.assign(blockCount, 0);
+    auto* objects = static_cast<ObjectData*>(frame.Objects->GetMappedMemory());
+    auto* objectMeshes = static_cast<uint32_t*>(frame.ObjectMeshes->GetMappedMemory());
+    uint32_t objectCount = 0;
+    for (uint32_t i = 0; i < entityCount; ++i)
+    {
+        if (meshHandles[i] == InvalidMesh)
+            continue;
+
+        const Model* model = scene.GetMesh(meshHandles[i]);
+        objects[objectCount] = ObjectData{
+            .ModelMatrix = model->GetVertexToWorld(worldMatrices[i]),
+            .NormalMatrix = glm::mat3x4{ normalMatrices[i] },
+            .Color = colors[i],
+            .MaterialIndex = materialIndices[i]
+        };
+        const uint32_t lod = std::min<uint32_t>(lodLevels[i], model->GetLodCount() - 1);
+        objectMeshes[objectCount] = m_MeshFirstEntries[meshHandles[i]] + lod;
+        ++frame.BlockObjectCounts[m_MeshBlocks[meshHandles[i]]];
+        ++objectCount;
+    }
+    frame.ObjectCount = objectCount;
+
+    // the counts start at zero, host writes are visible to the submission
+    // without a barrier
+    auto* blockDraws = static_cast<BlockDraws*>(frame.BlockDraws->GetMappedMemory());
+    uint32_t firstDraw = 0;
+    for (uint32_t block = 0; block < blockCount; ++block)
+    {
+        blockDraws[block] = BlockDraws{ .Count = 0, .FirstDraw = firstDraw };
+        firstDraw += frame.BlockObjectCounts[block];
+    }
+
+    frame.Objects->Flush(objectCount * sizeof(ObjectData));
+    frame.ObjectMeshes->Flush(objectCount * sizeof(uint32_t));
+    frame.Meshes->Flush(meshEntryCount * sizeof(MeshData));
+    frame.BlockDraws->Flush(blockCount * sizeof(BlockDraws));
+
+    if (objectCount == 0)
+        return 0;
+
+    CullPushConstants pushConstants{
+        .FrustumPlanes = frustum.Planes,
+        .ObjectCount = objectCount
+    };
+
+    m_CullPipeline->BindToCommandBuffer(commandBuffer);
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        m_CullPipelineLayout,
+        0, 1, &frame.CullDescriptorSet,
+        0, nullptr
+    );
+    vkCmdPushConstants(
+        commandBuffer, m_CullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &pushConstants);
+    vkCmdDispatch(commandBuffer, (objectCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+
+    // the draws and their counts are read by the indirect draws, and the counts
+    // by the CPU once the frame fence is signaled
+    VkMemoryBarrier cullBarrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT
+    };
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        1, &cullBarrier,
+        0, nullptr,
+        0, nullptr);
+
+    return objectCount;
+}
+
+void GpuDrivenRenderSystem::RenderEntities(VkCommandBuffer commandBuffer, const FrameInfo& frameInfo)
+{
+    FrameResources& frame = m_Frames[frameInfo.FrameIndex];
+    if (frame.ObjectCount == 0)
+        return;
+
+    // the pipelines share their layout, the sets stay bound across them
+    VkDescriptorSet descriptorSets[]{ frameInfo.GlobalDescriptorSet, frame.ObjectDescriptorSet };
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        m_PipelineLayout,
+        0, 2, descriptorSets,
+        0, nullptr
+    );
+
+    GeometryPool* geometryPool = m_Context->GetGeometryPool();
+    VertexLayout boundLayout = VertexLayout::Count;
+    uint32_t firstDraw = 0;
+    for (uint32_t block = 0; block < frame.BlockObjectCounts.size(); ++block)
+    {
+        const uint32_t objectCount = frame.BlockObjectCounts[block];
+        if (objectCount == 0)
+            continue;
+
+        // the vertices of a block all have the same layout
+        if (geometryPool->GetBlockLayout(block) != boundLayout)
+        {
+            boundLayout = geometryPool->GetBlockLayout(block);
+            m_Pipelines[(size_t)boundLayout]->BindToCommandBuffer(commandBuffer);
+        }
+        geometryPool->Bind(commandBuffer, block);
+        // objects past the device limit aren't drawn, at least 2^16 - 1 with multiDrawIndirect
+        m_Context->CmdDrawIndexedIndirectCount(
+            commandBuffer,
+            frame.DrawCommands->GetBuffer(), firstDraw * sizeof(VkDrawIndexedIndirectCommand),
+            frame.BlockDraws->GetBuffer(), block * sizeof(BlockDraws),
+            std::min(objectCount, m_MaxDrawCount),
+            sizeof(VkDrawIndexedIndirectCommand));
+        firstDraw += objectCount;
+    }
+}
+
+void GpuDrivenRenderSystem::ReserveFrameBuffers(
+    uint32_t frameIndex,
+    uint32_t objectCount,
+    uint32_t meshCount,
+    uint32_t blockCount)
+{
+    // The previous use of this frame's buffers and descriptor sets is done once
+    // the frame has begun, so they can be replaced right away.
+    FrameResources& frame = m_Frames[frameIndex];
+    bool replaced = false;
+
+    if (frame.Objects == nullptr || frame.Objects->GetInstanceCount() < objectCount)
+    {
+        uint32_t capacity = std::max(MinObjectCapacity, std::bit_ceil(objectCount));
+        frame.Objects = std::make_unique<Buffer>(
+            m_Context,
+            sizeof(ObjectData),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.Objects->Map();
+
+        frame.ObjectMeshes = std::make_unique<Buffer>(
+            m_Context,
+            sizeof(uint32_t),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.ObjectMeshes->Map();
+
+        frame.DrawCommands = std::make_unique<Buffer>(
+            m_Context,
+            sizeof(VkDrawIndexedIndirectCommand),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        replaced = true;
+    }
+
+    if (frame.Meshes == nullptr || frame.Meshes->GetInstanceCount() < meshCount)
+    {
+        uint32_t capacity = std::max(MinMeshCapacity, std::bit_ceil(meshCount));
+        frame.Meshes = std::make_unique<Buffer>(
+            m_Context,
+            sizeof(MeshData),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.Meshes->Map();
+        replaced = true;
+    }
+
+    if (frame.BlockDraws == nullptr || frame.BlockDraws->GetInstanceCount() < blockCount)
+    {
+        uint32_t capacity = std::max(MinBlockCapacity, std::bit_ceil(blockCount));
+        frame.BlockDraws = std::make_unique<Buffer>(
+            m_Context,
+            sizeof(BlockDraws),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        frame.BlockDraws->Map();
+        replaced = true;
+    }
+
+    if (replaced)
+        WriteDescriptorSets(frameIndex);
+}
+
+void GpuDrivenRenderSystem::WriteDescriptorSets(uint32_t frameIndex)
+{
+    FrameResources& frame = m_Frames[frameIndex];
+
+    auto objectsInfo = frame.Objects->DescriptorInfo();
+    auto objectMeshesInfo = frame.ObjectMeshes->DescriptorInfo();
+    auto meshesInfo = frame.Meshes->DescriptorInfo();
+    auto drawCommandsInfo = frame.DrawCommands->DescriptorInfo();
+    auto blockDrawsInfo = frame.BlockDraws->DescriptorInfo();
+
+    DescriptorWriter(*m_ObjectSetLayout, *m_DescriptorPool)
+        .WriteBuffer(0, &objectsInfo)
+        .Overwrite(frame.ObjectDescriptorSet);
+
+    DescriptorWriter(*m_CullSetLayout, *m_DescriptorPool)
+        .WriteBuffer(0, &objectsInfo)
+        .WriteBuffer(1, &objectMeshesInfo)
+        .WriteBuffer(2, &meshesInfo)
+        .WriteBuffer(3, &drawCommandsInfo)
+        .WriteBuffer(4, &blockDrawsInfo)
+        .Overwrite(frame.CullDescriptorSet);
+}
+
+void GpuDrivenRenderSystem::CreateDescriptors()
+{
+    m_ObjectSetLayout = DescriptorSetLayout::Builder(m_Context)
+        .AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+        .Build();
+
+    m_CullSetLayout = DescriptorSetLayout::Builder(m_Context)
+        .AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .AddBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .AddBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .AddBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .AddBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .Build();
+
+    // an object set and a cull set per frame
+    m_DescriptorPool.reset(DescriptorPool::Builder(m_Context)
+        .SetMaxSets(2 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+        .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6 * SwapChain::MAX_FRAMES_IN_FLIGHT)
+        .Build());
+
+    m_Frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (uint32_t i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        FrameResources& frame = m_Frames[i];
+        if (m_DescriptorPool->AllocateDescriptor(m_ObjectSetLayout->GetDescriptorSetLayout(), frame.ObjectDescriptorSet) == false
+            || m_DescriptorPool->AllocateDescriptor(m_CullSetLayout->GetDescriptorSetLayout(), frame.CullDescriptorSet) == false)
+            throw std::runtime_error("Failed to allocate the GPU driven descriptor sets");
+
+        ReserveFrameBuffers(i, MinObjectCapacity, MinMeshCapacity, MinBlockCapacity);
+    }
+}
+
+void GpuDrivenRenderSystem::CreatePipelineLayouts(VkDescriptorSetLayout globalSetLayout)
+{
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, m_ObjectSetLayout->GetDescriptorSetLayout() };
+
+    VkPipelineLayoutCreateInfo createInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = (uint32_t)descriptorSetLayouts.size(),
+        .pSetLayouts = descriptorSetLayouts.data(),
+        .pushConstantRangeCount = 0,
+        .pPushConstantRanges = nullptr
+    };
+
+    if (vkCreatePipelineLayout(m_Context->GetLogicalDevice(), &createInfo, nullptr, &m_PipelineLayout))
+        throw std::runtime_error("Failed to create PipelineLayout");
+
+    VkDescriptorSetLayout cullSetLayout = m_CullSetLayout->GetDescriptorSetLayout();
+    VkPushConstantRange pushConstantRange{
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset = 0,
+        .size = sizeof(CullPushConstants)
+    };
+
+    VkPipelineLayoutCreateInfo cullCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &cullSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
+    };
+
+    if (vkCreatePipelineLayout(m_Context->GetLogicalDevice(), &cullCreateInfo, nullptr, &m_CullPipelineLayout))
+        throw std::runtime_error("Failed to create the culling PipelineLayout");
+}
+
+void GpuDrivenRenderSystem::CreatePipelines(VkRenderPass renderPass)
+{
+    for (size_t layout = 0; layout < m_Pipelines.size(); ++layout)
+    {
+        PipelineProps pipelineProperties{};
+        Pipeline::GetDefaultPipelineProps(pipelineProperties, (VertexLayout)layout);
+        pipelineProperties.RenderPass = renderPass;
+        pipelineProperties.PipelineLayout = m_PipelineLayout;
+
+        m_Pipelines[layout] = new Pipeline(
+            m_Context,
+            GetVertexShaderPath("Simple", (VertexLayout)layout),
+            "res/Shaders/Compiled/Simple.frag.spv",
+            pipelineProperties
+        );
+    }
+
+    m_CullPipeline = new ComputePipeline(
+        m_Context,
+        "res/Shaders/Compiled/Cull.comp.spv",
+        m_CullPipelineLayout
+    );
+}
+}
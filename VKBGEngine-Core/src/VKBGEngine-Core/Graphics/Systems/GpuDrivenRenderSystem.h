@@ -0,0 +1,97 @@
+#pragma once
+#include "Entities/Scene.h"
+#include "Entities/Camera.h"
+#include "Graphics/VertexLayout.h"
+
+namespace vkbg
+{
+// Draws the scene without a per-draw CPU loop. Every frame the object data of
+// all the entities with a mesh is copied to a storage buffer, a compute shader
+// (Cull.comp) frustum culls their bounding spheres and writes the indexed draws
+// of the visible ones, at the level of detail the scene holds for them, along
+// with their count, and the render pass draws them with one
+// vkCmdDrawIndexedIndirectCount per geometry pool block. The draws of a block
+// are contiguous: the CPU hands every block a range sized for all of its
+// objects and the shader appends to the range of the object's block. Each
+// block is drawn with the pipeline of its vertex layout.
+//
+// Needs RenderContext::SupportsDrawIndirectCount.
+class GpuDrivenRenderSystem
+{
+public:
+    GpuDrivenRenderSystem(
+        class RenderContext* context,
+        VkRenderPass renderPass,
+        VkDescriptorSetLayout globalSetLayout);
+    ~GpuDrivenRenderSystem();
+
+    // Writes the objects of the frame and records the culling dispatch, outside
+    // of the render pass. Returns the number of entities tested.
+    uint32_t CullEntities(
+        VkCommandBuffer commandBuffer,
+        const Scene& scene,
+        const Frustum& frustum,
+        const struct FrameInfo& frameInfo);
+    // Records the indirect draw of the objects culled by CullEntities, in the render pass.
+    void RenderEntities(VkCommandBuffer commandBuffer, const struct FrameInfo& frameInfo);
+
+    // Visible objects as counted by the GPU, read back from the last frame
+    // that used the same frame in flight resources, so a few frames late.
+    uint32_t GetLastVisibleCount() const { return m_LastVisibleCount; }
+
+private:
+    GpuDrivenRenderSystem(const GpuDrivenRenderSystem&) = delete;
+    GpuDrivenRenderSystem& operator=(const GpuDrivenRenderSystem&) = delete;
+    GpuDrivenRenderSystem(GpuDrivenRenderSystem&&) = delete;
+    GpuDrivenRenderSystem& operator=(GpuDrivenRenderSystem&&) = delete;
+
+    void CreateDescriptors();
+    void CreatePipelineLayouts(VkDescriptorSetLayout globalSetLayout);
+    void CreatePipelines(VkRenderPass renderPass);
+
+    // Makes sure the buffers of the frame can hold objectCount objects,
+    // meshCount mesh levels of detail and blockCount blocks, rewriting its
+    // descriptor sets when a buffer is replaced.
+    void ReserveFrameBuffers(uint32_t frameIndex, uint32_t objectCount, uint32_t meshCount, uint32_t blockCount);
+    void WriteDescriptorSets(uint32_t frameIndex);
+
+private:
+    // references
+    class RenderContext* m_Context;
+
+private:
+    // one per vertex layout
+    std::array<class Pipeline*, (size_t)VertexLayout::Count> m_Pipelines{};
+    class ComputePipeline* m_CullPipeline{ nullptr };
+    VkPipelineLayout m_PipelineLayout;
+    VkPipelineLayout m_CullPipelineLayout;
+
+    std::unique_ptr<class DescriptorSetLayout> m_ObjectSetLayout;
+    std::unique_ptr<class DescriptorSetLayout> m_CullSetLayout;
+    std::unique_ptr<class DescriptorPool> m_DescriptorPool;
+
+    // Per frame in flight. The buffers written by the CPU are persistently
+    // mapped, the draw commands stay on the GPU and the counts are read back.
+    struct FrameResources
+    {
+        std::unique_ptr<class Buffer> Objects;
+        std::unique_ptr<class Buffer> ObjectMeshes;
+        std::unique_ptr<class Buffer> Meshes;
+        std::unique_ptr<class Buffer> DrawCommands;
+        std::unique_ptr<class Buffer> BlockDraws;
+        VkDescriptorSet ObjectDescriptorSet{ VK_NULL_HANDLE };
+        VkDescriptorSet CullDescriptorSet{ VK_NULL_HANDLE };
+        uint32_t ObjectCount{ 0 };
+        // objects per geometry pool block, the size of its range of draws
+        std::vector<uint32_t> BlockObjectCounts;
+    };
+    std::vector<FrameResources> m_Frames;
+    // geometry pool block of every mesh and its first level in the mesh
+    // buffer, rebuilt each frame
+    std::vector<uint32_t> m_MeshBlocks;
+    std::vector<uint32_t> m_MeshFirstEntries;
+
+    uint32_t m_MaxDrawCount{ 0 };
+    uint32_t m_LastVisibleCount{ 0 };
+};
+}
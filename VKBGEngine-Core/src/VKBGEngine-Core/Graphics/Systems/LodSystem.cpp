@@ -0,0 +1,107 @@
+#include "LodSystem.h"
+#include "Graphics/Model.h"
+#include "Threading/JobSystem.h"
+
+namespace vkbg
+{
+LodStats LodSystem::SelectLods(Scene& scene, const std::vector<uint32_t>& entities, const Camera& camera, float viewportHeight)
+{
+    return Select(scene, entities.data(), (uint32_t)entities.size(), camera, viewportHeight);
+}
+
+LodStats LodSystem::SelectAllLods(Scene& scene, const Camera& camera, float viewportHeight)
+{
+    return Select(scene, nullptr, scene.GetEntityCount(), camera, viewportHeight);
+}
+
+LodStats LodSystem::Select(Scene& scene, const uint32_t* entities, uint32_t count, const Camera& camera, float viewportHeight)
+{
+    if (m_JobSystem == nullptr || count < 2 * JobSystem::MinRangeSize)
+        return SelectRange(scene, entities, 0, count, camera, viewportHeight);
+
+    // every entity writes its own level, the ranges only share the counts
+    std::atomic<uint64_t> triangles{ 0 };
+    std::atomic<uint64_t> fullDetailTriangles{ 0 };
+    m_JobSystem->ParallelFor(count, JobSystem::MinRangeSize, [&](uint32_t first, uint32_t last)
+    {
+        const LodStats stats = SelectRange(scene, entities, first, last, camera, viewportHeight);
+        triangles.fetch_add(stats.Triangles, std::memory_order_relaxed);
+        fullDetailTriangles.fetch_add(stats.FullDetailTriangles, std::memory_order_relaxed);
+    });
+    return LodStats{ triangles.load(), fullDetailTriangles.load() };
+}
+
+LodStats LodSystem::SelectRange(
+    Scene& scene, const uint32_t* entities, uint32_t first, uint32_t last, const Camera& camera, float viewportHeight) const
+{
+    const auto meshHandles = scene.GetMeshHandles();
+    const auto worldMatrices = scene.GetWorldMatrices();
+    const auto lodLevels = scene.GetLodLevels();
+
+    // view space depth of a world position: its view z (the camera looks down
+    // +z), the third row of the view matrix
+    const glm::mat4& view = camera.GetViewMatrix();
+    const glm::vec4 depthRow{ view[0][2], view[1][2], view[2][2], view[3][2] };
+    // a world unit at depth d covers projection[1][1] * height / 2 / d pixels,
+    // at any depth for an orthographic projection
+    const glm::mat4& projection = camera.GetProjectionMatrix();
+    const bool perspective = projection[2][3] != 0.f;
+    const float pixelsPerUnit = projection[1][1] * viewportHeight * .5f;
+    const float strictPixelError = m_PixelError * (1.f - m_Hysteresis);
+
+    LodStats stats{};
+    for (uint32_t i = first; i < last; ++i)
+    {
+        const uint32_t entity = entities != nullptr ? entities[i] : i;
+        if (meshHandles[entity] == InvalidMesh)
+            continue;
+
+        const Model* model = scene.GetMesh(meshHandles[entity]);
+        const uint32_t lodCount = model->GetLodCount();
+        stats.FullDetailTriangles += model->GetLod(0).IndexCount / 3;
+        if (lodCount == 1)
+        {
+            lodLevels[entity] = 0;
+            stats.Triangles += model->GetLod(0).IndexCount / 3;
+            continue;
+        }
+
+        const glm::mat4& world = worldMatrices[entity];
+        const BoundingSphere& sphere = model->GetBoundingSphere();
+        const float maxScale = TransformComponent::GetMaxScale(world);
+
+        // errors are in model units, the pixels they cover are measured at the
+        // sphere's closest point, full detail when the camera is inside of it
+        float modelPixelsPerUnit = pixelsPerUnit * maxScale;
+        if (perspective)
+        {
+            const float depth = glm::dot(depthRow, world * glm::vec4(sphere.Center, 1.f)) - sphere.Radius * maxScale;
+            modelPixelsPerUnit = depth > 0.f ? modelPixelsPerUnit / depth : std::numeric_limits<float>::max();
+        }
+
+        // the levels get coarser and their errors larger
+        uint32_t coarsest = 0;
+        uint32_t coarsestStrict = 0;
+        for (uint32_t lod = 1; lod < lodCount; ++lod)
+        {
+            const float pixels = model->GetLod(lod).Error * modelPixelsPerUnit;
+            if (pixels > m_PixelError)
+                break;
+            coarsest = lod;
+            if (pixels <= strictPixelError)
+                coarsestStrict = lod;
+        }
+
+        // finer right away, coarser only once well within the error
+        uint32_t lod = std::min<uint32_t>(lodLevels[entity], lodCount - 1);
+        if (lod > coarsest)
+            lod = coarsest;
+        else if (coarsestStrict > lod)
+            lod = coarsestStrict;
+
+        lodLevels[entity] = (uint8_t)lod;
+        stats.Triangles += model->GetLod(lod).IndexCount / 3;
+    }
+    return stats;
+}
+}
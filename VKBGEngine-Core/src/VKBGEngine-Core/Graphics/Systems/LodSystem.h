@@ -0,0 +1,44 @@
+#pragma once
+#include "Entities/Scene.h"
+#include "Entities/Camera.h"
+
+namespace vkbg
+{
+// Triangles of the levels picked, and what they would have been at full detail.
+struct LodStats
+{
+    uint64_t Triangles{ 0 };
+    uint64_t FullDetailTriangles{ 0 };
+};
+
+// Picks the level of detail of the entities (Scene::GetLodLevels) from how
+// large their mesh is on screen: the coarsest level whose error, projected at
+// the near side of the entity's bounding sphere, stays under pixelError pixels.
+// An entity only goes to a coarser level once that level's error is under
+// (1 - hysteresis) times pixelError, so that it doesn't keep switching back and
+// forth when the camera hovers around the distance of a switch.
+class LodSystem
+{
+public:
+    // The entities are split across jobSystem when there is one.
+    explicit LodSystem(class JobSystem* jobSystem = nullptr, float pixelError = 1.f, float hysteresis = .25f)
+        : m_JobSystem{ jobSystem }, m_PixelError{ pixelError }, m_Hysteresis{ hysteresis } {}
+
+    // Levels of the entities listed (dense indices), seen from camera in a
+    // viewport viewportHeight pixels high.
+    LodStats SelectLods(Scene& scene, const std::vector<uint32_t>& entities, const Camera& camera, float viewportHeight);
+    // Same for every entity of the scene.
+    LodStats SelectAllLods(Scene& scene, const Camera& camera, float viewportHeight);
+
+private:
+    // entities is null to go through the dense indices [first, last) directly
+    LodStats SelectRange(
+        Scene& scene, const uint32_t* entities, uint32_t first, uint32_t last, const Camera& camera, float viewportHeight) const;
+    LodStats Select(Scene& scene, const uint32_t* entities, uint32_t count, const Camera& camera, float viewportHeight);
+
+private:
+    class JobSystem* m_JobSystem{ nullptr };
+    float m_PixelError;
+    float m_Hysteresis;
+};
+}
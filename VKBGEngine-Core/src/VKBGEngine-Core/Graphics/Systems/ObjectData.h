@@ -0,0 +1,16 @@
+#pragma once
+
+namespace vkbg
+{
+// Per object data read by the shaders from set 1, std430 layout of ObjectData
+// in Simple.vert: a mat3 takes three 16-byte columns and the material index
+// fills the padding after the color.
+struct ObjectData
+{
+    glm::mat4 ModelMatrix{ 1.f };
+    glm::mat3x4 NormalMatrix{ 1.f };
+    glm::vec3 Color{ 1.f };
+    uint32_t MaterialIndex{ 0 };
+};
+static_assert(sizeof(ObjectData) == 128, "ObjectData doesn't match the std430 layout of the shaders");
+}
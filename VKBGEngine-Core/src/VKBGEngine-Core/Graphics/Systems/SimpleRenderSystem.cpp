@@ -1,18 +1,23 @@
 #include "SimpleRenderSystem.h"
+#include "ObjectData.h"
 #include "Graphics/Renderer.h"
 #include "Graphics/Pipeline.h"
 #include "Graphics/RenderContext.h"
 #include "Graphics/Model.h"
+#include "Graphics/Buffer.h"
+#include "Graphics/SwapChain.h"
+#include "Graphics/Descriptors.h"
 #include "Entities/Camera.h"
+#include "Threading/JobSystem.h"
 #include "FrameInfo.h"
 
 namespace vkbg
 {
-struct SimplePushConstantData
-{
-    glm::mat4 ModelMatrix{ 1.f };
-    glm::mat4 NormalMatrix{ 1.f };
-};
+static constexpr uint32_t MinObjectCapacity = 1024;
+// smallest range of batches recorded into one secondary command buffer
+static constexpr uint32_t MinBatchesPerCommandBuffer = 64;
+static_assert((1u << DrawKey::LodBits) >= Model::MaxLodCount, "The draw keys can't hold every level of detail");
+static_assert((1u << DrawKey::PipelineBits) >= (uint32_t)VertexLayout::Count, "The draw keys can't hold every vertex layout");
 
 SimpleRenderSystem::SimpleRenderSystem(
     class RenderContext* context,
@@ -20,87 +25,274 @@ SimpleRenderSystem::SimpleRenderSystem(
     VkDescriptorSetLayout globalSetLayout)
     : m_Context{context}
 {
+    CreateObjectDescriptors();
     CreatePipelineLayout(globalSetLayout);
-    CreatePipeline(renderPass);
+    CreatePipelines(renderPass);
 }
 
 SimpleRenderSystem::~SimpleRenderSystem()
 {
     vkDestroyPipelineLayout(m_Context->GetLogicalDevice(), m_PipelineLayout, nullptr);
-    delete m_Pipeline;
+    for (Pipeline* pipeline : m_Pipelines)
+        delete pipeline;
+}
+
+uint32_t SimpleRenderSystem::RenderEntities(
+    VkCommandBuffer commandBuffer,
+    const Scene& scene,
+    const std::vector<uint32_t>& visibleEntities,
+    const FrameInfo& frameInfo)
+{
+    m_BindStats = {};
+    if (BuildBatches(scene, visibleEntities, frameInfo) == 0)
+        return 0;
+
+    m_BindStats = RecordBatches(commandBuffer, scene, frameInfo, 0, (uint32_t)m_Batches.size());
+    return (uint32_t)m_Batches.size();
+}
+
+uint32_t SimpleRenderSystem::RenderEntitiesParallel(
+    Renderer& renderer,
+    JobSystem& jobSystem,
+    const Scene& scene,
+    const std::vector<uint32_t>& visibleEntities,
+    const FrameInfo& frameInfo)
+{
+    m_BindStats = {};
+    if (BuildBatches(scene, visibleEntities, frameInfo) == 0)
+        return 0;
+
+    // every range costs a command buffer begin/end and a few binds, so ranges
+    // are only split off once there are enough draws to pay for them
+    m_SecondaryCommandBuffers.clear();
+    jobSystem.ParallelFor((uint32_t)m_Batches.size(), MinBatchesPerCommandBuffer, [&](uint32_t first, uint32_t last)
+    {
+        VkCommandBuffer commandBuffer = renderer.BeginSecondaryCommandBuffer(jobSystem.GetCurrentThreadIndex());
+        DrawBindStats bindStats = RecordBatches(commandBuffer, scene, frameInfo, first, last);
+        renderer.EndSecondaryCommandBuffer(commandBuffer);
+
+        std::lock_guard lock{ m_SecondaryCommandBuffersMutex };
+        m_SecondaryCommandBuffers.push_back({ first, commandBuffer });
+        m_BindStats.PipelineBinds += bindStats.PipelineBinds;
+        m_BindStats.PipelineBindsSaved += bindStats.PipelineBindsSaved;
+        m_BindStats.BufferBinds += bindStats.BufferBinds;
+        m_BindStats.BufferBindsSaved += bindStats.BufferBindsSaved;
+    });
+
+    // executed in batch order so that the frame draws the same as RenderEntities
+    std::sort(m_SecondaryCommandBuffers.begin(), m_SecondaryCommandBuffers.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::vector<VkCommandBuffer> commandBuffers(m_SecondaryCommandBuffers.size());
+    for (size_t i = 0; i < commandBuffers.size(); ++i)
+        commandBuffers[i] = m_SecondaryCommandBuffers[i].second;
+    vkCmdExecuteCommands(frameInfo.CommandBuffer, (uint32_t)commandBuffers.size(), commandBuffers.data());
+
+    return (uint32_t)m_Batches.size();
 }
 
-void SimpleRenderSystem::RenderEntities(VkCommandBuffer commandBuffer, std::vector<Entity>& entities, const FrameInfo& frameInfo)
+uint32_t SimpleRenderSystem::BuildBatches(const Scene& scene, const std::vector<uint32_t>& visibleEntities, const FrameInfo& frameInfo)
 {
-    m_Pipeline->BindToCommandBuffer(commandBuffer);
+    const auto meshHandles = scene.GetMeshHandles();
+    const auto worldMatrices = scene.GetWorldMatrices();
+    const auto normalMatrices = scene.GetNormalMatrices();
+    const auto colors = scene.GetColors();
+    const auto materialIndices = scene.GetMaterialIndices();
+    const auto lodLevels = scene.GetLodLevels();
+
+    // view space depth of a world position: its view z (the camera looks down
+    // +z), the third row of the view matrix
+    const glm::mat4& view = frameInfo.CameraRef.GetViewMatrix();
+    const glm::vec4 depthRow{ view[0][2], view[1][2], view[2][2], view[3][2] };
+
+    m_Draws.clear();
+    for (uint32_t entityIndex : visibleEntities)
+    {
+        MeshHandle mesh = meshHandles[entityIndex];
+        if (mesh == InvalidMesh)
+            continue;
+
+        // everything is opaque, the pipeline only depends on the vertex layout
+        const float depth = glm::dot(depthRow, worldMatrices[entityIndex][3]);
+        const Model* model = scene.GetMesh(mesh);
+        const uint32_t pipeline = (uint32_t)model->GetVertexLayout();
+        const uint32_t lod = std::min<uint32_t>(lodLevels[entityIndex], model->GetLodCount() - 1);
+        m_Draws.push_back({ DrawKey::Make(0, pipeline, model->GetGeometry().Block, mesh, lod, depth), entityIndex });
+    }
+
+    m_Batches.clear();
+    const uint32_t instanceCount = (uint32_t)m_Draws.size();
+    if (instanceCount == 0)
+        return 0;
+
+    RadixSortDraws(m_Draws, m_DrawsScratch);
+
+    // the draws of a state are contiguous once sorted, each run is a batch
+    // and its objects are written in draw order, front to back
+    Buffer& objectBuffer = GetObjectBuffer(frameInfo.FrameIndex, instanceCount);
+    auto* objects = static_cast<ObjectData*>(objectBuffer.GetMappedMemory());
+    uint64_t batchState = ~0ull;
+    for (uint32_t instance = 0; instance < instanceCount; ++instance)
+    {
+        const SortedDraw& draw = m_Draws[instance];
+        if ((draw.Key & DrawKey::StateMask) != batchState)
+        {
+            batchState = draw.Key & DrawKey::StateMask;
+            m_Batches.push_back({ meshHandles[draw.Entity], DrawKey::GetLod(draw.Key), instance, 0 });
+        }
+        ++m_Batches.back().InstanceCount;
+
+        // quantized positions are mapped back to the model's space on the way
+        const Model* model = scene.GetMesh(meshHandles[draw.Entity]);
+        objects[instance] = ObjectData{
+            .ModelMatrix = model->GetVertexToWorld(worldMatrices[draw.Entity]),
+            .NormalMatrix = glm::mat3x4{ normalMatrices[draw.Entity] },
+            .Color = colors[draw.Entity],
+            .MaterialIndex = materialIndices[draw.Entity]
+        };
+    }
+    objectBuffer.Flush(instanceCount * sizeof(ObjectData));
+    return instanceCount;
+}
 
+DrawBindStats SimpleRenderSystem::RecordBatches(
+    VkCommandBuffer commandBuffer,
+    const Scene& scene,
+    const FrameInfo& frameInfo,
+    uint32_t firstBatch,
+    uint32_t lastBatch)
+{
+    // secondary command buffers don't inherit any state, so every buffer binds
+    // everything. The pipelines share their layout, the sets stay bound across them.
+    VkDescriptorSet descriptorSets[]{ frameInfo.GlobalDescriptorSet, m_ObjectDescriptorSets[frameInfo.FrameIndex] };
     vkCmdBindDescriptorSets(
-        frameInfo.CommandBuffer,
+        commandBuffer,
         VK_PIPELINE_BIND_POINT_GRAPHICS,
         m_PipelineLayout,
-        0, 1, &frameInfo.GlobalDescriptorSet,
+        0, 2, descriptorSets,
         0, nullptr
     );
 
-    for (auto& entity : entities)
+    // meshes of the same geometry pool block share their buffers, only a change
+    // of block needs a new bind, and the sort keeps the draws of a block together.
+    // Same for the pipelines and the vertex layouts, sorted before the blocks.
+    DrawBindStats bindStats{};
+    VertexLayout boundLayout = VertexLayout::Count;
+    uint32_t boundBlock = UINT32_MAX;
+    for (uint32_t batchIndex = firstBatch; batchIndex < lastBatch; ++batchIndex)
     {
-        SimplePushConstantData push{
-            .ModelMatrix = entity.Transform.GetTransform(),
-            .NormalMatrix = entity.Transform.GetNormalMatrix()
-        };
+        const InstanceBatch& batch = m_Batches[batchIndex];
+        Model* model = scene.GetMesh(batch.Mesh);
+        if (model->GetVertexLayout() != boundLayout)
+        {
+            boundLayout = model->GetVertexLayout();
+            m_Pipelines[(size_t)boundLayout]->BindToCommandBuffer(commandBuffer);
+            ++bindStats.PipelineBinds;
+        }
+        if (model->GetGeometry().Block != boundBlock)
+        {
+            model->Bind(commandBuffer);
+            boundBlock = model->GetGeometry().Block;
+            ++bindStats.BufferBinds;
+        }
+        model->Draw(commandBuffer, batch.InstanceCount, batch.FirstInstance, batch.Lod);
+    }
 
-        vkCmdPushConstants(
-            commandBuffer,
-            m_PipelineLayout,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            0,
-            sizeof(SimplePushConstantData),
-            &push
-        );
+    const uint32_t drawCount = lastBatch - firstBatch;
+    bindStats.PipelineBindsSaved = drawCount - bindStats.PipelineBinds;
+    bindStats.BufferBindsSaved = drawCount - bindStats.BufferBinds;
+    return bindStats;
+}
+
+Buffer& SimpleRenderSystem::GetObjectBuffer(uint32_t frameIndex, uint32_t objectCount)
+{
+    // The previous use of this frame's buffer and descriptor set is done once
+    // the frame has begun, so both can be replaced right away.
+    auto& buffer = m_ObjectBuffers[frameIndex];
+    if (buffer->GetInstanceCount() < objectCount)
+    {
+        uint32_t capacity = std::max(MinObjectCapacity, std::bit_ceil(objectCount));
+        buffer = std::make_unique<Buffer>(
+            m_Context,
+            sizeof(ObjectData),
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        buffer->Map();
 
-        entity.Model->Bind(commandBuffer);
-        entity.Model->Draw(commandBuffer);
+        auto bufferInfo = buffer->DescriptorInfo();
+        DescriptorWriter(*m_ObjectSetLayout, *m_ObjectDescriptorPool)
+            .WriteBuffer(0, &bufferInfo)
+            .Overwrite(m_ObjectDescriptorSets[frameIndex]);
     }
+    return *buffer;
 }
 
-void SimpleRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout)
+void SimpleRenderSystem::CreateObjectDescriptors()
 {
-    VkPushConstantRange pcRange{
-        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-        .offset = 0,
-        .size = sizeof(SimplePushConstantData)
-    };
+    m_ObjectSetLayout = DescriptorSetLayout::Builder(m_Context)
+        .AddBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+        .Build();
 
-    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
+    m_ObjectDescriptorPool.reset(DescriptorPool::Builder(m_Context)
+        .SetMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
+        .AddPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+        .Build());
+
+    m_ObjectBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    m_ObjectDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (uint32_t i = 0; i < SwapChain::MAX_FRAMES_IN_FLIGHT; ++i)
+    {
+        m_ObjectBuffers[i] = std::make_unique<Buffer>(
+            m_Context,
+            sizeof(ObjectData),
+            MinObjectCapacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        m_ObjectBuffers[i]->Map();
+
+        auto bufferInfo = m_ObjectBuffers[i]->DescriptorInfo();
+        if (DescriptorWriter(*m_ObjectSetLayout, *m_ObjectDescriptorPool)
+            .WriteBuffer(0, &bufferInfo)
+            .Build(m_ObjectDescriptorSets[i]) == false)
+            throw std::runtime_error("Failed to allocate the object descriptor sets");
+    }
+}
+
+void SimpleRenderSystem::CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout)
+{
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, m_ObjectSetLayout->GetDescriptorSetLayout() };
 
     VkPipelineLayoutCreateInfo createInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
         .setLayoutCount = (uint32_t)descriptorSetLayouts.size(),
         .pSetLayouts = descriptorSetLayouts.data(),
-        .pushConstantRangeCount = 1,
-        .pPushConstantRanges = &pcRange
+        .pushConstantRangeCount = 0,
+        .pPushConstantRanges = nullptr
     };
 
     if (vkCreatePipelineLayout(m_Context->GetLogicalDevice(), &createInfo, nullptr, &m_PipelineLayout))
         throw std::runtime_error("Failed to create PipelineLayout");
 }
 
-void SimpleRenderSystem::CreatePipeline(VkRenderPass renderPass)
+void SimpleRenderSystem::CreatePipelines(VkRenderPass renderPass)
 {
     assert(m_PipelineLayout != nullptr && "SwapChain wasn't initialized");
 
-    PipelineProps pipelineProperties{};
-    Pipeline::GetDefaultPipelineProps(pipelineProperties);
+    for (size_t layout = 0; layout < m_Pipelines.size(); ++layout)
+    {
+        PipelineProps pipelineProperties{};
+        Pipeline::GetDefaultPipelineProps(pipelineProperties, (VertexLayout)layout);
 
-    pipelineProperties.RenderPass = renderPass;
-    pipelineProperties.PipelineLayout = m_PipelineLayout;
+        pipelineProperties.RenderPass = renderPass;
+        pipelineProperties.PipelineLayout = m_PipelineLayout;
 
-    delete m_Pipeline;
-    m_Pipeline = new Pipeline(
-        m_Context,
-        "res/Shaders/Compiled/Simple.vert.spv",
-        "res/Shaders/Compiled/Simple.frag.spv",
-        pipelineProperties
-    );
+        delete m_Pipelines[layout];
+        m_Pipelines[layout] = new Pipeline(
+            m_Context,
+            GetVertexShaderPath("Simple", (VertexLayout)layout),
+            "res/Shaders/Compiled/Simple.frag.spv",
+            pipelineProperties
+        );
+    }
 }
 }
@@ -1,8 +1,20 @@
 #pragma once
-#include "Entities/Entity.h"
+#include "Entities/Scene.h"
+#include "DrawSort.h"
+#include "Graphics/VertexLayout.h"
 
 namespace vkbg
 {
+// Binds saved by sorting the draws, counted against binding the pipeline and
+// the geometry buffers for every draw.
+struct DrawBindStats
+{
+    uint32_t PipelineBinds{ 0 };
+    uint32_t PipelineBindsSaved{ 0 };
+    uint32_t BufferBinds{ 0 };
+    uint32_t BufferBindsSaved{ 0 };
+};
+
 class SimpleRenderSystem
 {
 public:
@@ -11,7 +23,26 @@ public:
         VkRenderPass renderPass,
         VkDescriptorSetLayout globalSetLayout);
     ~SimpleRenderSystem();
-    void RenderEntities(VkCommandBuffer commandBuffer, std::vector<Entity>& entities, const struct FrameInfo& frameInfo);
+    // Only the entities listed in visibleEntities (dense indices into the scene) are drawn.
+    // Returns the number of draw calls recorded.
+    uint32_t RenderEntities(
+        VkCommandBuffer commandBuffer,
+        const Scene& scene,
+        const std::vector<uint32_t>& visibleEntities,
+        const struct FrameInfo& frameInfo);
+    // Same as RenderEntities, but the batches are split in ranges recorded on the
+    // threads of jobSystem into secondary command buffers of renderer, which are
+    // then executed in frameInfo.CommandBuffer. The swap chain render pass has to
+    // have been begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+    uint32_t RenderEntitiesParallel(
+        class Renderer& renderer,
+        class JobSystem& jobSystem,
+        const Scene& scene,
+        const std::vector<uint32_t>& visibleEntities,
+        const struct FrameInfo& frameInfo);
+
+    // Binds of the last RenderEntities/RenderEntitiesParallel.
+    const DrawBindStats& GetLastBindStats() const { return m_BindStats; }
 
 private:
     SimpleRenderSystem(const SimpleRenderSystem&) = delete;
@@ -19,17 +50,59 @@ private:
     SimpleRenderSystem(SimpleRenderSystem&&) = delete;
     SimpleRenderSystem& operator=(SimpleRenderSystem&&) = delete;
 
+    void CreateObjectDescriptors();
     void CreatePipelineLayout(VkDescriptorSetLayout globalSetLayout);
-    void CreatePipeline(VkRenderPass renderPass);
+    void CreatePipelines(VkRenderPass renderPass);
+
+    // Makes sure the object buffer of the frame can hold objectCount objects.
+    class Buffer& GetObjectBuffer(uint32_t frameIndex, uint32_t objectCount);
+    // Sorts the visible entities by draw key, groups those sharing a state in
+    // m_Batches and writes their object data to the object buffer of the frame
+    // in sorted order. Returns the number of objects.
+    uint32_t BuildBatches(const Scene& scene, const std::vector<uint32_t>& visibleEntities, const struct FrameInfo& frameInfo);
+    // Records the draws of the batches [firstBatch, lastBatch) with their
+    // bindings. Returns the binds it recorded.
+    DrawBindStats RecordBatches(
+        VkCommandBuffer commandBuffer,
+        const Scene& scene,
+        const struct FrameInfo& frameInfo,
+        uint32_t firstBatch,
+        uint32_t lastBatch);
 
 private:
     // references
     class RenderContext* m_Context;
 
 private:
-    class Pipeline* m_Pipeline{ nullptr };
+    // one per vertex layout, the layout is the pipeline of the draw keys
+    std::array<class Pipeline*, (size_t)VertexLayout::Count> m_Pipelines{};
     VkPipelineLayout m_PipelineLayout;
 
+    // Entities sharing a draw state (their key without the depth) are drawn
+    // with one instanced draw, front to back within the draw.
+    struct InstanceBatch
+    {
+        MeshHandle Mesh;
+        uint32_t Lod;
+        uint32_t FirstInstance;
+        uint32_t InstanceCount;
+    };
+    std::vector<InstanceBatch> m_Batches;
+    std::vector<SortedDraw> m_Draws;
+    std::vector<SortedDraw> m_DrawsScratch;
+    DrawBindStats m_BindStats;
+    // secondary command buffers recorded this frame, by their first batch
+    std::vector<std::pair<uint32_t, VkCommandBuffer>> m_SecondaryCommandBuffers;
+    std::mutex m_SecondaryCommandBuffersMutex;
+
+    // Per object data (set 1), one persistently mapped storage buffer per frame
+    // in flight, grown on demand. The objects of a batch are contiguous and the
+    // shader reads them with gl_InstanceIndex, which starts at FirstInstance.
+    std::unique_ptr<class DescriptorSetLayout> m_ObjectSetLayout;
+    std::unique_ptr<class DescriptorPool> m_ObjectDescriptorPool;
+    std::vector<VkDescriptorSet> m_ObjectDescriptorSets;
+    std::vector<std::unique_ptr<class Buffer>> m_ObjectBuffers;
+
 };
 }
 
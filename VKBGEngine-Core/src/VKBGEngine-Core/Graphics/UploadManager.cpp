@@ -0,0 +1,241 @@
+#include "UploadManager.h"
+#include "RenderContext.h"
+#include "Buffer.h"
+#include "Profiling/Profiler.h"
+
+namespace vkbg
+{
+UploadManager::UploadManager(RenderContext* context)
+    : m_Context{ context }
+{
+    m_StagingRing = std::make_unique<Buffer>(
+        m_Context,
+        1,
+        (uint32_t)StagingRingSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (m_StagingRing->Map() != VK_SUCCESS)
+        throw std::runtime_error("Failed to map the staging ring");
+    m_StagingData = static_cast<uint8_t*>(m_StagingRing->GetMappedMemory());
+
+    CreateBatches();
+}
+
+UploadManager::~UploadManager()
+{
+    WaitIdle();
+
+    VkDevice device = m_Context->GetLogicalDevice();
+    for (auto& batch : m_Batches)
+        vkDestroyFence(device, batch.Fence, nullptr);
+    vkDestroyCommandPool(device, m_CommandPool, nullptr);
+
+    m_StagingRing.reset();
+}
+
+UploadTicket UploadManager::Upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset)
+{
+    // big uploads are split so that a single copy never needs the whole ring
+    constexpr VkDeviceSize maxChunkSize = StagingRingSize / 4;
+
+    const uint8_t* src = static_cast<const uint8_t*>(data);
+    UploadTicket ticket = 0;
+    while (size > 0)
+    {
+        VkDeviceSize chunkSize = std::min(size, maxChunkSize);
+        VkDeviceSize stagingOffset = ReserveRingSpace(chunkSize);
+        memcpy(m_StagingData + stagingOffset, src, chunkSize);
+
+        Batch& batch = GetRecordingBatch();
+        VkBufferCopy region{ stagingOffset, dstOffset, chunkSize };
+        vkCmdCopyBuffer(batch.CommandBuffer, m_StagingRing->GetBuffer(), dstBuffer, 1, &region);
+        batch.RingEnd = m_RingHead;
+        ticket = batch.Ticket;
+
+        src += chunkSize;
+        dstOffset += chunkSize;
+        size -= chunkSize;
+    }
+    return ticket;
+}
+
+void UploadManager::Flush()
+{
+    if (m_Recording < 0)
+        return;
+
+    Batch& batch = m_Batches[m_Recording];
+
+    VkMemoryBarrier barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+            | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT
+    };
+    vkCmdPipelineBarrier(
+        batch.CommandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr);
+
+    if (vkEndCommandBuffer(batch.CommandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("Failed to record upload command buffer");
+
+    VkSubmitInfo submitInfo{
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch.CommandBuffer
+    };
+
+    vkResetFences(m_Context->GetLogicalDevice(), 1, &batch.Fence);
+    if (vkQueueSubmit(m_Context->GetGraphicsQueue(), 1, &submitInfo, batch.Fence) != VK_SUCCESS)
+        throw std::runtime_error("Failed to submit upload batch");
+
+    m_InFlight.push_back((uint32_t)m_Recording);
+    m_Recording = -1;
+    ++m_NextTicket;
+    ++m_SubmitCount;
+}
+
+bool UploadManager::IsComplete(UploadTicket ticket)
+{
+    if (ticket <= m_CompletedTicket)
+        return true;
+
+    RetireCompletedBatches(false);
+    return ticket <= m_CompletedTicket;
+}
+
+void UploadManager::Wait(UploadTicket ticket)
+{
+    if (m_Recording >= 0 && ticket >= m_Batches[m_Recording].Ticket)
+        Flush();
+
+    while (ticket > m_CompletedTicket && m_InFlight.empty() == false)
+        RetireCompletedBatches(true);
+}
+
+void UploadManager::WaitIdle()
+{
+    Flush();
+    while (m_InFlight.empty() == false)
+        RetireCompletedBatches(true);
+}
+
+void UploadManager::CreateBatches()
+{
+    VkDevice device = m_Context->GetLogicalDevice();
+
+    VkCommandPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = m_Context->GetQueueFamilies().GraphicsFamily.value()
+    };
+
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create upload command pool");
+
+    std::array<VkCommandBuffer, MaxBatchesInFlight + 1> commandBuffers{};
+    VkCommandBufferAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = m_CommandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = (uint32_t)commandBuffers.size()
+    };
+
+    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate upload command buffers");
+
+    VkFenceCreateInfo fenceInfo{
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO
+    };
+
+    for (uint32_t i = 0; i < m_Batches.size(); ++i)
+    {
+        m_Batches[i].CommandBuffer = commandBuffers[i];
+        if (vkCreateFence(device, &fenceInfo, nullptr, &m_Batches[i].Fence) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create upload fence");
+        m_FreeBatches.push_back(i);
+    }
+}
+
+UploadManager::Batch& UploadManager::GetRecordingBatch()
+{
+    if (m_Recording >= 0)
+        return m_Batches[m_Recording];
+
+    if (m_FreeBatches.empty())
+        RetireCompletedBatches(true);
+
+    m_Recording = (int32_t)m_FreeBatches.back();
+    m_FreeBatches.pop_back();
+
+    Batch& batch = m_Batches[m_Recording];
+    batch.Ticket = m_NextTicket;
+    batch.RingEnd = m_RingHead;
+
+    VkCommandBufferBeginInfo beginInfo{
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+    };
+
+    if (vkBeginCommandBuffer(batch.CommandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("Failed to begin upload command buffer");
+
+    return batch;
+}
+
+VkDeviceSize UploadManager::ReserveRingSpace(VkDeviceSize size)
+{
+    size = (size + 15) & ~VkDeviceSize(15);
+
+    for (;;)
+    {
+        uint64_t head = m_RingHead;
+        VkDeviceSize physicalHead = head % StagingRingSize;
+
+        // a copy source has to be contiguous, skip what is left before the wrap
+        if (physicalHead + size > StagingRingSize)
+            head += StagingRingSize - physicalHead;
+
+        if (head + size - m_RingTail <= StagingRingSize)
+        {
+            m_RingHead = head + size;
+            return head % StagingRingSize;
+        }
+
+        // The ring is full: whatever is recording has to go to the GPU before
+        // the oldest batch can be waited on and its space reused.
+        if (m_InFlight.empty())
+            Flush();
+        RetireCompletedBatches(true);
+    }
+}
+
+void UploadManager::RetireCompletedBatches(bool waitForOldest)
+{
+    VkDevice device = m_Context->GetLogicalDevice();
+
+    if (waitForOldest && m_InFlight.empty() == false)
+    {
+        VKBG_PROFILE_SCOPE("WaitForUploadFence");
+        vkWaitForFences(device, 1, &m_Batches[m_InFlight.front()].Fence, VK_TRUE, UINT64_MAX);
+    }
+
+    while (m_InFlight.empty() == false)
+    {
+        Batch& batch = m_Batches[m_InFlight.front()];
+        if (vkGetFenceStatus(device, batch.Fence) != VK_SUCCESS)
+            break;
+
+        m_RingTail = batch.RingEnd;
+        m_CompletedTicket = batch.Ticket;
+        m_FreeBatches.push_back(m_InFlight.front());
+        m_InFlight.erase(m_InFlight.begin());
+    }
+}
+}
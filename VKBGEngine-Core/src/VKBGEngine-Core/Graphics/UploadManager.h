@@ -0,0 +1,80 @@
+#pragma once
+
+namespace vkbg
+{
+// Identifies the batch an upload was recorded in. Tickets grow monotonically
+// and batches retire in submission order, so a ticket is complete once every
+// ticket before it is. 0 is always complete.
+using UploadTicket = uint64_t;
+
+// Accumulates buffer uploads into a persistently mapped staging ring and
+// records the copies into a shared command buffer. The batch is submitted with
+// a fence on Flush() (the renderer flushes before each frame submit) or when
+// the ring or batch runs out of room, so loading many meshes costs a few
+// submits instead of one vkQueueWaitIdle per buffer.
+//
+// Every batch ends with a memory barrier making the transfer writes visible to
+// vertex input and shader reads, so anything submitted afterwards on the
+// graphics queue can use the data without waiting on the CPU.
+class UploadManager
+{
+public:
+    static constexpr VkDeviceSize StagingRingSize = 32ull * 1024 * 1024;
+    static constexpr uint32_t MaxBatchesInFlight = 4;
+
+    UploadManager(class RenderContext* context);
+    ~UploadManager();
+
+    UploadManager(const UploadManager&) = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+
+    // Copies data into the staging ring and records a copy to dstBuffer. The
+    // data can be released as soon as this returns.
+    UploadTicket Upload(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+    // Submits the pending batch, if any. Doesn't wait.
+    void Flush();
+
+    bool IsComplete(UploadTicket ticket);
+    void Wait(UploadTicket ticket);
+    void WaitIdle();
+
+    uint32_t GetSubmitCount() const { return m_SubmitCount; }
+
+private:
+    struct Batch
+    {
+        VkCommandBuffer CommandBuffer{ VK_NULL_HANDLE };
+        VkFence Fence{ VK_NULL_HANDLE };
+        UploadTicket Ticket{ 0 };
+        // Virtual ring position right after the last byte used by this batch.
+        uint64_t RingEnd{ 0 };
+    };
+
+    void CreateBatches();
+    Batch& GetRecordingBatch();
+    VkDeviceSize ReserveRingSpace(VkDeviceSize size);
+    void RetireCompletedBatches(bool waitForOldest);
+
+private:
+    class RenderContext* m_Context;
+    VkCommandPool m_CommandPool{ VK_NULL_HANDLE };
+
+    std::unique_ptr<class Buffer> m_StagingRing;
+    uint8_t* m_StagingData{ nullptr };
+    // Virtual positions, they only grow. The physical offset is pos % size.
+    uint64_t m_RingHead{ 0 };
+    uint64_t m_RingTail{ 0 };
+
+    std::array<Batch, MaxBatchesInFlight + 1> m_Batches;
+    // Submitted batches, oldest first.
+    std::vector<uint32_t> m_InFlight;
+    std::vector<uint32_t> m_FreeBatches;
+    // Batch currently recording, or -1.
+    int32_t m_Recording{ -1 };
+
+    UploadTicket m_NextTicket{ 1 };
+    UploadTicket m_CompletedTicket{ 0 };
+    uint32_t m_SubmitCount{ 0 };
+};
+}
@@ -0,0 +1,87 @@
+#include "VertexLayout.h"
+#include "Model.h"
+
+namespace vkbg
+{
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex doesn't match the QuantizedColor layout");
+static_assert(offsetof(QuantizedVertex, Color) == 16, "The Quantized layout is QuantizedVertex without its color");
+
+uint32_t GetVertexSize(VertexLayout layout)
+{
+    switch (layout)
+    {
+    case VertexLayout::Float: return sizeof(Model::Vertex);
+    case VertexLayout::Quantized: return offsetof(QuantizedVertex, Color);
+    case VertexLayout::QuantizedColor: return sizeof(QuantizedVertex);
+    default: throw std::runtime_error("Unknown vertex layout");
+    }
+}
+
+std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(VertexLayout layout)
+{
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions{
+        {
+            .binding = 0,
+            .stride = GetVertexSize(layout),
+            .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+        }
+    };
+    return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(VertexLayout layout)
+{
+    if (layout == VertexLayout::Float)
+    {
+        return {
+            { .location = 0, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Model::Vertex, Position) },
+            { .location = 1, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Model::Vertex, Color) },
+            { .location = 2, .binding = 0, .format = VK_FORMAT_R32G32B32_SFLOAT, .offset = offsetof(Model::Vertex, Normal) },
+            { .location = 3, .binding = 0, .format = VK_FORMAT_R32G32_SFLOAT, .offset = offsetof(Model::Vertex, UV) }
+        };
+    }
+
+    // all of them mandatory vertex buffer formats, the shader ignores the position's w
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions{
+        { .location = 0, .binding = 0, .format = VK_FORMAT_R16G16B16A16_UNORM, .offset = offsetof(QuantizedVertex, Position) },
+        { .location = 2, .binding = 0, .format = VK_FORMAT_R16G16_SNORM, .offset = offsetof(QuantizedVertex, Normal) },
+        { .location = 3, .binding = 0, .format = VK_FORMAT_R16G16_SFLOAT, .offset = offsetof(QuantizedVertex, UV) }
+    };
+    if (layout == VertexLayout::QuantizedColor)
+        attributeDescriptions.push_back(
+            { .location = 1, .binding = 0, .format = VK_FORMAT_R8G8B8A8_UNORM, .offset = offsetof(QuantizedVertex, Color) });
+    return attributeDescriptions;
+}
+
+std::string GetVertexShaderPath(const std::string& shaderName, VertexLayout layout)
+{
+    // the variants BuildShaders.bat compiles
+    static constexpr const char* Suffixes[]{ "", "Quantized", "QuantizedColor" };
+    static_assert(std::size(Suffixes) == (size_t)VertexLayout::Count);
+    return "res/Shaders/Compiled/" + shaderName + Suffixes[(size_t)layout] + ".vert.spv";
+}
+
+glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+{
+    const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    // meshes without normals have zeros, anything decodes fine
+    if (length == 0.f)
+        return { 0.f, 0.f };
+    const glm::vec3 n = normal / length;
+    if (n.z >= 0.f)
+        return { n.x, n.y };
+    // the lower half folds over the diagonals
+    return {
+        (1.f - std::abs(n.y)) * (n.x >= 0.f ? 1.f : -1.f),
+        (1.f - std::abs(n.x)) * (n.y >= 0.f ? 1.f : -1.f) };
+}
+
+glm::vec3 DecodeOctahedral(const glm::vec2& encoded)
+{
+    glm::vec3 n{ encoded.x, encoded.y, 1.f - std::abs(encoded.x) - std::abs(encoded.y) };
+    const float t = std::max(-n.z, 0.f);
+    n.x += n.x >= 0.f ? -t : t;
+    n.y += n.y >= 0.f ? -t : t;
+    return glm::normalize(n);
+}
+}
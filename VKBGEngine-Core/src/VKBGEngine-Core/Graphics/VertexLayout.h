@@ -0,0 +1,42 @@
+#pragma once
+
+namespace vkbg
+{
+// How the vertices of a model are stored on the GPU, picked per model when it
+// is built. Each layout has its own vertex input state and vertex shader
+// variant (Simple.vert compiled with the defines of BuildShaders.bat), and the
+// geometry pool keeps the meshes of a layout in blocks of their own.
+enum class VertexLayout : uint8_t
+{
+    // Model::Vertex as is, 44 bytes
+    Float = 0,
+    // 16 bytes: positions as 16-bit unorms in the mesh's bounds, octahedral
+    // normals as two 16-bit snorms and half float UVs. The colors are white.
+    Quantized,
+    // Quantized with 8-bit unorm colors, 20 bytes
+    QuantizedColor,
+    Count
+};
+
+// The vertex of the quantized layouts, the Quantized one stops before Color.
+// Positions are quantized with the same scale on every axis, so that the
+// matrix mapping them back stays a similarity (see Model::GetVertexToWorld).
+struct QuantizedVertex
+{
+    std::array<uint16_t, 4> Position;
+    std::array<int16_t, 2> Normal;
+    std::array<uint16_t, 2> UV;
+    std::array<uint8_t, 4> Color;
+};
+
+uint32_t GetVertexSize(VertexLayout layout);
+std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(VertexLayout layout);
+std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(VertexLayout layout);
+// Path of the compiled vertex shader variant of shaderName for the layout.
+std::string GetVertexShaderPath(const std::string& shaderName, VertexLayout layout);
+
+// Octahedral mapping of a unit vector to [-1, 1]^2 (Meyer et al., "On Floating-
+// Point Normal Vectors"), decoded in Simple.vert.
+glm::vec2 EncodeOctahedral(const glm::vec3& normal);
+glm::vec3 DecodeOctahedral(const glm::vec2& encoded);
+}
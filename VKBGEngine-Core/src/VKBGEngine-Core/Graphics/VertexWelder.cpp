@@ -0,0 +1,80 @@
+#include "VertexWelder.h"
+#include "Helper.h"
+
+namespace vkbg
+{
+static constexpr uint32_t EmptySlot = ~0u;
+static constexpr size_t MinSlotCount = 64;
+
+// the table is grown past 3/4 full, linear probing degrades quickly after that
+static size_t GetSlotCount(size_t vertexCount)
+{
+    return std::bit_ceil(std::max(MinSlotCount, vertexCount + vertexCount / 3 + 1));
+}
+
+VertexWelder::VertexWelder(uint32_t vertexSize, size_t expectedIndexCount)
+    : m_VertexSize{ vertexSize }
+{
+    assert(vertexSize > 0 && "Vertices can't be empty");
+    Reserve(expectedIndexCount);
+}
+
+void VertexWelder::Reserve(size_t vertexCount)
+{
+    const size_t slotCount = GetSlotCount(vertexCount);
+    if (slotCount > m_Slots.size())
+        Rehash(slotCount);
+}
+
+void VertexWelder::Clear()
+{
+    m_VertexCount = 0;
+    m_ProbeCount = 0;
+    m_Vertices.clear();
+    std::fill(m_Slots.begin(), m_Slots.end(), Slot{ EmptySlot, 0 });
+}
+
+uint32_t VertexWelder::Weld(const void* vertex, uint64_t hash)
+{
+    if (GetSlotCount(m_VertexCount + 1) > m_Slots.size())
+        Rehash(m_Slots.size() * 2);
+
+    // the low bits pick the slot, the high ones tell vertices of a same cluster apart
+    const uint32_t hashTag = (uint32_t)(hash >> 32);
+    for (size_t slotIndex = hash & m_SlotMask;; slotIndex = (slotIndex + 1) & m_SlotMask)
+    {
+        ++m_ProbeCount;
+        Slot& slot = m_Slots[slotIndex];
+        if (slot.Index == EmptySlot)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(vertex);
+            m_Vertices.insert(m_Vertices.end(), bytes, bytes + m_VertexSize);
+            slot = { m_VertexCount, hashTag };
+            return m_VertexCount++;
+        }
+        if (slot.HashTag == hashTag && memcmp(&m_Vertices[(size_t)slot.Index * m_VertexSize], vertex, m_VertexSize) == 0)
+            return slot.Index;
+    }
+}
+
+uint64_t VertexWelder::Hash(const void* vertex) const
+{
+    return HashBytes(vertex, m_VertexSize);
+}
+
+void VertexWelder::Rehash(size_t slotCount)
+{
+    m_Slots.assign(slotCount, Slot{ EmptySlot, 0 });
+    m_SlotMask = slotCount - 1;
+
+    // the vertices are all distinct, they only need an empty slot
+    for (uint32_t index = 0; index < m_VertexCount; ++index)
+    {
+        const uint64_t hash = Hash(&m_Vertices[(size_t)index * m_VertexSize]);
+        size_t slotIndex = hash & m_SlotMask;
+        while (m_Slots[slotIndex].Index != EmptySlot)
+            slotIndex = (slotIndex + 1) & m_SlotMask;
+        m_Slots[slotIndex] = { index, (uint32_t)(hash >> 32) };
+    }
+}
+}
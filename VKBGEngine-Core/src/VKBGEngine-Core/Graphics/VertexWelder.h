@@ -0,0 +1,55 @@
+#pragma once
+
+namespace vkbg
+{
+// Deduplicates vertices of any layout by their raw bytes: Weld returns the
+// index of the vertex, appending it to the welded vertices the first time it is
+// seen. Two vertices are the same when their bytes are, so the layout must not
+// have padding (-0.f and 0.f are then different vertices, NaNs can be welded).
+//
+// Flat open-addressing table with linear probing: each slot keeps the vertex
+// index and the upper half of its HashBytes hash, so that a probe only compares
+// the vertex bytes when the hashes agree. Size it up front with the index count
+// of the mesh, an upper bound of its vertex count, and it never rehashes.
+class VertexWelder
+{
+public:
+    explicit VertexWelder(uint32_t vertexSize, size_t expectedIndexCount = 0);
+
+    // Makes room for vertexCount distinct vertices without rehashing.
+    void Reserve(size_t vertexCount);
+    // Forgets the vertices but keeps the memory.
+    void Clear();
+
+    uint32_t Weld(const void* vertex) { return Weld(vertex, Hash(vertex)); }
+    // Same as Weld(vertex) with hash = Hash(vertex), for callers that already
+    // hashed the vertex (to partition the vertices, for instance).
+    uint32_t Weld(const void* vertex, uint64_t hash);
+    uint64_t Hash(const void* vertex) const;
+
+    uint32_t GetVertexSize() const { return m_VertexSize; }
+    uint32_t GetVertexCount() const { return m_VertexCount; }
+    // The distinct vertices in the order they were first welded.
+    const uint8_t* GetVertices() const { return m_Vertices.data(); }
+    // Slots looked at by the Weld calls so far, one per call when every vertex
+    // lands in its home slot. Grows with the clusters of the linear probing.
+    uint64_t GetProbeCount() const { return m_ProbeCount; }
+
+private:
+    struct Slot
+    {
+        uint32_t Index;
+        uint32_t HashTag;
+    };
+
+    void Rehash(size_t slotCount);
+
+private:
+    uint32_t m_VertexSize;
+    uint32_t m_VertexCount{ 0 };
+    std::vector<uint8_t> m_Vertices;
+    std::vector<Slot> m_Slots;
+    size_t m_SlotMask{ 0 };
+    uint64_t m_ProbeCount{ 0 };
+};
+}
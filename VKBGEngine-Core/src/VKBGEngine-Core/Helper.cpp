@@ -1 +1,46 @@
 #include "Helper.h"
+
+namespace vkbg
+{
+static constexpr uint64_t HashPrime1 = 0x9E3779B185EBCA87ull;
+static constexpr uint64_t HashPrime2 = 0xC2B2AE3D27D4EB4Full;
+static constexpr uint64_t HashPrime3 = 0x165667B19E3779F9ull;
+
+static inline uint64_t HashRound(uint64_t hash, uint64_t word)
+{
+    word *= HashPrime2;
+    word = std::rotl(word, 31);
+    word *= HashPrime1;
+    hash ^= word;
+    return std::rotl(hash, 27) * HashPrime1 + HashPrime3;
+}
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = seed ^ (size * HashPrime1);
+
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash = HashRound(hash, word);
+    }
+
+    if (i < size)
+    {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, size - i);
+        hash = HashRound(hash, word);
+    }
+
+    // final avalanche so that nearby inputs don't produce nearby hashes
+    hash ^= hash >> 33;
+    hash *= HashPrime2;
+    hash ^= hash >> 29;
+    hash *= HashPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+}
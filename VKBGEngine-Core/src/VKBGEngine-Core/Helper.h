@@ -9,4 +9,8 @@ void HashCombine(std::size_t& seed, const T& v, const Rest&... rest)
     seed ^= std::hash<T>{}(v)+0x9e3779b9 + (seed << 6) + (seed >> 2);
     (HashCombine(seed, rest), ...);
 };
+
+// 64-bit hash over raw bytes, 8 bytes per step. Not cryptographic, only meant
+// to tell files and blobs apart quickly.
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
 }
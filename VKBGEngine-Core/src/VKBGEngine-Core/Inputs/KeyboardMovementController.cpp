@@ -1,9 +1,8 @@
 #include "KeyboardMovementController.h"
-#include "Entities/Entity.h"
 
 namespace vkbg
 {
-void KeyboardMovementController::MoveInPlaneXZ(GLFWwindow* window, float dt, Entity& entity)
+void KeyboardMovementController::MoveInPlaneXZ(GLFWwindow* window, float dt, glm::vec3& translation, glm::vec3& rotation)
 {
     glm::vec3 rotate{ 0 };
     if (glfwGetKey(window, Keys.LookRight) == GLFW_PRESS) 
@@ -17,16 +16,16 @@ void KeyboardMovementController::MoveInPlaneXZ(GLFWwindow* window, float dt, Ent
 
     if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon())
     {
-        entity.Transform.Rotation += LookSpeed * dt * glm::normalize(rotate);
+        rotation += LookSpeed * dt * glm::normalize(rotate);
     }
 
     // limit pitch values between about +/- 85ish degrees
-    float xRot = (float)entity.Transform.Rotation.x;
-    float yRot = (float)entity.Transform.Rotation.y;
-    entity.Transform.Rotation.x = glm::clamp(xRot, -1.5f, 1.5f);
-    entity.Transform.Rotation.y = glm::mod(yRot, glm::two_pi<float>());
+    float xRot = (float)rotation.x;
+    float yRot = (float)rotation.y;
+    rotation.x = glm::clamp(xRot, -1.5f, 1.5f);
+    rotation.y = glm::mod(yRot, glm::two_pi<float>());
 
-    float yaw = entity.Transform.Rotation.y;
+    float yaw = rotation.y;
     const glm::vec3 forwardDir{ sin(yaw), 0.f, cos(yaw) };
     const glm::vec3 rightDir{ forwardDir.z, 0.f, -forwardDir.x };
     const glm::vec3 upDir{ 0.f, -1.f, 0.f };
@@ -47,7 +46,7 @@ void KeyboardMovementController::MoveInPlaneXZ(GLFWwindow* window, float dt, Ent
 
     if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon())
     {
-        entity.Transform.Translation += MoveSpeed * dt * glm::normalize(moveDir);
+        translation += MoveSpeed * dt * glm::normalize(moveDir);
     }
 }
 }
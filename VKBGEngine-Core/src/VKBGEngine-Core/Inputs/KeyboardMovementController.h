@@ -19,7 +19,8 @@ public:
         int LookDown = GLFW_KEY_DOWN;
     };
 
-    void MoveInPlaneXZ(GLFWwindow* window, float dt, class Entity& entity);
+    // Works on any position/orientation pair: a TransformComponent or a Scene entity's components.
+    void MoveInPlaneXZ(GLFWwindow* window, float dt, glm::vec3& translation, glm::vec3& rotation);
 
     KeyMappings Keys{};
     float MoveSpeed{ 3.f };
@@ -0,0 +1,39 @@
+#include "Simd.h"
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace vkbg::simd
+{
+bool HasAvx2()
+{
+#if defined(VKBG_SIMD_AVX)
+    static const bool hasAvx2 = []
+    {
+    #if defined(_MSC_VER)
+        int info[4]{};
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        const bool fma = (info[2] & (1 << 12)) != 0;
+        // the OS has to save the YMM registers on context switches
+        if (!osxsave || !avx || !fma || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    #else
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    #endif
+    }();
+    return hasAvx2;
+#else
+    return false;
+#endif
+}
+}
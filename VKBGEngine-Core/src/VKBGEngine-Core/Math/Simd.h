@@ -0,0 +1,24 @@
+#pragma once
+
+// SIMD support. SSE is part of every x64 target so it is picked at compile
+// time; AVX2 code is compiled in a function with its own target attribute and
+// only called when the CPU reports it (see HasAvx2), so the binary still runs
+// on machines without it.
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+    #define VKBG_SIMD_SSE 1
+    #define VKBG_SIMD_AVX 1
+    #include <immintrin.h>
+#endif
+
+#if defined(VKBG_SIMD_AVX) && defined(_MSC_VER) && !defined(__clang__)
+    // MSVC emits AVX intrinsics without any /arch switch
+    #define VKBG_TARGET_AVX2
+#elif defined(VKBG_SIMD_AVX)
+    #define VKBG_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+namespace vkbg::simd
+{
+// True when the CPU and the OS support AVX2 + FMA. Cached after the first call.
+bool HasAvx2();
+}
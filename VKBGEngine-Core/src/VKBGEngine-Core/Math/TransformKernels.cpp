@@ -0,0 +1,275 @@
+#include "TransformKernels.h"
+#include "Entities/Entity.h"
+
+namespace vkbg
+{
+// Cody-Waite split of pi/2: the first two parts have few enough bits that
+// q * part is exact for |q| < 2^16, i.e. angles up to ~1e5 radians.
+static constexpr float TwoOverPi = 0.636619772367581343f;
+static constexpr float PiOverTwo1 = 1.5703125f;
+static constexpr float PiOverTwo2 = 4.837512969970703125e-4f;
+static constexpr float PiOverTwo3 = 7.54978995489188216e-8f;
+// cephes sinf/cosf minimax polynomials on [-pi/4, pi/4]
+static constexpr float SinC1 = -1.6666654611e-1f;
+static constexpr float SinC2 = 8.3321608736e-3f;
+static constexpr float SinC3 = -1.9515295891e-4f;
+static constexpr float CosC1 = 4.166664568298827e-2f;
+static constexpr float CosC2 = -1.388731625493765e-3f;
+static constexpr float CosC3 = 2.443315711809948e-5f;
+
+static uint32_t GetEntryIndex(const TransformBatch& batch, uint32_t entry)
+{
+    return batch.Indices ? batch.Indices[entry] : entry;
+}
+
+static void ComputeTransformsTail(const TransformBatch& batch, uint32_t first)
+{
+    for (uint32_t entry = first; entry < batch.Count; ++entry)
+    {
+        const uint32_t i = GetEntryIndex(batch, entry);
+        batch.WorldMatrices[i] = TransformComponent::ComputeTransform(batch.Translations[i], batch.Rotations[i], batch.Scales[i]);
+        batch.NormalMatrices[i] = glm::mat4{ TransformComponent::ComputeNormalMatrix(batch.Rotations[i], batch.Scales[i]) };
+    }
+}
+
+void ComputeTransforms(const TransformBatch& batch)
+{
+#if defined(VKBG_SIMD_AVX)
+    if (simd::HasAvx2())
+        return ComputeTransformsAvx2(batch);
+#endif
+#if defined(VKBG_SIMD_SSE)
+    ComputeTransformsSse(batch);
+#else
+    ComputeTransformsScalar(batch);
+#endif
+}
+
+void ComputeTransformsScalar(const TransformBatch& batch)
+{
+    ComputeTransformsTail(batch, 0);
+}
+
+#if defined(VKBG_SIMD_SSE)
+static __m128 LoadLanes(const glm::vec3* values, const uint32_t* indices, int component)
+{
+    return _mm_setr_ps(
+        values[indices[0]][component], values[indices[1]][component],
+        values[indices[2]][component], values[indices[3]][component]);
+}
+
+// Transposes one matrix column held across the 4 lanes and stores it in the
+// matrices of the 4 entities.
+static void StoreColumn(glm::mat4* matrices, const uint32_t* indices, int column, __m128 x, __m128 y, __m128 z, __m128 w)
+{
+    _MM_TRANSPOSE4_PS(x, y, z, w);
+    _mm_storeu_ps(&matrices[indices[0]][column][0], x);
+    _mm_storeu_ps(&matrices[indices[1]][column][0], y);
+    _mm_storeu_ps(&matrices[indices[2]][column][0], z);
+    _mm_storeu_ps(&matrices[indices[3]][column][0], w);
+}
+
+// Reduces x to r in [-pi/4, pi/4] around the nearest multiple q of pi/2, then
+// picks and negates the polynomials of r depending on the quadrant (q mod 4).
+static void SinCosSse(__m128 x, __m128& outSin, __m128& outCos)
+{
+    const __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TwoOverPi)));
+    const __m128 q = _mm_cvtepi32_ps(quadrant);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(PiOverTwo1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PiOverTwo2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(q, _mm_set1_ps(PiOverTwo3)));
+    const __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 s = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SinC3), r2), _mm_set1_ps(SinC2));
+    s = _mm_add_ps(_mm_mul_ps(s, r2), _mm_set1_ps(SinC1));
+    s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, r2), r), r);
+
+    __m128 c = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(CosC3), r2), _mm_set1_ps(CosC2));
+    c = _mm_add_ps(_mm_mul_ps(c, r2), _mm_set1_ps(CosC1));
+    c = _mm_mul_ps(_mm_mul_ps(c, r2), r2);
+    c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.f), _mm_mul_ps(r2, _mm_set1_ps(.5f))), c);
+
+    // odd quadrants swap sin and cos, sin is negated in quadrants 2 and 3, cos in 1 and 2
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+    const __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+    const __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+
+    outSin = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+    outCos = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+}
+
+void ComputeTransformsSse(const TransformBatch& batch)
+{
+    const uint32_t simdCount = batch.Count & ~3u;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+
+    uint32_t indices[4];
+    for (uint32_t entry = 0; entry < simdCount; entry += 4)
+    {
+        for (uint32_t lane = 0; lane < 4; ++lane)
+            indices[lane] = GetEntryIndex(batch, entry + lane);
+
+        __m128 s1, c1, s2, c2, s3, c3;
+        SinCosSse(LoadLanes(batch.Rotations, indices, 1), s1, c1);
+        SinCosSse(LoadLanes(batch.Rotations, indices, 0), s2, c2);
+        SinCosSse(LoadLanes(batch.Rotations, indices, 2), s3, c3);
+
+        // rotation part, same terms as TransformComponent::ComputeTransform
+        const __m128 s1s2 = _mm_mul_ps(s1, s2);
+        const __m128 c1s2 = _mm_mul_ps(c1, s2);
+        const __m128 r00 = _mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1s2, s3));
+        const __m128 r01 = _mm_mul_ps(c2, s3);
+        const __m128 r02 = _mm_sub_ps(_mm_mul_ps(c1s2, s3), _mm_mul_ps(c3, s1));
+        const __m128 r10 = _mm_sub_ps(_mm_mul_ps(c3, s1s2), _mm_mul_ps(c1, s3));
+        const __m128 r11 = _mm_mul_ps(c2, c3);
+        const __m128 r12 = _mm_add_ps(_mm_mul_ps(c1s2, c3), _mm_mul_ps(s1, s3));
+        const __m128 r20 = _mm_mul_ps(c2, s1);
+        const __m128 r21 = _mm_sub_ps(zero, s2);
+        const __m128 r22 = _mm_mul_ps(c1, c2);
+
+        const __m128 sx = LoadLanes(batch.Scales, indices, 0);
+        const __m128 sy = LoadLanes(batch.Scales, indices, 1);
+        const __m128 sz = LoadLanes(batch.Scales, indices, 2);
+        StoreColumn(batch.WorldMatrices, indices, 0, _mm_mul_ps(r00, sx), _mm_mul_ps(r01, sx), _mm_mul_ps(r02, sx), zero);
+        StoreColumn(batch.WorldMatrices, indices, 1, _mm_mul_ps(r10, sy), _mm_mul_ps(r11, sy), _mm_mul_ps(r12, sy), zero);
+        StoreColumn(batch.WorldMatrices, indices, 2, _mm_mul_ps(r20, sz), _mm_mul_ps(r21, sz), _mm_mul_ps(r22, sz), zero);
+        StoreColumn(batch.WorldMatrices, indices, 3,
+            LoadLanes(batch.Translations, indices, 0),
+            LoadLanes(batch.Translations, indices, 1),
+            LoadLanes(batch.Translations, indices, 2),
+            one);
+
+        const __m128 ix = _mm_div_ps(one, sx);
+        const __m128 iy = _mm_div_ps(one, sy);
+        const __m128 iz = _mm_div_ps(one, sz);
+        StoreColumn(batch.NormalMatrices, indices, 0, _mm_mul_ps(r00, ix), _mm_mul_ps(r01, ix), _mm_mul_ps(r02, ix), zero);
+        StoreColumn(batch.NormalMatrices, indices, 1, _mm_mul_ps(r10, iy), _mm_mul_ps(r11, iy), _mm_mul_ps(r12, iy), zero);
+        StoreColumn(batch.NormalMatrices, indices, 2, _mm_mul_ps(r20, iz), _mm_mul_ps(r21, iz), _mm_mul_ps(r22, iz), zero);
+        StoreColumn(batch.NormalMatrices, indices, 3, zero, zero, zero, one);
+    }
+
+    ComputeTransformsTail(batch, simdCount);
+}
+#endif
+
+#if defined(VKBG_SIMD_AVX)
+VKBG_TARGET_AVX2
+static __m256 LoadLanesAvx2(const glm::vec3* values, const uint32_t* indices, int component)
+{
+    return _mm256_setr_ps(
+        values[indices[0]][component], values[indices[1]][component],
+        values[indices[2]][component], values[indices[3]][component],
+        values[indices[4]][component], values[indices[5]][component],
+        values[indices[6]][component], values[indices[7]][component]);
+}
+
+// Transposes within each 128 bit half, so entity n and n + 4 share a register.
+// Calling the SSE StoreColumn instead would mix legacy SSE and AVX code, which
+// stalls on every transition.
+VKBG_TARGET_AVX2
+static void StoreColumnAvx2(glm::mat4* matrices, const uint32_t* indices, int column, __m256 x, __m256 y, __m256 z, __m256 w)
+{
+    const __m256 xy0 = _mm256_unpacklo_ps(x, y);
+    const __m256 xy1 = _mm256_unpackhi_ps(x, y);
+    const __m256 zw0 = _mm256_unpacklo_ps(z, w);
+    const __m256 zw1 = _mm256_unpackhi_ps(z, w);
+    const __m256 columns[4]{
+        _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(xy0, zw0, _MM_SHUFFLE(3, 2, 3, 2)),
+        _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(xy1, zw1, _MM_SHUFFLE(3, 2, 3, 2)),
+    };
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        _mm_storeu_ps(&matrices[indices[lane]][column][0], _mm256_castps256_ps128(columns[lane]));
+        _mm_storeu_ps(&matrices[indices[lane + 4]][column][0], _mm256_extractf128_ps(columns[lane], 1));
+    }
+}
+
+// Same as SinCosSse, 8 lanes and with FMA.
+VKBG_TARGET_AVX2
+static void SinCosAvx2(__m256 x, __m256& outSin, __m256& outCos)
+{
+    const __m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TwoOverPi)));
+    const __m256 q = _mm256_cvtepi32_ps(quadrant);
+    __m256 r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PiOverTwo1), x);
+    r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PiOverTwo2), r);
+    r = _mm256_fnmadd_ps(q, _mm256_set1_ps(PiOverTwo3), r);
+    const __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 s = _mm256_fmadd_ps(_mm256_set1_ps(SinC3), r2, _mm256_set1_ps(SinC2));
+    s = _mm256_fmadd_ps(s, r2, _mm256_set1_ps(SinC1));
+    s = _mm256_fmadd_ps(_mm256_mul_ps(s, r2), r, r);
+
+    __m256 c = _mm256_fmadd_ps(_mm256_set1_ps(CosC3), r2, _mm256_set1_ps(CosC2));
+    c = _mm256_fmadd_ps(c, r2, _mm256_set1_ps(CosC1));
+    c = _mm256_fmadd_ps(_mm256_mul_ps(c, r2), r2, _mm256_fnmadd_ps(r2, _mm256_set1_ps(.5f), _mm256_set1_ps(1.f)));
+
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, one), one));
+    const __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, two), 30));
+    const __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, one), two), 30));
+
+    outSin = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sinSign);
+    outCos = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosSign);
+}
+
+VKBG_TARGET_AVX2
+void ComputeTransformsAvx2(const TransformBatch& batch)
+{
+    const uint32_t simdCount = batch.Count & ~7u;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.f);
+
+    uint32_t indices[8];
+    for (uint32_t entry = 0; entry < simdCount; entry += 8)
+    {
+        for (uint32_t lane = 0; lane < 8; ++lane)
+            indices[lane] = GetEntryIndex(batch, entry + lane);
+
+        __m256 s1, c1, s2, c2, s3, c3;
+        SinCosAvx2(LoadLanesAvx2(batch.Rotations, indices, 1), s1, c1);
+        SinCosAvx2(LoadLanesAvx2(batch.Rotations, indices, 0), s2, c2);
+        SinCosAvx2(LoadLanesAvx2(batch.Rotations, indices, 2), s3, c3);
+
+        const __m256 s1s2 = _mm256_mul_ps(s1, s2);
+        const __m256 c1s2 = _mm256_mul_ps(c1, s2);
+        const __m256 r00 = _mm256_fmadd_ps(s1s2, s3, _mm256_mul_ps(c1, c3));
+        const __m256 r01 = _mm256_mul_ps(c2, s3);
+        const __m256 r02 = _mm256_fmsub_ps(c1s2, s3, _mm256_mul_ps(c3, s1));
+        const __m256 r10 = _mm256_fmsub_ps(c3, s1s2, _mm256_mul_ps(c1, s3));
+        const __m256 r11 = _mm256_mul_ps(c2, c3);
+        const __m256 r12 = _mm256_fmadd_ps(c1s2, c3, _mm256_mul_ps(s1, s3));
+        const __m256 r20 = _mm256_mul_ps(c2, s1);
+        const __m256 r21 = _mm256_sub_ps(zero, s2);
+        const __m256 r22 = _mm256_mul_ps(c1, c2);
+
+        const __m256 sx = LoadLanesAvx2(batch.Scales, indices, 0);
+        const __m256 sy = LoadLanesAvx2(batch.Scales, indices, 1);
+        const __m256 sz = LoadLanesAvx2(batch.Scales, indices, 2);
+        StoreColumnAvx2(batch.WorldMatrices, indices, 0, _mm256_mul_ps(r00, sx), _mm256_mul_ps(r01, sx), _mm256_mul_ps(r02, sx), zero);
+        StoreColumnAvx2(batch.WorldMatrices, indices, 1, _mm256_mul_ps(r10, sy), _mm256_mul_ps(r11, sy), _mm256_mul_ps(r12, sy), zero);
+        StoreColumnAvx2(batch.WorldMatrices, indices, 2, _mm256_mul_ps(r20, sz), _mm256_mul_ps(r21, sz), _mm256_mul_ps(r22, sz), zero);
+        StoreColumnAvx2(batch.WorldMatrices, indices, 3,
+            LoadLanesAvx2(batch.Translations, indices, 0),
+            LoadLanesAvx2(batch.Translations, indices, 1),
+            LoadLanesAvx2(batch.Translations, indices, 2),
+            one);
+
+        const __m256 ix = _mm256_div_ps(one, sx);
+        const __m256 iy = _mm256_div_ps(one, sy);
+        const __m256 iz = _mm256_div_ps(one, sz);
+        StoreColumnAvx2(batch.NormalMatrices, indices, 0, _mm256_mul_ps(r00, ix), _mm256_mul_ps(r01, ix), _mm256_mul_ps(r02, ix), zero);
+        StoreColumnAvx2(batch.NormalMatrices, indices, 1, _mm256_mul_ps(r10, iy), _mm256_mul_ps(r11, iy), _mm256_mul_ps(r12, iy), zero);
+        StoreColumnAvx2(batch.NormalMatrices, indices, 2, _mm256_mul_ps(r20, iz), _mm256_mul_ps(r21, iz), _mm256_mul_ps(r22, iz), zero);
+        StoreColumnAvx2(batch.NormalMatrices, indices, 3, zero, zero, zero, one);
+    }
+
+    ComputeTransformsTail(batch, simdCount);
+}
+#endif
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Math/Simd.h"
+
+namespace vkbg
+{
+// Input and output arrays of a batch of transforms, as stored by Scene. Entry i
+// of the batch is element Indices[i] of every array, or element i when there is
+// no index list.
+struct TransformBatch
+{
+    const glm::vec3* Translations{ nullptr };
+    const glm::vec3* Rotations{ nullptr };
+    const glm::vec3* Scales{ nullptr };
+    glm::mat4* WorldMatrices{ nullptr };
+    // the normal matrix in the upper 3x3, identity elsewhere
+    glm::mat4* NormalMatrices{ nullptr };
+    const uint32_t* Indices{ nullptr };
+    uint32_t Count{ 0 };
+};
+
+// Batch versions of TransformComponent::ComputeTransform/ComputeNormalMatrix
+// (Tait-Bryan YXZ), computing 4 (SSE) or 8 (AVX2) entities at a time with a
+// polynomial sin/cos. The SIMD kernels match the scalar one within 1e-5 per
+// matrix element for angles up to 1e4 radians and unit-ish scales (the error
+// is relative to the scale).
+// ComputeTransforms dispatches to the widest kernel the CPU supports.
+void ComputeTransforms(const TransformBatch& batch);
+void ComputeTransformsScalar(const TransformBatch& batch);
+#if defined(VKBG_SIMD_SSE)
+void ComputeTransformsSse(const TransformBatch& batch);
+#endif
+#if defined(VKBG_SIMD_AVX)
+void ComputeTransformsAvx2(const TransformBatch& batch);
+#endif
+}
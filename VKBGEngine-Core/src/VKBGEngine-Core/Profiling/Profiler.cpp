@@ -0,0 +1,180 @@
+#include "Profiler.h"
+
+namespace vkbg
+{
+namespace
+{
+struct Event
+{
+    const char* Name;
+    // nanoseconds since the start of the session
+    int64_t Start;
+    int64_t Duration;
+};
+
+constexpr uint32_t ChunkSize = 4096;
+struct EventChunk
+{
+    std::array<Event, ChunkSize> Events;
+};
+
+// Only the owning thread writes events. Chunks never move once allocated, so
+// the writer touches the mutex only when it needs a new chunk; readers take it
+// to walk the chunk list and read up to Count.
+struct ThreadBuffer
+{
+    uint32_t ThreadId{ 0 };
+    std::string Name;
+    std::mutex Mutex;
+    std::vector<std::unique_ptr<EventChunk>> Chunks;
+    std::atomic<uint32_t> Count{ 0 };
+};
+
+struct Registry
+{
+    std::mutex Mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+    std::atomic<bool> Recording{ false };
+    Profiler::Clock::time_point Epoch{};
+};
+
+Registry& GetRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+ThreadBuffer& GetThreadBuffer()
+{
+    // buffers belong to the registry so their events outlive the thread
+    thread_local ThreadBuffer* buffer = []
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard lock{ registry.Mutex };
+        auto& newBuffer = registry.Buffers.emplace_back(std::make_unique<ThreadBuffer>());
+        newBuffer->ThreadId = (uint32_t)registry.Buffers.size();
+        newBuffer->Name = "Thread " + std::to_string(newBuffer->ThreadId);
+        return newBuffer.get();
+    }();
+    return *buffer;
+}
+
+void WriteJsonString(std::ostream& out, std::string_view text)
+{
+    out << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            out << ' ';
+        else
+            out << c;
+    }
+    out << '"';
+}
+}
+
+void Profiler::BeginSession()
+{
+    Registry& registry = GetRegistry();
+    std::lock_guard lock{ registry.Mutex };
+
+    for (auto& buffer : registry.Buffers)
+    {
+        std::lock_guard bufferLock{ buffer->Mutex };
+        buffer->Count.store(0, std::memory_order_relaxed);
+    }
+
+    registry.Epoch = Clock::now();
+    registry.Recording.store(true, std::memory_order_release);
+}
+
+bool Profiler::EndSession(const std::string& outputPath)
+{
+    Registry& registry = GetRegistry();
+    registry.Recording.store(false, std::memory_order_release);
+
+    std::ofstream file(outputPath, std::ios::trunc);
+    if (!file.is_open())
+        return false;
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    bool first = true;
+    auto separator = [&]() -> std::ostream&
+    {
+        if (!first)
+            file << ",\n";
+        first = false;
+        return file;
+    };
+
+    std::lock_guard lock{ registry.Mutex };
+    size_t eventCount = 0;
+    for (auto& buffer : registry.Buffers)
+    {
+        std::lock_guard bufferLock{ buffer->Mutex };
+
+        separator() << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->ThreadId << ",\"args\":{\"name\":";
+        WriteJsonString(file, buffer->Name);
+        file << "}}";
+
+        uint32_t count = buffer->Count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const Event& event = buffer->Chunks[i / ChunkSize]->Events[i % ChunkSize];
+            separator() << "{\"ph\":\"X\",\"cat\":\"vkbg\",\"name\":";
+            WriteJsonString(file, event.Name);
+            // trace-event timestamps are in microseconds
+            file << ",\"pid\":1,\"tid\":" << buffer->ThreadId
+                << ",\"ts\":" << event.Start / 1000.0
+                << ",\"dur\":" << event.Duration / 1000.0 << '}';
+        }
+        eventCount += count;
+    }
+    file << "\n]}\n";
+
+    LOG("Profiler: wrote " << eventCount << " events to " << outputPath << '\n');
+    return file.good();
+}
+
+bool Profiler::IsRecording()
+{
+    return GetRegistry().Recording.load(std::memory_order_relaxed);
+}
+
+void Profiler::RecordEvent(const char* name, Clock::time_point start, Clock::time_point end)
+{
+    Registry& registry = GetRegistry();
+    if (!registry.Recording.load(std::memory_order_acquire))
+        return;
+
+    ThreadBuffer& buffer = GetThreadBuffer();
+    uint32_t index = buffer.Count.load(std::memory_order_relaxed);
+    if (index >= MaxEventsPerThread)
+        return;
+
+    uint32_t chunk = index / ChunkSize;
+    if (chunk == buffer.Chunks.size())
+    {
+        std::lock_guard lock{ buffer.Mutex };
+        buffer.Chunks.push_back(std::make_unique<EventChunk>());
+    }
+
+    buffer.Chunks[chunk]->Events[index % ChunkSize] = Event{
+        .Name = name,
+        .Start = std::chrono::duration_cast<std::chrono::nanoseconds>(start - registry.Epoch).count(),
+        .Duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()
+    };
+    buffer.Count.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+    ThreadBuffer& buffer = GetThreadBuffer();
+    std::lock_guard lock{ buffer.Mutex };
+    buffer.Name = name;
+}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+namespace vkbg
+{
+// CPU instrumentation. Scopes append complete events to a buffer owned by the
+// calling thread (no lock on the hot path), and EndSession writes every
+// thread's events as Chrome trace-event JSON, which chrome://tracing and
+// Perfetto can open.
+//
+// Use the VKBG_PROFILE_* macros rather than the class directly: they compile to
+// nothing unless VKBG_PROFILE is defined (Debug and Release, not Dist).
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Events past this count are dropped for the thread, so a long session
+    // can't eat all the memory.
+    static constexpr uint32_t MaxEventsPerThread = 1u << 20;
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name)
+            : m_Name{ name }, m_Start{ IsRecording() ? Clock::now() : Clock::time_point{} } {}
+        ~Scope()
+        {
+            if (m_Start != Clock::time_point{})
+                RecordEvent(m_Name, m_Start, Clock::now());
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* m_Name;
+        Clock::time_point m_Start;
+    };
+
+public:
+    static void BeginSession();
+    // Stops recording and writes the trace. Other threads should be idle.
+    static bool EndSession(const std::string& outputPath);
+    static bool IsRecording();
+
+    // name must outlive the session (string literals, __FUNCTION__...).
+    static void RecordEvent(const char* name, Clock::time_point start, Clock::time_point end);
+    static void SetThreadName(const std::string& name);
+};
+}
+
+#if defined(VKBG_PROFILE)
+    #define VKBG_PROFILE_CONCAT_IMPL(a, b) a##b
+    #define VKBG_PROFILE_CONCAT(a, b) VKBG_PROFILE_CONCAT_IMPL(a, b)
+    #define VKBG_PROFILE_SCOPE(name) ::vkbg::Profiler::Scope VKBG_PROFILE_CONCAT(profileScope, __LINE__){ name }
+    #define VKBG_PROFILE_FUNCTION() VKBG_PROFILE_SCOPE(__FUNCTION__)
+    #define VKBG_PROFILE_THREAD(name) ::vkbg::Profiler::SetThreadName(name)
+    #define VKBG_PROFILE_BEGIN_SESSION() ::vkbg::Profiler::BeginSession()
+    #define VKBG_PROFILE_END_SESSION(path) ::vkbg::Profiler::EndSession(path)
+#else
+    #define VKBG_PROFILE_SCOPE(name)
+    #define VKBG_PROFILE_FUNCTION()
+    #define VKBG_PROFILE_THREAD(name)
+    #define VKBG_PROFILE_BEGIN_SESSION()
+    #define VKBG_PROFILE_END_SESSION(path)
+#endif
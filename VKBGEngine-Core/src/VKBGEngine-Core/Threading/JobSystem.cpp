@@ -0,0 +1,207 @@
+#include "JobSystem.h"
+#include "Profiling/Profiler.h"
+
+namespace vkbg
+{
+// Workers look for jobs this many times before going to sleep, jobs usually
+// come in bursts and waking up a thread takes a few microseconds.
+static constexpr uint32_t IdleSpinCount = 64;
+// ParallelFor makes a few ranges per thread so that stealing evens out ranges
+// that take longer than others.
+static constexpr uint32_t RangesPerThread = 4;
+
+struct WorkerContext
+{
+    const JobSystem* Owner{ nullptr };
+    uint32_t QueueIndex{ 0 };
+};
+static thread_local WorkerContext t_WorkerContext{};
+
+uint32_t JobSystem::GetDefaultWorkerCount()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u) - 1;
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+    m_Queues.resize(workerCount + 1);
+    for (auto& queue : m_Queues)
+        queue = std::make_unique<WorkQueue>();
+
+    m_Workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i)
+        m_Workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard lock{ m_WakeMutex };
+        m_Stopping = true;
+    }
+    m_WakeCondition.notify_all();
+
+    for (auto& worker : m_Workers)
+        worker.join();
+}
+
+void JobSystem::Run(Job job, JobCounter& counter)
+{
+    counter.m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+    WorkQueue& queue = *m_Queues[GetQueueIndex()];
+    {
+        std::lock_guard lock{ queue.Mutex };
+        queue.Jobs.push_back({ std::move(job), &counter });
+    }
+
+    // a sleeping worker either sees the new count before it waits, or is
+    // counted as sleeping here (both sides are sequentially consistent)
+    m_QueuedJobCount.fetch_add(1);
+    if (m_SleepingWorkerCount.load() > 0)
+    {
+        { std::lock_guard lock{ m_WakeMutex }; }
+        m_WakeCondition.notify_one();
+    }
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    const uint32_t queueIndex = GetQueueIndex();
+    while (counter.IsDone() == false)
+    {
+        if (TryRunJob(queueIndex) == false)
+            std::this_thread::yield();
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard lock{ counter.m_ErrorMutex };
+        error = std::exchange(counter.m_Error, nullptr);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t minRangeSize, const RangeJob& job)
+{
+    if (count == 0)
+        return;
+
+    const uint32_t targetRangeCount = GetThreadCount() * RangesPerThread;
+    const uint32_t rangeSize = std::max({ minRangeSize, (count + targetRangeCount - 1) / targetRangeCount, 1u });
+    if (rangeSize >= count)
+    {
+        job(0, count);
+        return;
+    }
+
+    JobCounter counter{};
+    for (uint32_t first = rangeSize; first < count; first += rangeSize)
+    {
+        const uint32_t last = std::min(first + rangeSize, count);
+        Run([&job, first, last] { job(first, last); }, counter);
+    }
+
+    // the first range runs here, the jobs reference job so they have to be
+    // done before leaving, even if it throws
+    try
+    {
+        job(0, rangeSize);
+    }
+    catch (...)
+    {
+        while (counter.IsDone() == false)
+        {
+            if (TryRunJob(GetQueueIndex()) == false)
+                std::this_thread::yield();
+        }
+        throw;
+    }
+    Wait(counter);
+}
+
+void JobSystem::WorkerLoop(uint32_t queueIndex)
+{
+    t_WorkerContext = { this, queueIndex };
+    VKBG_PROFILE_THREAD("Worker " + std::to_string(queueIndex));
+
+    while (m_Stopping.load(std::memory_order_relaxed) == false)
+    {
+        bool ranJob = false;
+        for (uint32_t spin = 0; spin < IdleSpinCount && ranJob == false; ++spin)
+        {
+            ranJob = TryRunJob(queueIndex);
+            if (ranJob == false)
+                std::this_thread::yield();
+        }
+        if (ranJob)
+            continue;
+
+        std::unique_lock lock{ m_WakeMutex };
+        m_SleepingWorkerCount.fetch_add(1);
+        m_WakeCondition.wait(lock, [this] { return m_QueuedJobCount.load() > 0 || m_Stopping.load(); });
+        m_SleepingWorkerCount.fetch_sub(1);
+    }
+}
+
+bool JobSystem::TryRunJob(uint32_t queueIndex)
+{
+    QueuedJob job{};
+    if (PopJob(queueIndex, job) == false && StealJob(queueIndex, job) == false)
+        return false;
+
+    m_QueuedJobCount.fetch_sub(1);
+    Execute(job);
+    return true;
+}
+
+bool JobSystem::PopJob(uint32_t queueIndex, QueuedJob& job)
+{
+    WorkQueue& queue = *m_Queues[queueIndex];
+    std::lock_guard lock{ queue.Mutex };
+    if (queue.Jobs.empty())
+        return false;
+
+    job = std::move(queue.Jobs.back());
+    queue.Jobs.pop_back();
+    return true;
+}
+
+bool JobSystem::StealJob(uint32_t thiefIndex, QueuedJob& job)
+{
+    const uint32_t queueCount = (uint32_t)m_Queues.size();
+    for (uint32_t offset = 1; offset < queueCount; ++offset)
+    {
+        WorkQueue& queue = *m_Queues[(thiefIndex + offset) % queueCount];
+        std::lock_guard lock{ queue.Mutex };
+        if (queue.Jobs.empty())
+            continue;
+
+        job = std::move(queue.Jobs.front());
+        queue.Jobs.pop_front();
+        return true;
+    }
+    return false;
+}
+
+uint32_t JobSystem::GetQueueIndex() const
+{
+    return t_WorkerContext.Owner == this ? t_WorkerContext.QueueIndex : 0;
+}
+
+void JobSystem::Execute(QueuedJob& job)
+{
+    try
+    {
+        job.Function();
+    }
+    catch (...)
+    {
+        std::lock_guard lock{ job.Counter->m_ErrorMutex };
+        if (job.Counter->m_Error == nullptr)
+            job.Counter->m_Error = std::current_exception();
+    }
+    job.Counter->m_Pending.fetch_sub(1, std::memory_order_release);
+}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+namespace vkbg
+{
+// Counts the unfinished jobs of a group, pass it to JobSystem::Run and wait on
+// it with JobSystem::Wait. The first exception thrown by a job of the group is
+// kept and rethrown by Wait.
+class JobCounter
+{
+public:
+    bool IsDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<uint32_t> m_Pending{ 0 };
+    std::mutex m_ErrorMutex;
+    std::exception_ptr m_Error;
+};
+
+// Work-stealing scheduler. Each worker thread has its own deque: it runs its
+// newest job first (the likeliest to still be in cache) and, once the deque is
+// empty, steals the oldest job of another one. Threads that aren't workers
+// share one extra deque.
+//
+// Wait doesn't block: the waiting thread runs queued jobs until the counter
+// reaches zero, so jobs can start jobs and wait on them.
+class JobSystem
+{
+public:
+    using Job = std::function<void()>;
+    // called with a [first, last) part of the iteration space
+    using RangeJob = std::function<void(uint32_t first, uint32_t last)>;
+
+    // Below this many elements per range, handing the work to other threads
+    // costs more than it saves. The default for the per-entity loops.
+    static constexpr uint32_t MinRangeSize = 4096;
+
+    // One worker per hardware thread, but the one running the frame.
+    static uint32_t GetDefaultWorkerCount();
+
+    explicit JobSystem(uint32_t workerCount = GetDefaultWorkerCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void Run(Job job, JobCounter& counter);
+    void Wait(JobCounter& counter);
+
+    // Runs job over [0, count) split in ranges of at least minRangeSize, the
+    // calling thread taking part, and returns once all of them are done.
+    void ParallelFor(uint32_t count, uint32_t minRangeSize, const RangeJob& job);
+
+    // worker threads plus the calling thread
+    uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size() + 1; }
+    // In [0, GetThreadCount()), 0 for the threads that aren't workers. Lets jobs
+    // pick per-thread resources, as long as only one outside thread uses them.
+    uint32_t GetCurrentThreadIndex() const { return GetQueueIndex(); }
+
+private:
+    struct QueuedJob
+    {
+        Job Function;
+        JobCounter* Counter{ nullptr };
+    };
+
+    struct WorkQueue
+    {
+        std::mutex Mutex;
+        std::deque<QueuedJob> Jobs;
+    };
+
+    void WorkerLoop(uint32_t queueIndex);
+    bool TryRunJob(uint32_t queueIndex);
+    bool PopJob(uint32_t queueIndex, QueuedJob& job);
+    bool StealJob(uint32_t thiefIndex, QueuedJob& job);
+    uint32_t GetQueueIndex() const;
+    static void Execute(QueuedJob& job);
+
+private:
+    std::vector<std::thread> m_Workers;
+    // queue 0 is the one shared by the threads that aren't workers
+    std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+
+    std::atomic<uint32_t> m_QueuedJobCount{ 0 };
+    std::atomic<uint32_t> m_SleepingWorkerCount{ 0 };
+    std::mutex m_WakeMutex;
+    std::condition_variable m_WakeCondition;
+    std::atomic<bool> m_Stopping{ false };
+};
+}
@@ -6,12 +6,19 @@
 #include "Graphics/RenderContext.h"
 #include "Graphics/SwapChain.h"
 #include "Graphics/Renderer.h"
+#include "Graphics/GpuProfiler.h"
 #include "Graphics/Model.h"
 #include "Graphics/Systems/SimpleRenderSystem.h"
+#include "Graphics/Systems/CullingSystem.h"
+#include "Graphics/Systems/GpuDrivenRenderSystem.h"
+#include "Graphics/Systems/LodSystem.h"
 #include "Entities/Camera.h"
 #include "Inputs/KeyboardMovementController.h"
 #include "Graphics/Buffer.h"
 #include "Graphics/Descriptors.h"
+#include "Graphics/MemoryAllocator.h"
+#include "Profiling/Profiler.h"
+#include "Threading/JobSystem.h"
 
 namespace vkbg
 {
@@ -23,115 +30,314 @@ struct GlobalUbo
 
 void Engine::Init(EngineProps properties)
 {
-    glfwInit();
+    m_TraceOutputPath = properties.TraceOutputPath;
+    VKBG_PROFILE_BEGIN_SESSION();
+    VKBG_PROFILE_THREAD("Main");
+    VKBG_PROFILE_FUNCTION();
 
-    m_Window = new Window(properties.WindowProperties);
+    m_JobSystem = new JobSystem{ properties.WorkerThreadCount == ~0u
+        ? JobSystem::GetDefaultWorkerCount()
+        : properties.WorkerThreadCount };
 
-    m_RenderContext = new RenderContext(m_Window);
+    if (properties.Headless)
+    {
+        m_HeadlessFrameCount = properties.HeadlessFrameCount;
+        m_RenderContext = new RenderContext(nullptr);
+        m_Renderer = new Renderer(
+            m_RenderContext, { properties.WindowProperties.Width, properties.WindowProperties.Height });
+    }
+    else
+    {
+        glfwInit();
+
+        m_Window = new Window(properties.WindowProperties);
+        m_RenderContext = new RenderContext(m_Window);
+        m_Renderer = new Renderer(m_Window, m_RenderContext);
+    }
+
+    m_ParallelRecording = properties.ParallelRecording;
+    if (m_ParallelRecording)
+        m_Renderer->CreateSecondaryCommandPools(m_JobSystem->GetThreadCount());
 
-    m_Renderer = new Renderer(m_Window, m_RenderContext);
+    m_GpuDrivenRendering = properties.GpuDrivenRendering;
+    if (m_GpuDrivenRendering && m_RenderContext->SupportsDrawIndirectCount() == false)
+    {
+        LOG("The device can't draw with an indirect count, GPU driven rendering is disabled\n");
+        m_GpuDrivenRendering = false;
+    }
 
     m_GlobalDescriptorPool = DescriptorPool::Builder(m_RenderContext)
         .SetMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
         .AddPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
         .Build();
 
-    LoadEntities();
+    if (properties.LoadDefaultScene)
+        LoadEntities();
+
+    CreateFrameResources();
+
+    m_RenderContext->GetAllocator()->LogStats();
 }
 
 void Engine::Run()
 {
-    std::vector<Buffer> globalUbos;
-    globalUbos.reserve(SwapChain::MAX_FRAMES_IN_FLIGHT);
-    for (int i = 0; i < globalUbos.capacity(); ++i)
-    {
-        globalUbos.emplace_back(std::move(Buffer{
-            m_RenderContext,
-            sizeof(GlobalUbo),
-            1,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-        }));
-
-        globalUbos[i].Map();
-    }
+    VKBG_PROFILE_FUNCTION();
 
-    auto globalSetLayout = DescriptorSetLayout::Builder(m_RenderContext)
-        .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-        .Build();
-
-    std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
-    for (int32_t i = 0; i < globalDescriptorSets.size(); ++i)
-    {
-        auto bufferInfo = globalUbos[i].DescriptorInfo();
-        DescriptorWriter(*globalSetLayout, *m_GlobalDescriptorPool)
-            .WriteBuffer(0, &bufferInfo)
-            .Build(globalDescriptorSets[i]);
-    }
-
-    SimpleRenderSystem srs{ m_RenderContext, m_Renderer->GetSwapChainRenderPass(), globalSetLayout->GetDescriptorSetLayout() };
     Camera camera{};
-    auto viewerEntity = Entity::CreateEntity();
+    TransformComponent viewerTransform{};
     KeyboardMovementController cameraController{};
     auto currentTime = std::chrono::high_resolution_clock::now();
+    float statsLogTimer = 0.f;
+    uint64_t frameCount = 0;
 
-    while (!m_Window->ShouldClose())
+    while (!ShouldClose(frameCount))
     {
-        glfwPollEvents();
+        VKBG_PROFILE_SCOPE("Frame");
         auto newTime = std::chrono::high_resolution_clock::now();
         float frameTime =
             std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
         currentTime = newTime;
 
-        cameraController.MoveInPlaneXZ(m_Window->GetWindowHandle(), frameTime, viewerEntity);
-        camera.SetViewYXZ(viewerEntity.Transform.Translation, viewerEntity.Transform.Rotation);
+        if (m_Window != nullptr)
+        {
+            glfwPollEvents();
+            cameraController.MoveInPlaneXZ(
+                m_Window->GetWindowHandle(), frameTime, viewerTransform.Translation, viewerTransform.Rotation);
+        }
+        camera.SetViewYXZ(viewerTransform.Translation, viewerTransform.Rotation);
 
         camera.SetPerspectiveProjection(glm::radians(45.f), m_Renderer->GetAspectRatio(), .1f, 100.f);
 
-        VkCommandBuffer commandBuffer{};
-        if (m_Renderer->BeginFrame(commandBuffer) == false)
+        if (DrawFrame(camera, frameTime) == false)
             continue;
-        uint32_t frameIndex = m_Renderer->GetCurrentFrameIndex();
+        ++frameCount;
 
-        // update
-        GlobalUbo ubo{
-            .projectionView = camera.GetProjectionMatrix() * camera.GetViewMatrix(),
-        };
-        globalUbos[frameIndex].WriteToBuffer(&ubo);
-        globalUbos[frameIndex].Flush();
+        statsLogTimer += frameTime;
+        if (statsLogTimer >= 1.f)
+        {
+            statsLogTimer = 0.f;
+            LOG("Entities visible: " << m_FrameStats.VisibleEntities << ", culled: " << m_FrameStats.CulledEntities
+                << ", draw calls: " << m_FrameStats.DrawCalls
+                << ", binds saved (pipeline/buffer): " << m_FrameStats.PipelineBindsSaved
+                << '/' << m_FrameStats.BufferBindsSaved
+                << ", triangles: " << m_FrameStats.Triangles
+                << " (" << m_FrameStats.LodTrianglesSaved << " saved by the LODs)\n");
+            m_Renderer->GetGpuProfiler()->LogStats();
+        }
+    }
+
+    vkDeviceWaitIdle(m_RenderContext->GetLogicalDevice());
+}
+
+bool Engine::DrawFrame(Camera& camera, float frameTime)
+{
+    VkCommandBuffer commandBuffer{};
+    if (m_Renderer->BeginFrame(commandBuffer) == false)
+        return false;
+    uint32_t frameIndex = m_Renderer->GetCurrentFrameIndex();
+
+    // update
+    GlobalUbo ubo{
+        .projectionView = camera.GetProjectionMatrix() * camera.GetViewMatrix(),
+    };
+    m_GlobalUbos[frameIndex]->WriteToBuffer(&ubo);
+    m_GlobalUbos[frameIndex]->Flush();
+
+    FrameInfo fi{ frameIndex, frameTime, commandBuffer, camera, m_GlobalDescriptorSets[frameIndex] };
+
+    // transforms of the entities that moved since the last frame
+    {
+        VKBG_PROFILE_SCOPE("UpdateTransforms");
+        m_FrameStats.UpdatedTransforms = m_Scene.UpdateDirtyTransforms(m_JobSystem);
+    }
+
+    if (m_GpuDrivenRendering)
+        return DrawFrameGpuDriven(camera, fi);
+
+    // cull
+    uint32_t testedEntities{ 0 };
+    {
+        VKBG_PROFILE_SCOPE("Cull");
+        testedEntities = m_CullingSystem->CullEntities(m_Scene, camera.GetFrustum(), m_VisibleEntities);
+    }
+    m_FrameStats.VisibleEntities = (uint32_t)m_VisibleEntities.size();
+    m_FrameStats.CulledEntities = testedEntities - m_FrameStats.VisibleEntities;
+
+    {
+        VKBG_PROFILE_SCOPE("SelectLods");
+        const float viewportHeight = (float)m_Renderer->GetSwapChainExtent().height;
+        const LodStats lodStats = m_LodSystem->SelectLods(m_Scene, m_VisibleEntities, camera, viewportHeight);
+        m_FrameStats.Triangles = lodStats.Triangles;
+        m_FrameStats.LodTrianglesSaved = lodStats.FullDetailTriangles - lodStats.Triangles;
+    }
+
+    // render
+    {
+        VKBG_PROFILE_SCOPE("RecordCommands");
+        GpuProfiler::Scope mainPassScope{ m_Renderer->GetGpuProfiler(), commandBuffer, "MainPass" };
+        if (m_ParallelRecording)
+        {
+            // a pass made of secondary command buffers can't hold timestamps
+            // itself, MainPass covers it
+            m_Renderer->BeginSwapChainRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            m_FrameStats.DrawCalls = m_SimpleRenderSystem->RenderEntitiesParallel(
+                *m_Renderer, *m_JobSystem, m_Scene, m_VisibleEntities, fi);
+        }
+        else
+        {
+            m_Renderer->BeginSwapChainRenderPass(commandBuffer);
+            GpuProfiler::Scope entitiesScope{ m_Renderer->GetGpuProfiler(), commandBuffer, "RenderEntities" };
+            m_FrameStats.DrawCalls = m_SimpleRenderSystem->RenderEntities(commandBuffer, m_Scene, m_VisibleEntities, fi);
+        }
+        m_Renderer->EndSwapChainRenderPass(commandBuffer);
+    }
+    const DrawBindStats& bindStats = m_SimpleRenderSystem->GetLastBindStats();
+    m_FrameStats.PipelineBindsSaved = bindStats.PipelineBindsSaved;
+    m_FrameStats.BufferBindsSaved = bindStats.BufferBindsSaved;
+    m_Renderer->EndFrame();
+    return true;
+}
+
+bool Engine::DrawFrameGpuDriven(Camera& camera, const FrameInfo& frameInfo)
+{
+    VkCommandBuffer commandBuffer = frameInfo.CommandBuffer;
 
-        FrameInfo fi{ frameIndex, frameTime, commandBuffer, camera, globalDescriptorSets[frameIndex] };
+    // the culling happens on the GPU, so every object gets a level, and the
+    // triangles are counted before the culling
+    {
+        VKBG_PROFILE_SCOPE("SelectLods");
+        const float viewportHeight = (float)m_Renderer->GetSwapChainExtent().height;
+        const LodStats lodStats = m_LodSystem->SelectAllLods(m_Scene, camera, viewportHeight);
+        m_FrameStats.Triangles = lodStats.Triangles;
+        m_FrameStats.LodTrianglesSaved = lodStats.FullDetailTriangles - lodStats.Triangles;
+    }
+
+    uint32_t testedEntities{ 0 };
+    {
+        VKBG_PROFILE_SCOPE("Cull");
+        GpuProfiler::Scope cullScope{ m_Renderer->GetGpuProfiler(), commandBuffer, "Cull" };
+        testedEntities = m_GpuDrivenRenderSystem->CullEntities(commandBuffer, m_Scene, camera.GetFrustum(), frameInfo);
+    }
+    // the GPU count comes back a few frames late, it can exceed this frame's tests
+    m_FrameStats.VisibleEntities = std::min(m_GpuDrivenRenderSystem->GetLastVisibleCount(), testedEntities);
+    m_FrameStats.CulledEntities = testedEntities - m_FrameStats.VisibleEntities;
+    // one indirect draw per visible entity
+    m_FrameStats.DrawCalls = m_FrameStats.VisibleEntities;
+    m_FrameStats.PipelineBindsSaved = 0;
+    m_FrameStats.BufferBindsSaved = 0;
 
-        // render
+    {
+        VKBG_PROFILE_SCOPE("RecordCommands");
+        GpuProfiler::Scope mainPassScope{ m_Renderer->GetGpuProfiler(), commandBuffer, "MainPass" };
         m_Renderer->BeginSwapChainRenderPass(commandBuffer);
-        srs.RenderEntities(commandBuffer, m_Entities, fi);
+        {
+            GpuProfiler::Scope entitiesScope{ m_Renderer->GetGpuProfiler(), commandBuffer, "RenderEntities" };
+            m_GpuDrivenRenderSystem->RenderEntities(commandBuffer, frameInfo);
+        }
         m_Renderer->EndSwapChainRenderPass(commandBuffer);
-        m_Renderer->EndFrame();
     }
+    m_Renderer->EndFrame();
+    return true;
+}
+
+void Engine::Shutdown()
+{
+    {
+        VKBG_PROFILE_FUNCTION();
+        m_Scene.Clear();
 
+        DestroyFrameResources();
+        delete m_GlobalDescriptorPool;
+        delete m_Renderer;
+        delete m_RenderContext;
+        delete m_Window;
+        delete m_JobSystem;
+    }
+
+    VKBG_PROFILE_END_SESSION(m_TraceOutputPath);
+}
+
+void Engine::CreateFrameResources()
+{
+    m_GlobalUbos.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (auto& globalUbo : m_GlobalUbos)
+    {
+        globalUbo = new Buffer{
+            m_RenderContext,
+            sizeof(GlobalUbo),
+            1,
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+        };
+
+        globalUbo->Map();
+    }
+
+    m_GlobalSetLayout = DescriptorSetLayout::Builder(m_RenderContext)
+        .AddBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+        .Build()
+        .release();
+
+    m_GlobalDescriptorSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+    for (int32_t i = 0; i < m_GlobalDescriptorSets.size(); ++i)
+    {
+        auto bufferInfo = m_GlobalUbos[i]->DescriptorInfo();
+        DescriptorWriter(*m_GlobalSetLayout, *m_GlobalDescriptorPool)
+            .WriteBuffer(0, &bufferInfo)
+            .Build(m_GlobalDescriptorSets[i]);
+    }
+
+    m_SimpleRenderSystem = new SimpleRenderSystem{
+        m_RenderContext, m_Renderer->GetSwapChainRenderPass(), m_GlobalSetLayout->GetDescriptorSetLayout() };
+    m_CullingSystem = new CullingSystem{ m_JobSystem };
+    m_LodSystem = new LodSystem{ m_JobSystem };
+    if (m_GpuDrivenRendering)
+    {
+        m_GpuDrivenRenderSystem = new GpuDrivenRenderSystem{
+            m_RenderContext, m_Renderer->GetSwapChainRenderPass(), m_GlobalSetLayout->GetDescriptorSetLayout() };
+    }
+}
+
+void Engine::DestroyFrameResources()
+{
     vkDeviceWaitIdle(m_RenderContext->GetLogicalDevice());
+
+    delete m_GpuDrivenRenderSystem;
+    delete m_LodSystem;
+    delete m_CullingSystem;
+    delete m_SimpleRenderSystem;
+    delete m_GlobalSetLayout;
+    m_GlobalDescriptorSets.clear();
+    for (auto* globalUbo : m_GlobalUbos)
+        delete globalUbo;
+    m_GlobalUbos.clear();
 }
 
-void Engine::Shutdown()
+bool Engine::ShouldClose(uint64_t frameCount) const
 {
-    m_Entities.clear();
-    
-    delete m_GlobalDescriptorPool;
-    delete m_Renderer;
-    delete m_RenderContext;
-    delete m_Window;
+    if (m_Window == nullptr)
+        return frameCount >= m_HeadlessFrameCount;
+    return m_Window->ShouldClose();
 }
 
 void Engine::LoadEntities()
 {
-    std::shared_ptr<Model> vaseModel = Model::CreateModelFromObj(m_RenderContext, "res/Models/smooth_vase.obj");
+    VKBG_PROFILE_FUNCTION();
 
-    Entity vase = Entity::CreateEntity();
-    vase.Model = vaseModel;
+    // all the assets go through the job system at once, each model index matches its path
+    const std::vector<std::string> modelPaths{
+        "res/Models/smooth_vase.obj",
+    };
+    std::vector<std::unique_ptr<Model>> models = Model::CreateModelsFromObj(m_RenderContext, modelPaths, m_JobSystem);
 
-    vase.Transform.Translation = { 0.f, 0.f, 2.5f };
-    vase.Transform.Scale = { 2.5f, 1.5f, 2.5f };
+    std::vector<MeshHandle> meshes;
+    meshes.reserve(models.size());
+    for (auto& model : models)
+        meshes.push_back(m_Scene.AddMesh(std::move(model)));
 
-    m_Entities.emplace_back(std::move(vase));
+    EntityHandle vase = m_Scene.CreateEntity();
+    m_Scene.GetMeshHandle(vase) = meshes[0];
+    m_Scene.SetTranslation(vase, { 0.f, 0.f, 2.5f });
+    m_Scene.SetScale(vase, { 2.5f, 1.5f, 2.5f });
 }
 }
@@ -1,12 +1,29 @@
 #pragma once
 #include "WindowProps.h"
-#include "Entities/Entity.h"
+#include "Entities/Scene.h"
+#include "FrameInfo.h"
 
 namespace vkbg
 {
 struct EngineProps
 {
     WindowProps WindowProperties;
+    // No window or surface: frames are rendered offscreen at the window size
+    // and Run stops after HeadlessFrameCount frames.
+    bool Headless{ false };
+    uint32_t HeadlessFrameCount{ 1000 };
+    // Off for callers that build their own scene through GetScene (benchmarks).
+    bool LoadDefaultScene{ true };
+    // Threads of the job system besides the main one, ~0u for one per hardware thread.
+    uint32_t WorkerThreadCount{ ~0u };
+    // Records the draws on the job system threads into secondary command
+    // buffers, worth it once a frame has thousands of draws.
+    bool ParallelRecording{ false };
+    // Culls on the GPU and draws with one indirect draw, see GpuDrivenRenderSystem.
+    // Ignored (with a warning) when the device can't do it.
+    bool GpuDrivenRendering{ false };
+    // where the CPU trace is written on shutdown (profiling builds only)
+    std::string TraceOutputPath{ "vkbg_trace.json" };
 };
 
 class Engine
@@ -24,6 +41,16 @@ public:
     void Run();
     void Shutdown();
 
+    // Culls, records and submits one frame seen from camera. Returns false if
+    // the frame was skipped because the swap chain had to be recreated.
+    bool DrawFrame(class Camera& camera, float frameTime);
+    Scene& GetScene() { return m_Scene; }
+
+    class RenderContext* GetRenderContext() const { return m_RenderContext; }
+    class Renderer* GetRenderer() const { return m_Renderer; }
+    class JobSystem* GetJobSystem() const { return m_JobSystem; }
+    const FrameStats& GetLastFrameStats() const { return m_FrameStats; }
+
 private:
     Engine() = default;
     Engine(const Engine&) = delete;
@@ -34,14 +61,35 @@ private:
     std::unique_ptr<class Model> CreateCubeModel(class RenderContext* context, glm::vec3 offset);
 
     void LoadEntities();
+    bool DrawFrameGpuDriven(class Camera& camera, const FrameInfo& frameInfo);
+    void CreateFrameResources();
+    void DestroyFrameResources();
+    bool ShouldClose(uint64_t frameCount) const;
 
 
 private:
+    class JobSystem* m_JobSystem{ nullptr };
     class Window* m_Window{ nullptr };
     class RenderContext* m_RenderContext{ nullptr };
     class Renderer* m_Renderer{ nullptr };
     class DescriptorPool* m_GlobalDescriptorPool{ nullptr };
-    std::vector<Entity> m_Entities;
+
+    // frame resources
+    std::vector<class Buffer*> m_GlobalUbos;
+    class DescriptorSetLayout* m_GlobalSetLayout{ nullptr };
+    std::vector<VkDescriptorSet> m_GlobalDescriptorSets;
+    class SimpleRenderSystem* m_SimpleRenderSystem{ nullptr };
+    class CullingSystem* m_CullingSystem{ nullptr };
+    class LodSystem* m_LodSystem{ nullptr };
+    class GpuDrivenRenderSystem* m_GpuDrivenRenderSystem{ nullptr };
+
+    std::string m_TraceOutputPath;
+    uint32_t m_HeadlessFrameCount{ 0 };
+    bool m_ParallelRecording{ false };
+    bool m_GpuDrivenRendering{ false };
+    Scene m_Scene;
+    std::vector<uint32_t> m_VisibleEntities;
+    FrameStats m_FrameStats{};
 };
 }
 
@@ -2,17 +2,29 @@
 
 // Standard Library
 #include <iostream>
+#include <iomanip>
 #include <memory>
 #include <utility>
 #include <algorithm>
 #include <functional>
+#include <numeric>
 #include <stdexcept>
 #include <chrono>
+#include <optional>
+#include <cstring>
+#include <bit>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <exception>
 
 // Data Structures
 #include <string>
 #include <sstream>
 #include <vector>
+#include <deque>
+#include <span>
 #include <unordered_map>
 #include <map>
 #include <unordered_set>
@@ -32,6 +44,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #if defined(DEBUG) || defined(_DEBUG)
     #define LOG(x) std::cout << x
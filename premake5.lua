@@ -20,4 +20,5 @@ group "Dependencies"
 group ""
 
 include "VKBGEngine-Core"
-include "VKBGEngine-App"
\ No newline at end of file
+include "VKBGEngine-App"
+include "VKBGEngine-Bench"
\ No newline at end of file